@@ -0,0 +1,80 @@
+#include "checksum_kernels.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t total_bytes = 1024 * 1024 * 1024;
+
+//! The original byte-at-a-time InternetChecksum::add, as the baseline
+static uint16_t bytewise_checksum(const string_view data) {
+    uint32_t sum = 0;
+    bool parity = false;
+    for (size_t i = 0; i < data.size(); i++) {
+        uint16_t val = uint8_t(data[i]);
+        if (not parity) {
+            val <<= 8;
+        }
+        sum += val;
+        parity = !parity;
+    }
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return ~sum;
+}
+
+//! Checksum `total_bytes` in chunks of `chunk_size` bytes and print the throughput
+template <typename F>
+void measure(const string &name, const string &data, const size_t chunk_size, F &&checksum) {
+    const size_t reps = total_bytes / chunk_size;
+    uint16_t result = 0;
+
+    const auto first_time = high_resolution_clock::now();
+    for (size_t i = 0; i < reps; i++) {
+        // start one byte further along each time, so that misaligned chunks are measured too
+        result ^= checksum(string_view{data.data() + (i % 8), chunk_size});
+    }
+    const auto final_time = high_resolution_clock::now();
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    const auto gigabits_per_second = reps * chunk_size * 8.0 / double(duration);
+
+    cout << "  " << left << setw(10) << name << right << setw(8) << gigabits_per_second << " Gbit/s"
+         << "  (result " << hex << result << dec << ")\n";
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        string data(65536 + 8, 0);
+        for (auto &ch : data) {
+            ch = rd();
+        }
+
+        cout << fixed << setprecision(2);
+        for (const size_t chunk_size : {20, 40, 1460, 65536}) {
+            cout << "Chunks of " << chunk_size << " bytes:\n";
+            measure("bytewise", data, chunk_size, bytewise_checksum);
+            for (const auto &[name, kernel] : available_checksum_kernels()) {
+                measure(name, data, chunk_size, [kernel = kernel](const string_view chunk) {
+                    InternetChecksum check{0, kernel};
+                    check.add(chunk);
+                    return check.value();
+                });
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
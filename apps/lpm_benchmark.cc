@@ -0,0 +1,124 @@
+#include "epoch.hh"
+#include "poptrie.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t num_prefixes = 400000;
+constexpr size_t num_addresses = 1 << 20;
+constexpr size_t total_lookups = 1 << 25;
+constexpr size_t batch_size = 1024;  //!< lookups per Epoch::Guard
+
+//! A prefix length drawn roughly as in a full BGP table: mostly /24, then /22 to /16, then a few shorter
+static uint8_t random_prefix_length(mt19937 &rd) {
+    const unsigned r = rd() % 100;
+    if (r < 60) {
+        return 24;
+    }
+    if (r < 95) {
+        return 16 + (r - 60) % 8;
+    }
+    return 8 + r % 8;
+}
+
+//! Look up `total_lookups` addresses (cycling through `addresses`), one at a time or with
+//! Poptrie::lookup_batch, and print the rate
+static void measure(const string &name, const Poptrie &table, const vector<uint32_t> &addresses, const bool batched) {
+    uint64_t result = 0;
+    vector<optional<uint32_t>> values(batch_size);
+
+    const auto first_time = steady_clock::now();
+    for (size_t i = 0; i < total_lookups; i += batch_size) {
+        const Epoch::Guard guard;
+        if (batched) {
+            table.lookup_batch(&addresses[i % addresses.size()], batch_size, values.data());
+            for (const auto &value : values) {
+                result += value.value_or(0);
+            }
+        } else {
+            for (size_t j = i; j < i + batch_size; j++) {
+                result += table.lookup(addresses[j % addresses.size()]).value_or(0);
+            }
+        }
+    }
+    const auto final_time = steady_clock::now();
+
+    const double ns_per_lookup = duration_cast<nanoseconds>(final_time - first_time).count() / double(total_lookups);
+    cout << "  " << left << setw(24) << name << right << setw(8) << 1000.0 / ns_per_lookup << " Mlookup/s"
+         << setw(10) << ns_per_lookup << " ns/lookup  (result " << result << ")\n";
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        vector<uint32_t> prefixes;
+        vector<uint8_t> lengths;
+        for (size_t i = 0; i < num_prefixes; i++) {
+            lengths.push_back(random_prefix_length(rd));
+            prefixes.push_back(rd() & (~uint32_t(0) << (32 - lengths.back())));
+        }
+
+        Poptrie table;
+        const auto first_time = steady_clock::now();
+        for (size_t i = 0; i < num_prefixes; i++) {
+            table.insert(prefixes[i], lengths[i], i);
+        }
+        const auto final_time = steady_clock::now();
+
+        cout << fixed << setprecision(2) << "Inserted " << table.size() << " prefixes in "
+             << duration_cast<milliseconds>(final_time - first_time).count() << " ms; lookup structure uses "
+             << table.memory_usage() / 1024 << " KiB\n";
+
+        // addresses anywhere, and addresses inside the prefixes (which reach deeper into the trie)
+        vector<uint32_t> random_addresses(num_addresses);
+        vector<uint32_t> routed_addresses(num_addresses);
+        for (size_t i = 0; i < num_addresses; i++) {
+            random_addresses[i] = rd();
+            const size_t route = rd() % num_prefixes;
+            routed_addresses[i] = prefixes[route] | (rd() & (~uint32_t(0) >> lengths[route]));
+        }
+
+        cout << "Lookups:\n";
+        measure("random addresses", table, random_addresses, false);
+        measure("addresses with routes", table, routed_addresses, false);
+        measure("... in batches", table, routed_addresses, true);
+
+        // the same, while another thread removes and re-inserts prefixes as fast as it can
+        atomic<bool> done{false};
+        size_t updates = 0;
+        thread control([&] {
+            auto control_rd = get_random_generator();
+            while (not done) {
+                const size_t route = control_rd() % num_prefixes;
+                if (const auto value = table.remove(prefixes[route], lengths[route])) {
+                    table.insert(prefixes[route], lengths[route], value.value());
+                    updates += 2;
+                }
+            }
+        });
+        const auto churn_start = steady_clock::now();
+        measure("... during route churn", table, routed_addresses, false);
+        done = true;
+        control.join();
+        const auto churn_seconds = duration_cast<duration<double>>(steady_clock::now() - churn_start).count();
+        cout << "  (" << updates / churn_seconds << " route updates/s meanwhile)\n";
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -2,8 +2,12 @@
 #include "router.hh"
 #include "util.hh"
 
+#include <chrono>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <list>
+#include <thread>
 #include <unordered_map>
 
 using namespace std;
@@ -205,7 +209,7 @@ class Network {
     }
 
   public:
-    Network()
+    Network(const bool with_workers)
         : default_id(_router.add_interface({random_router_ethernet_address(), {"171.67.76.46"}}))
         , eth0_id(_router.add_interface({random_router_ethernet_address(), {"10.0.0.1"}}))
         , eth1_id(_router.add_interface({random_router_ethernet_address(), {"172.16.0.1"}}))
@@ -230,6 +234,10 @@ class Network {
         _router.add_route(ip("143.195.128.0"), 18, host("hs_router").address(), hs4_id);
         _router.add_route(ip("143.195.192.0"), 19, host("hs_router").address(), hs4_id);
         _router.add_route(ip("128.30.76.255"), 16, Address{"128.30.0.1"}, mit5_id);
+
+        if (with_workers) {
+            _router.start_workers();
+        }
     }
 
     void simulate_physical_connections() {
@@ -269,12 +277,13 @@ class Network {
     }
 };
 
-void network_simulator() {
+void network_simulator(const bool with_workers) {
     const string green = "\033[32;1m", normal = "\033[m";
 
-    cerr << green << "Constructing network." << normal << "\n";
+    cerr << green << "Constructing network" << (with_workers ? " (router with a worker thread per interface)." : ".")
+         << normal << "\n";
 
-    Network network;
+    Network network{with_workers};
 
     cout << green << "\n\nTesting traffic between two ordinary hosts (applesauce to cherrypie)..." << normal << "\n\n";
     {
@@ -343,9 +352,103 @@ void network_simulator() {
     cout << "\n\n\033[32;1mCongratulations! All datagrams were routed successfully.\033[m\n";
 }
 
-int main() {
+//! Route datagrams among directly attached networks, with the router in one thread and then with a worker
+//! thread per interface, and print the forwarding rates
+void forwarding_benchmark() {
+    constexpr size_t num_interfaces = 4;
+    constexpr size_t hosts_per_network = 8;
+    constexpr size_t datagrams_per_round = 256;  //!< arriving at each interface
+    constexpr size_t rounds = 1000;
+
+    cout << "Forwarding among " << num_interfaces << " networks (" << thread::hardware_concurrency()
+         << " hardware threads):\n";
+    for (const bool with_workers : {false, true}) {
+        Router router;
+        const auto host_ip = [](const size_t network, const size_t host) {
+            return "10.0." + to_string(network) + "." + to_string(host + 2);
+        };
+
+        vector<vector<EthernetFrame>> arrivals(num_interfaces);
+        for (size_t network = 0; network < num_interfaces; network++) {
+            const EthernetAddress router_eth = random_router_ethernet_address();
+            const size_t interface_num = router.add_interface({router_eth, {"10.0." + to_string(network) + ".1"}});
+            router.add_route(ip("10.0." + to_string(network) + ".0"), 24, {}, interface_num);
+
+            // the hosts announce themselves, so that the router need not ARP for them while it is timed
+            for (size_t host = 0; host < hosts_per_network; host++) {
+                ARPMessage arp;
+                arp.opcode = ARPMessage::OPCODE_REQUEST;
+                arp.sender_ethernet_address = random_host_ethernet_address();
+                arp.sender_ip_address = ip(host_ip(network, host));
+                arp.target_ip_address = ip("10.0." + to_string(network) + ".1");
+
+                EthernetFrame frame;
+                frame.header() = {ETHERNET_BROADCAST, arp.sender_ethernet_address, EthernetHeader::TYPE_ARP};
+                frame.payload() = arp.serialize();
+                router.interface(interface_num).recv_frame(frame);
+            }
+            router.interface(interface_num).frames_out() = {};
+
+            // the datagrams that the network's hosts send to the other networks' hosts in each round
+            for (size_t i = 0; i < datagrams_per_round; i++) {
+                InternetDatagram dgram;
+                dgram.header().src = ip(host_ip(network, i % hosts_per_network));
+                dgram.header().dst = ip(host_ip((network + 1 + i % (num_interfaces - 1)) % num_interfaces,
+                                                (i / num_interfaces) % hosts_per_network));
+                dgram.payload() = string(64, 'x');
+                dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+
+                EthernetFrame frame;
+                frame.header() = {router_eth, random_host_ethernet_address(), EthernetHeader::TYPE_IPv4};
+                frame.payload() = dgram.serialize().concatenate();
+                arrivals[network].push_back(move(frame));
+            }
+        }
+
+        if (with_workers) {
+            router.start_workers();
+        }
+
+        size_t forwarded = 0;
+        chrono::nanoseconds routing_time{0};
+        for (size_t round = 0; round < rounds; round++) {
+            for (size_t interface_num = 0; interface_num < num_interfaces; interface_num++) {
+                for (const auto &frame : arrivals[interface_num]) {
+                    router.interface(interface_num).recv_frame(frame);
+                }
+            }
+
+            const auto first_time = chrono::steady_clock::now();
+            router.route();
+            routing_time += chrono::steady_clock::now() - first_time;
+
+            for (size_t interface_num = 0; interface_num < num_interfaces; interface_num++) {
+                forwarded += router.interface(interface_num).frames_out().size();
+                router.interface(interface_num).frames_out() = {};
+            }
+        }
+
+        if (forwarded != rounds * num_interfaces * datagrams_per_round) {
+            throw runtime_error("forwarding benchmark: not every datagram was forwarded");
+        }
+        const double seconds = chrono::duration<double>(routing_time).count();
+        cout << fixed << setprecision(2) << "  " << left << setw(28)
+             << (with_workers ? "worker thread per interface" : "one thread") << right << setw(8)
+             << forwarded / seconds / 1e6 << " Mdatagram/s\n";
+    }
+}
+
+int main(int argc, char *argv[]) {
     try {
-        network_simulator();
+        if (argc == 2 and strcmp(argv[1], "--benchmark") == 0) {
+            forwarding_benchmark();
+        } else if (argc == 1) {
+            network_simulator(false);
+            network_simulator(true);
+        } else {
+            cerr << "Usage: " << argv[0] << " [--benchmark]\n";
+            return EXIT_FAILURE;
+        }
     } catch (const exception &e) {
         cerr << "\n\n\n";
         cerr << "\033[31;1mError: " << e.what() << "\033[m\n";
@@ -0,0 +1,214 @@
+#include "buffer.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_segment.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+//! \name Allocation counting
+//! Every allocation in the process goes through these replacements of the global operator new, so the
+//! benchmark can report how many allocations each packet costs.
+//!@{
+
+static atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void *ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void *operator new(size_t size, align_val_t alignment) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    const size_t align = static_cast<size_t>(alignment);
+    if (void *ptr = aligned_alloc(align, (size + align - 1) / align * align)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new[](size_t size, align_val_t alignment) { return operator new(size, alignment); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete(void *ptr, align_val_t) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t, align_val_t) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, align_val_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t, align_val_t) noexcept { free(ptr); }
+
+//!@}
+
+constexpr size_t corpus_size = 4096;
+constexpr size_t total_packets = 1 << 21;
+
+//! A TCP segment like one seen on the wire: SYNs carry the usual options, and most other segments
+//! carry timestamps (as between two Linux hosts); payloads are empty, small or full-sized
+static TCPSegment make_segment(mt19937 &rd, const size_t index) {
+    TCPSegment seg;
+    TCPHeader &header = seg.header();
+    header.sport = 1024 + rd() % 60000;
+    header.dport = 443;
+    header.seqno = WrappingInt32{uint32_t(rd())};
+    header.ackno = WrappingInt32{uint32_t(rd())};
+    header.win = 65535;
+
+    TCPOptions options;
+    if (index % 64 == 0) {
+        header.syn = true;
+        options.add_mss(1460);
+        options.add_sack_permitted();
+        options.add_timestamps({uint32_t(rd()), 0});
+        options.add_window_scale(7);
+    } else {
+        header.ack = true;
+        if (index % 4 != 0) {
+            options.add_timestamps({uint32_t(rd()), uint32_t(rd())});
+        }
+        static constexpr size_t payload_sizes[] = {0, 64, 536, 1460};
+        string payload(payload_sizes[rd() % 4], 0);
+        for (auto &ch : payload) {
+            ch = rd();
+        }
+        seg.payload() = move(payload);
+    }
+    header.set_options(options);
+    return seg;
+}
+
+//! An Ethernet frame carrying `seg` in an IPv4 datagram
+static EthernetFrame make_frame(mt19937 &rd, TCPSegment &seg) {
+    InternetDatagram dgram;
+    dgram.header().src = rd();
+    dgram.header().dst = rd();
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+
+    EthernetFrame frame;
+    frame.header().src = {2, 0, 0, 0, 0, 1};
+    frame.header().dst = {2, 0, 0, 0, 0, 2};
+    frame.header().type = EthernetHeader::TYPE_IPv4;
+    frame.payload() = dgram.serialize();
+    return frame;
+}
+
+//! Run `process` on `total_packets` packets (cycling through the corpus) and print what each one cost
+template <typename F>
+void measure(const string &name, F &&process) {
+    size_t result = 0;
+
+    const size_t first_allocations = allocations.load();
+    const auto first_time = steady_clock::now();
+    for (size_t i = 0; i < total_packets; i++) {
+        result += process(i % corpus_size);
+    }
+    const auto final_time = steady_clock::now();
+    const size_t final_allocations = allocations.load();
+
+    const double ns_per_packet = duration_cast<nanoseconds>(final_time - first_time).count() / double(total_packets);
+    const double allocations_per_packet = (final_allocations - first_allocations) / double(total_packets);
+
+    cout << "  " << left << setw(24) << name << right << setw(8) << 1000.0 / ns_per_packet << " Mpkt/s"
+         << setw(10) << ns_per_packet << " ns/pkt" << setw(8) << allocations_per_packet << " allocs/pkt"
+         << "  (result " << result << ")\n";
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // the corpus, as raw frames and (for the serializers) as the objects they were built from
+        vector<TCPSegment> segments;
+        vector<Buffer> raw_frames;
+        for (size_t i = 0; i < corpus_size; i++) {
+            segments.push_back(make_segment(rd, i));
+            TCPSegment copy = segments.back();
+            raw_frames.emplace_back(make_frame(rd, copy).serialize().concatenate());
+        }
+
+        // the corpus parsed, as a relay would have it
+        vector<EthernetFrame> frames(corpus_size);
+        vector<InternetDatagram> datagrams(corpus_size);
+        vector<TCPSegment> parsed_segments(corpus_size);
+        for (size_t i = 0; i < corpus_size; i++) {
+            if (frames[i].parse(raw_frames[i]) != ParseResult::NoError or
+                datagrams[i].parse(frames[i].payload()) != ParseResult::NoError or
+                parsed_segments[i].parse(datagrams[i].payload(), datagrams[i].header().pseudo_cksum()) !=
+                    ParseResult::NoError) {
+                throw runtime_error("corpus packet failed to parse");
+            }
+        }
+
+        cout << fixed << setprecision(2) << "Parsing " << total_packets << " packets (" << corpus_size
+             << " distinct):\n";
+
+        measure("EthernetFrame::parse", [&](const size_t i) {
+            EthernetFrame frame;
+            return frame.parse(raw_frames[i]) == ParseResult::NoError;
+        });
+
+        measure("IPv4Datagram::parse", [&](const size_t i) {
+            InternetDatagram dgram;
+            return dgram.parse(frames[i].payload()) == ParseResult::NoError;
+        });
+
+        measure("TCPSegment::parse", [&](const size_t i) {
+            TCPSegment seg;
+            return seg.parse(datagrams[i].payload(), datagrams[i].header().pseudo_cksum()) == ParseResult::NoError;
+        });
+
+        measure("frame to segment", [&](const size_t i) {
+            EthernetFrame frame;
+            InternetDatagram dgram;
+            TCPSegment seg;
+            return frame.parse(raw_frames[i]) == ParseResult::NoError and
+                   dgram.parse(frame.payload()) == ParseResult::NoError and
+                   seg.parse(dgram.payload(), dgram.header().pseudo_cksum()) == ParseResult::NoError;
+        });
+
+        cout << "Serializing:\n";
+
+        measure("TCPSegment::serialize", [&](const size_t i) {
+            return segments[i].serialize(datagrams[i].header().pseudo_cksum()).size();
+        });
+
+        measure("  (as parsed)", [&](const size_t i) {
+            return parsed_segments[i].serialize(datagrams[i].header().pseudo_cksum()).size();
+        });
+
+        measure("IPv4Datagram::serialize", [&](const size_t i) { return datagrams[i].serialize().size(); });
+
+        measure("EthernetFrame::serialize", [&](const size_t i) { return frames[i].serialize().size(); });
+
+        measure("segment to frame", [&](const size_t i) {
+            InternetDatagram dgram;
+            dgram.header() = datagrams[i].header();
+            dgram.payload() = segments[i].serialize(dgram.header().pseudo_cksum());
+
+            EthernetFrame frame;
+            frame.header() = frames[i].header();
+            frame.payload() = dgram.serialize();
+            return frame.serialize().size();
+        });
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
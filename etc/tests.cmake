@@ -62,6 +62,25 @@ add_test(NAME t_retx_win             COMMAND fsm_retx_win)
 add_test(NAME t_loopback             COMMAND fsm_loopback)
 add_test(NAME t_loopback_win         COMMAND fsm_loopback_win)
 add_test(NAME t_reorder              COMMAND fsm_reorder)
+add_test(NAME t_tcp_demux            COMMAND tcp_demux)
+add_test(NAME t_tcp_reactor          COMMAND tcp_reactor)
+add_test(NAME t_tcp_engine           COMMAND tcp_engine)
+add_test(NAME t_tcp_sharded_engine   COMMAND tcp_sharded_engine)
+add_test(NAME t_timer_wheel          COMMAND timer_wheel)
+add_test(NAME t_toeplitz             COMMAND toeplitz)
+add_test(NAME t_ring_buffer          COMMAND ring_buffer)
+add_test(NAME t_syn_cookie           COMMAND syn_cookie)
+add_test(NAME t_internet_checksum    COMMAND internet_checksum)
+add_test(NAME t_packet_buffer        COMMAND packet_buffer)
+add_test(NAME t_small_vector         COMMAND small_vector)
+add_test(NAME t_packet_view          COMMAND packet_view)
+add_test(NAME t_poptrie              COMMAND poptrie)
+add_test(NAME t_epoch                COMMAND epoch)
+add_test(NAME t_route_cache          COMMAND route_cache)
+add_test(NAME t_ecmp                 COMMAND ecmp)
+add_test(NAME t_mpsc_ring            COMMAND mpsc_ring)
+add_test(NAME t_egress_queue         COMMAND egress_queue)
+add_test(NAME t_arp_table            COMMAND arp_table)
 
 add_test(NAME t_address_dt           COMMAND address_dt)
 add_test(NAME t_parser_dt            COMMAND parser_dt)
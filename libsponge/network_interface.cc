@@ -3,6 +3,8 @@
 #include "arp_message.hh"
 #include "ethernet_frame.hh"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 // Dummy implementation of a network interface
@@ -17,8 +19,11 @@ using namespace std;
 
 //! \param[in] ethernet_address Ethernet (what ARP calls "hardware") address of the interface
 //! \param[in] ip_address IP (what ARP calls "protocol") address of the interface
-NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address)
-    : _ethernet_address(ethernet_address), _ip_address(ip_address) {
+//! \param[in] config limits on the outbound queues (by default, none)
+NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address,
+                                   const Address &ip_address,
+                                   const EgressConfig &config)
+    : _ethernet_address(ethernet_address), _ip_address(ip_address), _config(config) {
     cerr << "DEBUG: Network interface has Ethernet address " << to_string(_ethernet_address) << " and IP address "
          << ip_address.ip() << "\n";
 }
@@ -31,39 +36,176 @@ void NetworkInterface::set_ethernet_header(EthernetHeader& header, const Etherne
     header.type = type;
 }
 
+//! \details Frames beyond `max_frames` are dropped on arrival (a tail drop); CoDel drops from the head.
+void NetworkInterface::queue_frame(EthernetFrame &&frame) {
+    if (_config.codel)
+        codel();
+
+    if (_frames_out.size() >= _config.max_frames) {
+        _drops.queue_full++;
+        return;
+    }
+    _frames_out.push(move(frame));
+    if (_config.codel)
+        _queued_at.push_back(_now);
+}
+
+bool NetworkInterface::codel_ok_to_drop() {
+    // never drop the only frame queued: it cannot be waiting behind anything
+    if (_frames_out.size() <= 1 || _now - _queued_at.front() < _config.codel_target) {
+        _first_above_time = 0;
+        return false;
+    }
+    if (_first_above_time == 0) {
+        _first_above_time = _now + _config.codel_interval;
+        return false;
+    }
+    return _now >= _first_above_time;
+}
+
+//! \details CoDel decides when a frame is dequeued, but the owner takes frames from frames_out() without
+//! telling the interface. So this runs whenever time passes or a frame is queued, on the frame then at the
+//! head; it has waited at least that long, and the control law (drop at intervals shrinking as
+//! 1/sqrt(drops)) only needs to run as often as the clock advances.
+void NetworkInterface::codel() {
+    while (_queued_at.size() > _frames_out.size())
+        _queued_at.pop_front();
+
+    const auto control_law = [&](const uint64_t t) {
+        const double spacing = double(_config.codel_interval) / sqrt(double(_drop_count));
+        return t + max<uint64_t>(1, llround(spacing));
+    };
+    const auto drop_head = [&] {
+        _frames_out.pop();
+        _queued_at.pop_front();
+        _drops.codel++;
+    };
+
+    bool ok_to_drop = codel_ok_to_drop();
+    if (_dropping) {
+        if (!ok_to_drop)
+            _dropping = false;
+        while (_dropping && _now >= _drop_next) {
+            drop_head();
+            _drop_count++;
+            if (!codel_ok_to_drop())
+                _dropping = false;
+            else
+                _drop_next = control_law(_drop_next);
+        }
+    } else if (ok_to_drop) {
+        drop_head();
+        codel_ok_to_drop();
+        _dropping = true;
+
+        // if dropping stopped only recently, resume near the rate it had reached
+        const uint64_t delta = _drop_count - _last_count;
+        const bool recent = int64_t(_now - _drop_next) < int64_t(16 * _config.codel_interval);
+        _drop_count = (delta > 1 && recent) ? delta : 1;
+        _drop_next = control_law(_now);
+        _last_count = _drop_count;
+    }
+}
+
+const ArpTable::Entry *NetworkInterface::reachable(const uint32_t ip) {
+    const ArpTable::Entry *entry = _arp_table.find(ip);
+    // an expired entry may not have been removed yet: its timer fires up to a tick late
+    if (entry && entry->state == ArpTable::State::REACHABLE && entry->deadline > _now)
+        return entry;
+    return nullptr;
+}
+
+//! \details The header was made and serialized when the neighbor was learned; here it is only copied, or
+//! shared, in front of the datagram (see EthernetFrame::assign()).
+void NetworkInterface::send_ipv4(const InternetDatagram &dgram, const ArpTable::Entry &neighbor) {
+    EthernetFrame new_frame;
+    new_frame.assign(neighbor.ethernet_header, neighbor.serialized_header, dgram.serialize());
+    queue_frame(move(new_frame));
+}
+
+//! \details Each request waits twice as long for its reply as the one before it.
+void NetworkInterface::send_arp_request(ArpTable::Entry &entry) {
+    EthernetFrame new_frame;
+    set_ethernet_header(new_frame.header(), ETHERNET_BROADCAST, this->_ethernet_address,
+            EthernetHeader::TYPE_ARP);
+    ARPMessage request_arp_message;
+    request_arp_message.opcode = ARPMessage::OPCODE_REQUEST;
+    request_arp_message.sender_ethernet_address = this->_ethernet_address;
+    request_arp_message.sender_ip_address = (this->_ip_address).ipv4_numeric();
+    request_arp_message.target_ip_address = entry.ip_address;
+    new_frame.payload() = {request_arp_message.serialize()};
+
+    // set when the request is due again
+    entry.deadline = _now + (ARP_REQUEST_INTERVAL << entry.requests);
+    entry.requests++;
+    _arp_timers.schedule(entry.ip_address, entry.deadline);
+
+    queue_frame(move(new_frame));
+}
+
+void NetworkInterface::give_up(ArpTable::Entry &entry) {
+    _drops.unresolved += entry.pending.size();
+    _pending_datagrams -= entry.pending.size();
+    entry.pending.clear();
+    entry.requests = 0;
+}
+
+void NetworkInterface::send_to_next_hop(const InternetDatagram &dgram, const uint32_t next_hop_ip) {
+    if (const ArpTable::Entry *known = reachable(next_hop_ip)) {
+        // if the mapping already exists
+        send_ipv4(dgram, *known);
+        return;
+    }
+
+    ArpTable::Entry &entry = _arp_table.insert(next_hop_ip);
+    if (entry.state == ArpTable::State::REACHABLE) {
+        // the mapping has expired
+        entry.state = ArpTable::State::INCOMPLETE;
+        entry.requests = 0;
+    }
+
+    if (entry.requests == 0) {
+        send_arp_request(entry);
+    } else if (_now >= entry.deadline) {
+        // the request is due again, but its timer has not fired yet (it may fire up to a tick late)
+        if (entry.requests == ARP_MAX_REQUESTS)
+            give_up(entry);
+        send_arp_request(entry);
+    }
+
+    // queue the datagram until its next hop answers (or the requests run out)
+    if (entry.pending.size() >= _config.max_pending_per_neighbor ||
+        _pending_datagrams >= _config.max_pending_datagrams) {
+        _drops.pending_full++;
+        return;
+    }
+    entry.pending.push_back(dgram);
+    _pending_datagrams++;
+}
+
 //! \param[in] dgram the IPv4 datagram to be sent
 //! \param[in] next_hop the IP address of the interface to send it to (typically a router or default gateway, but may also be another host if directly connected to the same network as the destination)
 //! (Note: the Address type can be converted to a uint32_t (raw 32-bit IP address) with the Address::ipv4_numeric() method.)
 void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Address &next_hop) {
     // convert IP address of next hop to raw 32-bit representation (used in ARP header)
-    const uint32_t next_hop_ip = next_hop.ipv4_numeric();
-    EthernetFrame new_frame;
+    send_to_next_hop(dgram, next_hop.ipv4_numeric());
+}
 
-    if (_map_ipv4_to_ethernet.count(next_hop_ip)) { 
-        // if the mapping already exists
-        set_ethernet_header(new_frame.header(), _map_ipv4_to_ethernet[next_hop_ip], 
-                            this->_ethernet_address, EthernetHeader::TYPE_IPv4);
-        new_frame.payload() = move(dgram.serialize());        
-    } else if (!_ip_arp.count(next_hop_ip)) {
-        // the mapping does not exist
-        set_ethernet_header(new_frame.header(), ETHERNET_BROADCAST, this->_ethernet_address, 
-                EthernetHeader::TYPE_ARP);
-        ARPMessage request_arp_message;
-        request_arp_message.opcode = ARPMessage::OPCODE_REQUEST;
-        request_arp_message.sender_ethernet_address = this->_ethernet_address;
-        request_arp_message.sender_ip_address = (this->_ip_address).ipv4_numeric();
-        request_arp_message.target_ip_address = next_hop_ip;
-        new_frame.payload() = {request_arp_message.serialize()};
-        
-        // set the last send time
-        _ip_arp.insert(next_hop_ip);
-        _ip_arp_time.push({next_hop_ip, 5000});
-
-        // stoged the ip that hasn't know the Ethernet address of the next hop ip
-        _ip_datagrams[next_hop_ip].push_back(dgram);
-    } else return;
-
-    _frames_out.push(new_frame);
+//! \param[in] batch the datagrams to be sent, each with the IP address of its next hop
+void NetworkInterface::send_datagrams(vector<OutboundDatagram> &batch) {
+    const ArpTable::Entry *known = nullptr;
+    for (auto &[dgram, next_hop_ip] : batch) {
+        if (!known || known->ip_address != next_hop_ip)
+            known = reachable(next_hop_ip);
+
+        if (!known) {
+            // no mapping yet, so ARP for it as a single datagram would (which may move the table's entries)
+            send_to_next_hop(dgram, next_hop_ip);
+            continue;
+        }
+        send_ipv4(dgram, *known);
+    }
+    batch.clear();
 }
 
 //! \param[in] frame the incoming Ethernet frame
@@ -77,7 +219,7 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
         // if the inbound type is ipv4
         InternetDatagram datagram;
         if (datagram.parse(frame.payload()) == ParseResult::NoError)
-            return optional<InternetDatagram>{datagram};
+            return datagram;
         return nullopt;
     } else {
         // if the inbound type is ARP
@@ -89,9 +231,17 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
 
         const uint32_t sender_ip = arp_message.sender_ip_address;
         // learn a new mapping from "sender" fields
-        _map_ipv4_to_ethernet[sender_ip] = arp_message.sender_ethernet_address;
-        _map_ipv4_to_time[sender_ip] = 30000;
-        _cached_mapping.push({sender_ip, 30000});
+        ArpTable::Entry &entry = _arp_table.insert(sender_ip);
+        entry.state = ArpTable::State::REACHABLE;
+        entry.ethernet_address = arp_message.sender_ethernet_address;
+        entry.deadline = _now + ARP_ENTRY_TTL;
+        entry.requests = 0;
+        set_ethernet_header(entry.ethernet_header, entry.ethernet_address, this->_ethernet_address,
+                            EthernetHeader::TYPE_IPv4);
+        entry.serialized_header = Buffer(entry.ethernet_header.serialize());
+        _arp_timers.schedule(sender_ip, entry.deadline);
+        vector<InternetDatagram> waiting = move(entry.pending);
+        entry.pending.clear();
 
         // if the ARP type is request, reply
         if (arp_message.opcode == ARPMessage::OPCODE_REQUEST) {
@@ -107,13 +257,13 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
             reply_arp_message.target_ip_address = arp_message.sender_ip_address;
             new_frame.payload() = {reply_arp_message.serialize()};
             
-            _frames_out.push(new_frame);
+            queue_frame(move(new_frame));
         }
 
-        // resent when receive a ARP
-        for (auto& dgram : _ip_datagrams[sender_ip]) 
-            send_datagram(dgram, Address::from_ipv4_numeric(sender_ip));
-        _ip_datagrams[sender_ip].clear();
+        // send what was waiting, all at once and straight to the learned address
+        _pending_datagrams -= waiting.size();
+        for (auto& dgram : waiting)
+            send_ipv4(dgram, entry);
 
         return nullopt;
     }
@@ -121,35 +271,25 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
 }
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
-void NetworkInterface::tick(const size_t ms_since_last_tick) { 
-    // Expire any mappings that have been expired
-    while (!_cached_mapping.empty()) {
-        auto& [ip, last_time] = _cached_mapping.front();
-
-        if (last_time == _map_ipv4_to_time[ip]) {
-            if (last_time > ms_since_last_tick) {
-                last_time -= ms_since_last_tick;
-                _map_ipv4_to_time[ip] = last_time;
-                break;
-            } else {
-                _map_ipv4_to_ethernet.erase(ip);
-                _map_ipv4_to_time.erase(ip);
-            }
-        }
-
-        _cached_mapping.pop();
-    }
+void NetworkInterface::tick(const size_t ms_since_last_tick) {
+    _now += ms_since_last_tick;
 
-    // update the arp sent last time
-    while (!_ip_arp_time.empty()) {
-        auto& [ip, last_time] = _ip_arp_time.front();
-        
-        if (last_time > ms_since_last_tick) {
-            last_time -= ms_since_last_tick;
-            break;            
+    // expire mappings, repeat unanswered requests that datagrams are waiting on, and forget the rest
+    _arp_timers.advance(_now, [&](const TimerWheel::TimerId id) {
+        const uint32_t ip = static_cast<uint32_t>(id);
+        ArpTable::Entry *entry = _arp_table.find(ip);
+        if (!entry)
+            return;
+        if (entry->state == ArpTable::State::INCOMPLETE && !entry->pending.empty()) {
+            if (entry->requests < ARP_MAX_REQUESTS) {
+                send_arp_request(*entry);
+                return;
+            }
+            give_up(*entry);
         }
+        _arp_table.erase(ip);
+    });
 
-        _ip_arp.erase(ip);
-        _ip_arp_time.pop();
-    }
+    if (_config.codel)
+        codel();
 }
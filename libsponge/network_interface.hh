@@ -1,15 +1,35 @@
 #ifndef SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
 #define SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
 
+#include "arp_table.hh"
 #include "ethernet_frame.hh"
 #include "tcp_over_ip.hh"
+#include "timer_wheel.hh"
 #include "tun.hh"
 
+#include <cstdint>
+#include <deque>
+#include <limits>
 #include <optional>
 #include <queue>
-#include <map>
 #include <vector>
-#include <set>
+
+//! Limits on what a NetworkInterface queues, and active queue management of its frames awaiting transmission
+class EgressConfig {
+  public:
+    static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+    static constexpr size_t CODEL_TARGET_DFLT = 5;           //!< CoDel's default target queueing delay, in ms
+    static constexpr size_t CODEL_INTERVAL_DFLT = 100;       //!< CoDel's default interval, in ms
+    static constexpr size_t PENDING_PER_NEIGHBOR_DFLT = 16;  //!< Default most datagrams waiting for one next hop
+
+    size_t max_frames = UNLIMITED;             //!< Most frames awaiting transmission; more are dropped
+    size_t max_pending_datagrams = UNLIMITED;  //!< Most datagrams waiting for ARP (over all next hops)
+    //! Most datagrams waiting for ARP for any one next hop (so a burst to a dead one takes bounded memory)
+    size_t max_pending_per_neighbor = PENDING_PER_NEIGHBOR_DFLT;
+    bool codel = false;                        //!< Drop frames that wait too long, with [CoDel](\ref rfc::rfc8289)
+    size_t codel_target = CODEL_TARGET_DFLT;      //!< Queueing delay CoDel lets frames have, in ms
+    size_t codel_interval = CODEL_INTERVAL_DFLT;  //!< How long the delay may stay above target, in ms
+};
 
 //! \brief A "network interface" that connects IP (the internet layer, or network layer)
 //! with Ethernet (the network access layer, or link layer).
@@ -33,6 +53,15 @@
 //! request or reply, the network interface processes the frame
 //! and learns or replies as necessary.
 class NetworkInterface {
+  public:
+    //! \brief Frames and datagrams dropped from the outbound queues, by cause
+    struct DropCounters {
+        uint64_t queue_full = 0;    //!< frames dropped because `max_frames` were awaiting transmission
+        uint64_t codel = 0;         //!< frames dropped by CoDel for waiting too long
+        uint64_t pending_full = 0;  //!< datagrams dropped because the most allowed were waiting for ARP
+        uint64_t unresolved = 0;    //!< datagrams dropped because their next hop never answered ARP
+    };
+
   private:
     //! Ethernet (known as hardware, network-access-layer, or link-layer) address of the interface
     EthernetAddress _ethernet_address;
@@ -43,32 +72,81 @@ class NetworkInterface {
     //! outbound queue of Ethernet frames that the NetworkInterface wants sent
     std::queue<EthernetFrame> _frames_out{};
 
-    //! queue the ip datagram whose next hop's Ethernet address haven't known
-    std::map<uint32_t, std::vector<InternetDatagram> > _ip_datagrams{};
+    //! how long a learned Ethernet address is remembered, in ms
+    static constexpr uint64_t ARP_ENTRY_TTL = 30000;
+
+    //! how long to wait for a reply to the first ARP request for an IP address, in ms (doubled for each repeat)
+    static constexpr uint64_t ARP_REQUEST_INTERVAL = 5000;
+
+    //! ARP requests sent for an IP address before the datagrams waiting for it are dropped
+    static constexpr uint8_t ARP_MAX_REQUESTS = 3;
+
+    //! the neighbors: their Ethernet addresses, ARP requests in progress and datagrams waiting for them
+    ArpTable _arp_table{};
+
+    //! expiry of the entries of `_arp_table`, each timer identified by the entry's IP address
+    TimerWheel _arp_timers{0, 100, 1024};
+
+    //! limits and active queue management of the outbound queues
+    EgressConfig _config;
+
+    DropCounters _drops{};
 
-    //! Mapping from IPv4 address to Ethernet address
-    std::map<uint32_t, EthernetAddress> _map_ipv4_to_ethernet{};
+    //! milliseconds since the interface was constructed
+    uint64_t _now{0};
 
-    //! Mapping from IPv4 address to left valid time
-    std::map<uint32_t, size_t> _map_ipv4_to_time{};
+    //! with CoDel, when each frame of `_frames_out` was queued (the owner pops frames without telling
+    //! the interface, so the times of frames no longer in `_frames_out` are dropped when next looked at)
+    std::deque<uint64_t> _queued_at{};
 
-    //! the left valid time of cached mapping
-    std::queue<std::pair<uint32_t, size_t> > _cached_mapping{};
+    //! \name CoDel state ([RFC 8289](\ref rfc::rfc8289), section 5)
+    //!@{
+    uint64_t _first_above_time{0};  //!< when the delay will have been above target for an interval (0 if it is not)
+    uint64_t _drop_next{0};         //!< when to drop the next frame, while dropping
+    uint64_t _drop_count{0};        //!< frames dropped since dropping started
+    uint64_t _last_count{0};        //!< `_drop_count` when dropping last started
+    bool _dropping{false};
+    //!@}
 
-    //! Stoged the requested ip of ARPs that have been sent in last five seconds
-    std::set<uint32_t> _ip_arp{};
+    //! number of datagrams waiting for ARP, over all entries of `_arp_table`
+    size_t _pending_datagrams{0};
 
-    //! the queue make sure if the arp message of the 
-    // same ip has been sent in the last five seconds
-    std::queue<std::pair<uint32_t, size_t> > _ip_arp_time{};
+    //! the entry for `ip`, if its Ethernet address is known and has not expired
+    const ArpTable::Entry *reachable(const uint32_t ip);
+
+    //! send the next ARP request for INCOMPLETE `entry`, and arm its timer to wait for the reply
+    void send_arp_request(ArpTable::Entry &entry);
+
+    //! drop the datagrams waiting for INCOMPLETE `entry`, whose requests have all gone unanswered
+    void give_up(ArpTable::Entry &entry);
+
+    //! send `dgram` to the neighbor with IP address `next_hop_ip`, or ARP for it
+    void send_to_next_hop(const InternetDatagram &dgram, const uint32_t next_hop_ip);
+
+    //! queue `dgram` in a frame to the REACHABLE neighbor `neighbor`, with the header the entry keeps
+    void send_ipv4(const InternetDatagram &dgram, const ArpTable::Entry &neighbor);
+
+    //! queue a frame for transmission, unless the queue is full
+    void queue_frame(EthernetFrame &&frame);
+
+    //! CoDel's dodequeue(): whether the frame at the head of `_frames_out` may be dropped for waiting too long
+    bool codel_ok_to_drop();
+
+    //! CoDel's dequeue(): drop frames from the head of `_frames_out` while CoDel's control law says to
+    void codel();
 
     //! set the Ethernet header
     void set_ethernet_header(EthernetHeader& header, const EthernetAddress& dst, 
                             const EthernetAddress& src, const uint16_t& type);
 
   public:
+    //! A datagram to send, and the raw 32-bit IP address of its next hop
+    using OutboundDatagram = std::pair<InternetDatagram, uint32_t>;
+
     //! \brief Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer) addresses
-    NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address);
+    NetworkInterface(const EthernetAddress &ethernet_address,
+                     const Address &ip_address,
+                     const EgressConfig &config = {});
 
     //! \brief Access queue of Ethernet frames awaiting transmission
     std::queue<EthernetFrame> &frames_out() { return _frames_out; }
@@ -79,6 +157,11 @@ class NetworkInterface {
     //! ("Sending" is accomplished by pushing the frame onto the frames_out queue.)
     void send_datagram(const InternetDatagram &dgram, const Address &next_hop);
 
+    //! \brief Sends each datagram of `batch` as send_datagram() would, and empties `batch`
+
+    //! The Ethernet address of a next hop is looked up once for a run of datagrams to it.
+    void send_datagrams(std::vector<OutboundDatagram> &batch);
+
     //! \brief Receives an Ethernet frame and responds appropriately.
 
     //! If type is IPv4, returns the datagram.
@@ -86,6 +169,9 @@ class NetworkInterface {
     //! If type is ARP reply, learn a mapping from the "sender" fields.
     std::optional<InternetDatagram> recv_frame(const EthernetFrame &frame);
 
+    //! \brief Frames and datagrams dropped from the outbound queues
+    const DropCounters &drops() const { return _drops; }
+
     //! \brief Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 };
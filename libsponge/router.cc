@@ -1,6 +1,10 @@
 #include "router.hh"
 
+#include "packet_view.hh"
+
+#include <array>
 #include <iostream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -23,60 +27,357 @@ void Router::add_route(const uint32_t route_prefix,
                        const uint8_t prefix_length,
                        const optional<Address> next_hop,
                        const size_t interface_num) {
-    cerr << "DEBUG: adding route " << Address::from_ipv4_numeric(route_prefix).ip() << "/" << int(prefix_length)
-         << " => " << (next_hop.has_value() ? next_hop->ip() : "(direct)") << " on interface " << interface_num << "\n";
+    add_route(route_prefix, prefix_length, {NextHop{next_hop, interface_num}});
+}
+
+//! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
+//! \param[in] prefix_length For this route to be applicable, how many high-order (most-significant) bits of the route_prefix will need to match the corresponding bits of the datagram's destination address?
+//! \param[in] next_hops The paths to spread the route's datagrams over (at least one)
+void Router::add_route(const uint32_t route_prefix, const uint8_t prefix_length, const vector<NextHop> &next_hops) {
+    auto paths = _make_paths(next_hops);
 
     // Your code here.
-    _route_table.push_back({route_prefix, prefix_length, next_hop, interface_num});
+    const lock_guard<mutex> lock(_route_update_mutex);
+    _set_route(route_prefix, prefix_length, paths.release());
 }
 
-//! \param[in] dgram The datagram to be routed
-void Router::route_one_datagram(InternetDatagram &dgram) {
-    // Your code here.
-    IPv4Header& header = dgram.header();
-
-    // ttl will down to 0 or has been 0
-    if (header.ttl <= 1) return;
-
-    size_t table_num = 0;
-    optional<size_t> longest_prefix_length{};
-    const size_t route_table_size = _route_table.size();
-    const uint32_t ip = header.dst;
-
-    for (size_t i = 0; i < route_table_size; i ++ ) {
-        auto& tuple = _route_table[i];
-        size_t mask = (~0ul) ^ ((1ul << (32 - tuple.prefix_length)) - 1ul);
-        if ((ip & mask) == (tuple.route_prefix & mask)) {
-            if (!longest_prefix_length.has_value() ||
-                longest_prefix_length.value() < tuple.prefix_length) {
-                table_num = i;
-                longest_prefix_length = {tuple.prefix_length};
-            }
+unique_ptr<const Router::Paths> Router::_make_paths(const vector<NextHop> &next_hops) {
+    if (next_hops.empty()) {
+        throw runtime_error("Router: route with no next hop");
+    }
+
+    auto paths = make_unique<Paths>();
+    for (const auto &hop : next_hops) {
+        optional<uint32_t> next_hop_ip;
+        if (hop.address.has_value()) next_hop_ip = hop.address->ipv4_numeric();
+        paths->push_back({next_hop_ip, hop.interface_num});
+    }
+    return paths;
+}
+
+//! \details A route that is only given new paths keeps its slot, so routes cached by workers stay right.
+//! A new route is in its slot before the lookup table can lead to it.
+void Router::_set_route(const uint32_t route_prefix, const uint8_t prefix_length, const Paths *paths) {
+    if (const auto slot = _lookup_table.find(route_prefix, prefix_length)) {
+        Epoch::retire(_route_slots.load(memory_order_relaxed)->paths[slot.value()].exchange(paths));
+        Epoch::reclaim();
+        return;
+    }
+
+    const uint32_t slot = _allocate_route_slot();
+    _route_slots.load(memory_order_relaxed)->paths[slot].store(paths, memory_order_release);
+    _lookup_table.insert(route_prefix, prefix_length, slot);
+    // a longer prefix may now match destinations that workers have cached
+    _route_generation.fetch_add(1, memory_order_release);
+}
+
+uint32_t Router::_allocate_route_slot() {
+    {
+        const lock_guard<mutex> lock(_free_route_slots->mutex);
+        if (!_free_route_slots->slots.empty()) {
+            const uint32_t slot = _free_route_slots->slots.back();
+            _free_route_slots->slots.pop_back();
+            return slot;
+        }
+    }
+
+    RouteSlots *slots = _route_slots.load(memory_order_relaxed);
+    if (_route_slots_used == slots->paths.size()) {
+        // workers may still be reading the old array: copy it, and retire it once they cannot be
+        auto *grown = new RouteSlots(2 * slots->paths.size());
+        for (size_t i = 0; i < _route_slots_used; i++) {
+            grown->paths[i].store(slots->paths[i].load(memory_order_relaxed), memory_order_relaxed);
+        }
+        _route_slots.store(grown, memory_order_release);
+        Epoch::retire(slots);
+    }
+    return _route_slots_used++;
+}
+
+//! \details The removed route's slot is only reused once no worker can have found it before the removal
+//! (or still have it in a route cache that it has not yet emptied).
+bool Router::remove_route(const uint32_t route_prefix, const uint8_t prefix_length) {
+    const lock_guard<mutex> lock(_route_update_mutex);
+    const auto removed = _lookup_table.remove(route_prefix, prefix_length);
+    if (!removed.has_value()) return false;
+
+    const uint32_t slot = removed.value();
+    Epoch::retire(_route_slots.load(memory_order_relaxed)->paths[slot].exchange(nullptr));
+    _route_generation.fetch_add(1, memory_order_release);
+    Epoch::defer([free_slots = _free_route_slots, slot] {
+        const lock_guard<mutex> free_lock(free_slots->mutex);
+        free_slots->slots.push_back(slot);
+    });
+    Epoch::reclaim();
+    return true;
+}
+
+bool Router::replace_route(const uint32_t route_prefix,
+                           const uint8_t prefix_length,
+                           const optional<Address> next_hop,
+                           const size_t interface_num) {
+    return replace_route(route_prefix, prefix_length, {NextHop{next_hop, interface_num}});
+}
+
+bool Router::replace_route(const uint32_t route_prefix, const uint8_t prefix_length, const vector<NextHop> &next_hops) {
+    auto paths = _make_paths(next_hops);
+    const lock_guard<mutex> lock(_route_update_mutex);
+    if (!_lookup_table.find(route_prefix, prefix_length).has_value()) return false;
+
+    _set_route(route_prefix, prefix_length, paths.release());
+    return true;
+}
+
+Router::~Router() {
+    stop_workers();
+    RouteSlots *slots = _route_slots.load();
+    for (size_t i = 0; i < _route_slots_used; i++) {
+        delete slots->paths[i].load();
+    }
+    delete slots;
+}
+
+//! \brief Hash of a datagram's flow: its addresses and protocol and, for TCP and UDP, its ports
+//! \details The ports are left out of every fragment (they are only in the first one), so that all the
+//! fragments of a datagram hash the same.
+static uint64_t flow_hash(const InternetDatagram &dgram) {
+    const auto mix = [](uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        return x ^ (x >> 33);
+    };
+
+    const IPv4Header& header = dgram.header();
+    uint64_t ports = 0;
+    if ((header.proto == IPv4Header::PROTO_TCP || header.proto == PacketView::PROTO_UDP) && !header.mf &&
+        header.offset == 0) {
+        const auto &buffers = dgram.payload().buffers();
+        if (!buffers.empty() && buffers.front().size() >= 4)
+            ports = NetParser::load_u32(reinterpret_cast<const uint8_t *>(buffers.front().str().data()));
+    }
+    return mix(mix((uint64_t(header.src) << 32) | header.dst) ^ (ports << 8) ^ header.proto);
+}
+
+void Router::set_route_cache_capacity(const size_t capacity) {
+    _forwarder.route_cache = RouteCache(capacity);
+    for (auto &worker : _workers) {
+        worker->forwarder.route_cache = RouteCache(capacity);
+    }
+}
+
+void Router::route_batch(Forwarder &forwarder) const {
+    auto &batch = forwarder.batch;
+
+    // the routes may change meanwhile, in other threads; whatever this reads of them stays valid until it is done
+    const Epoch::Guard guard;
+    const uint64_t route_generation = _route_generation.load(memory_order_acquire);
+    if (route_generation != forwarder.route_generation) {
+        forwarder.route_cache.invalidate();
+        forwarder.route_generation = route_generation;
+    }
+
+    // find every destination in the route cache, or else look up all that missed it together,
+    // so that those lookups' memory accesses overlap
+    array<optional<uint32_t>, BATCH_SIZE> table_nums{};
+    array<uint32_t, BATCH_SIZE> missed_dsts{};
+    array<size_t, BATCH_SIZE> missed{};
+    size_t missed_count = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        const IPv4Header& header = batch[i].header();
+        // ttl will down to 0 or has been 0
+        if (header.ttl <= 1) continue;
+
+        if (!forwarder.route_cache.lookup(header.dst, table_nums[i])) {
+            missed_dsts[missed_count] = header.dst;
+            missed[missed_count++] = i;
         }
     }
 
-    // no routes match
-    if (!longest_prefix_length.has_value()) return;
+    array<optional<uint32_t>, BATCH_SIZE> looked_up{};
+    _lookup_table.lookup_batch(missed_dsts.data(), missed_count, looked_up.data());
+    for (size_t j = 0; j < missed_count; j++) {
+        table_nums[missed[j]] = looked_up[j];
+        forwarder.route_cache.insert(missed_dsts[j], looked_up[j]);
+    }
+
+    // loaded after the lookups, so that it has the slot of every route they found
+    const RouteSlots &slots = *_route_slots.load(memory_order_acquire);
+    for (size_t i = 0; i < batch.size(); i++) {
+        IPv4Header& header = batch[i].header();
 
-    header.ttl --;
-    auto& tuple = _route_table[table_num];
-    // send the datagram to the specific interface
-    _interfaces[tuple.interface_num].send_datagram(
-        dgram,
-        tuple.next_hop.has_value() ? 
-        tuple.next_hop.value() : 
-        Address::from_ipv4_numeric(ip)
-    );
+        // ttl will down to 0 or has been 0, or no routes match
+        if (header.ttl <= 1 || !table_nums[i].has_value()) continue;
+        // the route was removed since it was looked up
+        const Paths *route = slots.paths[table_nums[i].value()].load(memory_order_acquire);
+        if (route == nullptr) continue;
 
+        header.decrement_ttl();
+        // a route with several paths sends each flow down one of them
+        const Paths &paths = *route;
+        const Path &path = paths.size() == 1 ? paths[0] : paths[(flow_hash(batch[i]) >> 32) * paths.size() >> 32];
+        const uint32_t next_hop_ip = path.next_hop.value_or(header.dst);
+        forwarder.egress[path.interface_num].emplace_back(move(batch[i]), next_hop_ip);
+    }
+    batch.clear();
 }
 
 void Router::route() {
-    // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface.
+    if (!_workers.empty()) {
+        // hand the round to the workers, and wait until they have all finished it
+        unique_lock<mutex> lock(_round_mutex);
+        _routing_workers = _workers.size();
+        _workers_finished = 0;
+        _round++;
+        _round_start.notify_all();
+        _round_end.wait(lock, [&] { return _workers_finished == _workers.size(); });
+        return;
+    }
+
+    // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface,
+    // up to BATCH_SIZE datagrams at a time.
     for (auto &interface : _interfaces) {
         auto &queue = interface.datagrams_out();
         while (not queue.empty()) {
-            route_one_datagram(queue.front());
-            queue.pop();
+            while (not queue.empty() and _forwarder.batch.size() < BATCH_SIZE) {
+                _forwarder.batch.push_back(move(queue.front()));
+                queue.pop();
+            }
+            route_batch(_forwarder);
+
+            // send the datagrams to their interfaces, a whole batch to each
+            try {
+                for (size_t interface_num = 0; interface_num < _interfaces.size(); interface_num++) {
+                    if (!_forwarder.egress[interface_num].empty())
+                        _interfaces[interface_num].send_datagrams(_forwarder.egress[interface_num]);
+                }
+            } catch (...) {
+                // drop the rest of the batch, so that the next route() does not send it again
+                for (auto &datagrams : _forwarder.egress) {
+                    datagrams.clear();
+                }
+                throw;
+            }
+        }
+    }
+}
+
+void Router::start_workers() {
+    if (!_workers.empty()) return;
+
+    for (size_t interface_num = 0; interface_num < _interfaces.size(); interface_num++) {
+        auto worker = make_unique<Worker>();
+        worker->forwarder.route_cache = RouteCache(_forwarder.route_cache.capacity());
+        worker->forwarder.egress.resize(_interfaces.size());
+        _workers.push_back(move(worker));
+    }
+    for (size_t interface_num = 0; interface_num < _workers.size(); interface_num++) {
+        _workers[interface_num]->thread = thread(&Router::_work, this, interface_num, _round);
+    }
+}
+
+void Router::stop_workers() {
+    {
+        const lock_guard<mutex> lock(_round_mutex);
+        _stopping = true;
+    }
+    _round_start.notify_all();
+    for (auto &worker : _workers) {
+        worker->thread.join();
+    }
+    _workers.clear();
+    _stopping = false;
+}
+
+static void log_worker_exception(const size_t interface_num, const exception &e) {
+    cerr << "Exception in Router worker for interface " << interface_num << ": " << e.what() << "\n";
+}
+
+//! \param[in] interface_num The interface whose worker this is
+//! \param[in] round The round that has already been routed when the worker starts
+void Router::_work(const size_t interface_num, uint64_t round) {
+    while (true) {
+        {
+            unique_lock<mutex> lock(_round_mutex);
+            _round_start.wait(lock, [&] { return _stopping || _round != round; });
+            if (_stopping) return;
+            round = _round;
+        }
+
+        try {
+            _route_in_worker(interface_num);
+        } catch (const exception &e) {
+            log_worker_exception(interface_num, e);
+        }
+
+        // finished, even if it failed, so that route() returns
+        {
+            const lock_guard<mutex> lock(_round_mutex);
+            _workers_finished++;
+        }
+        _round_end.notify_one();
+    }
+}
+
+void Router::_route_in_worker(const size_t interface_num) {
+    Worker &worker = *_workers[interface_num];
+    AsyncNetworkInterface &interface = _interfaces[interface_num];
+
+    // send the batches that other workers routed to this interface, and say if there were any
+    const auto send_received = [&] {
+        bool any = false;
+        while (worker.inbox.try_pop(worker.received)) {
+            try {
+                interface.send_datagrams(worker.received);
+            } catch (const exception &e) {
+                log_worker_exception(interface_num, e);
+                worker.received.clear();
+            }
+            any = true;
+        }
+        return any;
+    };
+
+    auto &queue = interface.datagrams_out();
+    try {
+        while (not queue.empty()) {
+            while (not queue.empty() and worker.forwarder.batch.size() < BATCH_SIZE) {
+                worker.forwarder.batch.push_back(move(queue.front()));
+                queue.pop();
+            }
+            route_batch(worker.forwarder);
+
+            for (size_t out = 0; out < _workers.size(); out++) {
+                auto &datagrams = worker.forwarder.egress[out];
+                if (datagrams.empty()) continue;
+
+                if (out == interface_num) {
+                    interface.send_datagrams(datagrams);
+                    continue;
+                }
+                // the ring hands back the (empty) batch the other worker left in it; while the ring is full,
+                // keep emptying this worker's own, so that no two workers can wait on each other
+                while (!_workers[out]->inbox.try_push(datagrams)) {
+                    if (!send_received()) this_thread::yield();
+                }
+            }
+            send_received();
+        }
+    } catch (const exception &e) {
+        // drop the rest of the round's datagrams, but still take part in it, or the other workers would wait
+        log_worker_exception(interface_num, e);
+        queue = {};
+        worker.forwarder.batch.clear();
+        for (auto &datagrams : worker.forwarder.egress) {
+            datagrams.clear();
         }
     }
+
+    // everything this interface received is routed; keep sending what the others route here until they are done
+    _routing_workers.fetch_sub(1, memory_order_release);
+    while (_routing_workers.load(memory_order_acquire) != 0) {
+        if (!send_received()) this_thread::yield();
+    }
+    send_received();
 }
@@ -1,10 +1,20 @@
 #ifndef SPONGE_LIBSPONGE_ROUTER_HH
 #define SPONGE_LIBSPONGE_ROUTER_HH
 
+#include "epoch.hh"
+#include "mpsc_ring.hh"
 #include "network_interface.hh"
+#include "poptrie.hh"
+#include "route_cache.hh"
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <queue>
+#include <stdexcept>
+#include <thread>
 
 //! \brief A wrapper for NetworkInterface that makes the host-side
 //! interface asynchronous: instead of returning received datagrams
@@ -44,39 +54,203 @@ class Router {
     //! The router's collection of network interfaces
     std::vector<AsyncNetworkInterface> _interfaces{};
 
-    struct TableTuple {
-        uint32_t route_prefix;
-        uint8_t prefix_length;
-        std::optional<Address> next_hop;
+  public:
+    //! One of the paths of a route: the IP address of the next hop (empty if the network is directly
+    //! attached), and the index of the interface to send the datagram out on
+    struct NextHop {
+        std::optional<Address> address;
+        size_t interface_num;
+    };
+
+  private:
+    //! A NextHop, with the next hop as a raw 32-bit IP address
+    struct Path {
+        std::optional<uint32_t> next_hop;
         size_t interface_num;
     };
 
-    //! The route table
-    std::vector<TableTuple> _route_table{};
+    //! The equal-cost paths of a route; each flow keeps to one of them. Never changed once published.
+    using Paths = std::vector<Path>;
+
+    //! \brief The paths of every route, in the slot that is its value in `_lookup_table`
+    //! \details Workers read the slots while other threads change the routes, without a lock: a slot is only
+    //! ever switched to another Paths atomically, and the array is only ever replaced by a bigger copy. What
+    //! is replaced is retired through Epoch, so it stays valid for readers inside an Epoch::Guard. The slot
+    //! of a removed route is null.
+    struct RouteSlots {
+        std::vector<std::atomic<const Paths *>> paths;
+        explicit RouteSlots(const size_t capacity) : paths(capacity) {}
+    };
+
+    //! Slots that routes were removed from, handed back (through Epoch) once no worker can still find them
+    struct FreeRouteSlots {
+        std::mutex mutex{};
+        std::vector<uint32_t> slots{};
+    };
+
+    std::atomic<RouteSlots *> _route_slots{new RouteSlots(16)};
+    size_t _route_slots_used{0};  //!< slots handed out so far (the rest of the array is unused)
+    std::shared_ptr<FreeRouteSlots> _free_route_slots{std::make_shared<FreeRouteSlots>()};
+
+    //! Serializes changes to the routes
+    std::mutex _route_update_mutex{};
+
+    //! Bumped whenever a change may alter which route a destination matches (see Forwarder::route_generation)
+    std::atomic<uint64_t> _route_generation{0};
+
+    //! \brief The paths of a route to `next_hops`
+    //! \throws std::runtime_error if there are none
+    static std::unique_ptr<const Paths> _make_paths(const std::vector<NextHop> &next_hops);
+
+    //! Publish `paths` as the route for a prefix, replacing any (with `_route_update_mutex` held)
+    void _set_route(const uint32_t route_prefix, const uint8_t prefix_length, const Paths *paths);
+
+    //! A slot for a new route (with `_route_update_mutex` held)
+    uint32_t _allocate_route_slot();
+
+    //! Longest-prefix match from a destination address to the slot of its route in `_route_slots`
+    Poptrie _lookup_table{};
+
+    //! Most datagrams that route() takes from an interface at a time
+    static constexpr size_t BATCH_SIZE = 32;
+
+    using EgressBatch = std::vector<NetworkInterface::OutboundDatagram>;
+
+    //! What a thread needs to route datagrams
+    struct Forwarder {
+        //! Recent lookups in `_lookup_table`, so that frequent destinations skip it
+        RouteCache route_cache{};
+
+        //! `_route_generation` when `route_cache` was last emptied; a newer one means it may be stale
+        uint64_t route_generation{0};
+
+        //! The datagrams being routed
+        std::vector<InternetDatagram> batch{};
+
+        //! For each interface, the datagrams of `batch` that are to be sent from it
+        std::vector<EgressBatch> egress{};
+    };
+
+    //! Routes datagrams when route() runs in the calling thread
+    Forwarder _forwarder{};
+
+    //! Put each datagram of `forwarder.batch` in `forwarder.egress`, for the appropriate outbound interface
+    //! and with its next hop, as specified by the route with the longest prefix_length that matches the
+    //! datagram's destination address. Only reads the routes (inside an Epoch::Guard), so workers may do it at
+    //! the same time, and while the routes change.
+    void route_batch(Forwarder &forwarder) const;
+
+    //! Most batches that may wait for an interface's worker
+    static constexpr size_t RING_CAPACITY = 64;
+
+    //! A thread that routes the datagrams its interface received, and sends those routed to its interface
+    struct Worker {
+        Forwarder forwarder{};
+        MPSCRing<EgressBatch> inbox{RING_CAPACITY};  //!< batches that other workers routed to this interface
+        EgressBatch received{};                       //!< a batch taken from `inbox`
+        std::thread thread{};
+    };
+
+    //! The workers, one per interface (none unless start_workers() was called)
+    std::vector<std::unique_ptr<Worker>> _workers{};
 
-    //! Send a single datagram from the appropriate outbound interface to the next hop,
-    //! as specified by the route with the longest prefix_length that matches the
-    //! datagram's destination address.
-    void route_one_datagram(InternetDatagram &dgram);
+    //! \name Hands each round of route() to the workers, and waits for them to finish it
+    //!@{
+    std::mutex _round_mutex{};
+    std::condition_variable _round_start{};
+    std::condition_variable _round_end{};
+    uint64_t _round{0};
+    size_t _workers_finished{0};
+    bool _stopping{false};
+    //!@}
+
+    //! Workers still routing the datagrams their interface received, in this round
+    std::atomic<size_t> _routing_workers{0};
+
+    //! The loop of the worker for interface `interface_num`
+    void _work(const size_t interface_num, uint64_t round);
+
+    //! One round of route(), in the worker for interface `interface_num`
+    void _route_in_worker(const size_t interface_num);
 
   public:
+    Router() = default;
+    ~Router();
+    Router(const Router &other) = delete;
+    Router &operator=(const Router &other) = delete;
+
     //! Add an interface to the router
     //! \param[in] interface an already-constructed network interface
     //! \returns The index of the interface after it has been added to the router
     size_t add_interface(AsyncNetworkInterface &&interface) {
+        if (not _workers.empty()) {
+            throw std::runtime_error("Router::add_interface: workers are running");
+        }
         _interfaces.push_back(std::move(interface));
+        _forwarder.egress.emplace_back();
         return _interfaces.size() - 1;
     }
 
     //! Access an interface by index
     AsyncNetworkInterface &interface(const size_t N) { return _interfaces.at(N); }
 
-    //! Add a route (a forwarding rule)
+    //! \name Routes
+    //! The routes may be changed from any thread, even while route() runs in another (the changes are
+    //! serialized, and routing sees each one whole).
+    //!@{
+
+    //! Add a route (a forwarding rule), replacing any route for the same prefix
     void add_route(const uint32_t route_prefix,
                    const uint8_t prefix_length,
                    const std::optional<Address> next_hop,
                    const size_t interface_num);
 
+    //! \brief Add a route with several equal-cost paths, replacing any route for the same prefix
+    //! \details Datagrams are spread over the paths by a hash of their flow (addresses, protocol and ports),
+    //! so that all the datagrams of a flow take the same path and are not reordered.
+    void add_route(const uint32_t route_prefix, const uint8_t prefix_length, const std::vector<NextHop> &next_hops);
+
+    //! \brief Remove the route for a prefix
+    //! \returns `false` if there was no route for the prefix
+    bool remove_route(const uint32_t route_prefix, const uint8_t prefix_length);
+
+    //! \brief Change the next hop and interface of the route for a prefix
+    //! \returns `false` (and adds nothing) if there was no route for the prefix
+    bool replace_route(const uint32_t route_prefix,
+                       const uint8_t prefix_length,
+                       const std::optional<Address> next_hop,
+                       const size_t interface_num);
+
+    //! \brief Change the paths of the route for a prefix
+    //! \returns `false` (and adds nothing) if there was no route for the prefix
+    bool replace_route(const uint32_t route_prefix, const uint8_t prefix_length, const std::vector<NextHop> &next_hops);
+    //!@}
+
+    //! \brief Replace the route caches with empty ones of `capacity` entries (0 disables them)
+    //! \note Not while route() runs
+    void set_route_cache_capacity(const size_t capacity);
+
+    //! Access the route cache used when route() runs in the calling thread, e.g. for its hit rate
+    RouteCache &route_cache() { return _forwarder.route_cache; }
+
+    //! Access the route cache of the worker for interface `interface_num`
+    RouteCache &worker_route_cache(const size_t interface_num) {
+        return _workers.at(interface_num)->forwarder.route_cache;
+    }
+
+    //! \brief Route in a worker thread per interface from now on
+    //! \details In each route(), every worker routes the datagrams its interface received, passing them to the
+    //! workers of their outbound interfaces through lock-free rings, and sends the datagrams routed to its own
+    //! interface. The workers share the routes, which they read without locks, so the routes may change while
+    //! they run. route() still returns once every datagram is routed, so between calls the interfaces belong
+    //! to the caller, as without workers. A worker that fails (throws) logs why, and drops the datagrams it
+    //! had left to route in that round.
+    //! \note No interface may be added while there are workers
+    void start_workers();
+
+    //! Stop the workers, and route in the thread that calls route() again
+    void stop_workers();
+
     //! Route packets between the interfaces
     void route();
 };
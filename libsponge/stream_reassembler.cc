@@ -56,9 +56,9 @@ void StreamReassembler::push_substring(const string &data, const size_t index, c
     //! \details check if the given data is outside the window
     if (index >= _output.bytes_read() + _capacity) return;
     
-    //! \details solve the empty data problem
+    //! \details solve the empty data problem (the stream only ends here if nothing is missing before it)
     if (data.size() == 0) {
-        if (eof) _output.end_input();
+        if (eof && index <= _output.bytes_written()) _output.end_input();
         return;
     } 
 
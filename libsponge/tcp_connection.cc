@@ -67,9 +67,16 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
     }
     //! give the segment to the TCPReceiver
     _receiver.segment_received(seg);
+    //! the peer's SYN may announce the largest segment it accepts
+    if (header.syn && header.options.mss().has_value())
+        _sender.set_peer_mss(header.options.mss().value());
     //! if the ACK flag is set, tells the TCPSender about the ackno and the window_size
     if (header.ack)
         _sender.ack_received(header.ackno, header.win);
+    //! the ACK may open the window, or close it with nothing in flight (which calls for a probe),
+    //! so send what it allows now rather than on a later tick (a connection still in LISTEN stays quiet)
+    if (header.ack && _sender.next_seqno_absolute() > 0)
+        _sender.fill_window();
 
     // cout << "============= SEGMENT RECEIVE ==============\n" << endl;
     // cout << "seg.length = " << seg.length_in_sequence_space() << endl;
@@ -92,6 +99,7 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
         _sender.send_empty_segment();
         clear_sender_segments();
     }
+    clear_sender_segments();
     //! if the inbound stream ends before the TCPConnection has
     //! reached EOF on its outbound stream
     if (_receiver.stream_out().input_ended() && !_sender.stream_in().eof())
@@ -100,6 +108,28 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
 
 bool TCPConnection::active() const { return _active; }
 
+bool TCPConnection::lingering() const {
+    return _active && _linger_after_streams_finish && _receiver.stream_out().input_ended() &&
+           _sender.stream_in().eof() && _sender.next_seqno_absolute() == _sender.stream_in().bytes_written() + 2 &&
+           _sender.bytes_in_flight() == 0;
+}
+
+void TCPConnection::stop_lingering() {
+    if (lingering())
+        _active = false;
+}
+
+optional<size_t> TCPConnection::next_timeout() const {
+    if (!_active) return {};
+    //! both streams have finished: the connection ends at the next tick, or once it has lingered
+    if (_receiver.stream_out().input_ended() && _sender.stream_in().eof() && _sender.bytes_in_flight() == 0) {
+        if (!_linger_after_streams_finish) return 0;
+        const size_t linger = 10 * static_cast<size_t>(_cfg.rt_timeout);
+        return linger - min(_time_since_last_segment_received, linger);
+    }
+    return _sender.time_until_retransmission();
+}
+
 size_t TCPConnection::write(const string &data) {
     if (!_active) return 0;
     size_t bytes_actual_write = _sender.stream_in().write(data);
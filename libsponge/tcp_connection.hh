@@ -74,6 +74,23 @@ class TCPConnection {
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
     //!@}
 
+    //! \name Accessors and methods for an owner that keeps TIME_WAIT state itself (e.g. TCPDemultiplexer)
+    //!@{
+    //! \brief Have both streams finished (and been acknowledged), leaving the connection lingering?
+    bool lingering() const;
+    //! \brief next sequence number to send
+    WrappingInt32 next_seqno() const { return _sender.next_seqno(); }
+    //! \brief next sequence number expected from the peer (if its SYN has been received)
+    std::optional<WrappingInt32> ackno() const { return _receiver.ackno(); }
+    //! \brief receive window to advertise
+    size_t window_size() const { return _receiver.window_size(); }
+    //! \brief End a lingering connection now, without a RST, leaving the rest of TIME_WAIT to the owner
+    void stop_lingering();
+    //! \brief Milliseconds until tick() next has something to do (retransmit, or end the connection),
+    //! or empty if nothing will happen until a segment arrives or the application acts
+    std::optional<size_t> next_timeout() const;
+    //!@}
+
     //! \name Methods for the owner or operating system to call
     //!@{
 
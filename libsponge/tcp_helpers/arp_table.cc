@@ -0,0 +1,79 @@
+#include "arp_table.hh"
+
+#include <utility>
+
+using namespace std;
+
+ArpTable::ArpTable(const size_t capacity) : _slots(16), _shift(28) {
+    while (_slots.size() < 2 * capacity) {
+        _slots.resize(2 * _slots.size());
+        _shift--;
+    }
+}
+
+ArpTable::Entry &ArpTable::insert(const uint32_t ip_address) {
+    if (Entry *entry = find(ip_address)) {
+        return *entry;
+    }
+    if (2 * (_size + 1) > _slots.size()) {
+        _grow();
+    }
+
+    const size_t mask = _slots.size() - 1;
+    size_t i = _home(ip_address);
+    while (_slots[i].used) {
+        i = (i + 1) & mask;
+    }
+    _slots[i].used = true;
+    _slots[i].entry = Entry{};
+    _slots[i].entry.ip_address = ip_address;
+    _size++;
+    return _slots[i].entry;
+}
+
+//! \details Each entry after the removed one, up to the next empty slot, moves back into the hole if its
+//! search starts at or before the hole, so that no search stops early at the hole.
+void ArpTable::erase(const uint32_t ip_address) {
+    const size_t mask = _slots.size() - 1;
+    size_t hole = _home(ip_address);
+    while (true) {
+        if (not _slots[hole].used) {
+            return;
+        }
+        if (_slots[hole].entry.ip_address == ip_address) {
+            break;
+        }
+        hole = (hole + 1) & mask;
+    }
+
+    for (size_t i = (hole + 1) & mask; _slots[i].used; i = (i + 1) & mask) {
+        // the entry at i may move into the hole unless its home is (cyclically) after the hole, up to i
+        const size_t home = _home(_slots[i].entry.ip_address);
+        const bool home_after_hole = hole <= i ? (hole < home and home <= i) : (hole < home or home <= i);
+        if (not home_after_hole) {
+            _slots[hole].entry = move(_slots[i].entry);
+            hole = i;
+        }
+    }
+    _slots[hole].used = false;
+    _slots[hole].entry = Entry{};
+    _size--;
+}
+
+void ArpTable::_grow() {
+    vector<Slot> old = move(_slots);
+    _slots = vector<Slot>(2 * old.size());
+    _shift--;
+
+    const size_t mask = _slots.size() - 1;
+    for (auto &slot : old) {
+        if (slot.used) {
+            size_t i = _home(slot.entry.ip_address);
+            while (_slots[i].used) {
+                i = (i + 1) & mask;
+            }
+            _slots[i].used = true;
+            _slots[i].entry = move(slot.entry);
+        }
+    }
+}
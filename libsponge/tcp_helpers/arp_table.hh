@@ -0,0 +1,82 @@
+#ifndef SPONGE_LIBSPONGE_ARP_TABLE_HH
+#define SPONGE_LIBSPONGE_ARP_TABLE_HH
+
+#include "buffer.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//! \brief What a NetworkInterface knows of its neighbors: for each IP address, its Ethernet address (or the
+//! [ARP](\ref rfc::rfc826) request in progress for it) and the datagrams waiting for it
+//! \details An open-addressing hash table with linear probing, kept at most half full, so that finding a
+//! neighbor usually takes one probe. Removal shifts the entries after it back, so there are no tombstones.
+//! Entries move when the table grows or when others are removed: a pointer to an entry is valid only
+//! until the next insert() or erase().
+class ArpTable {
+  public:
+    enum class State : uint8_t {
+        INCOMPLETE,  //!< the Ethernet address is not known; a request has been (or is about to be) sent
+        REACHABLE,   //!< the Ethernet address is known
+    };
+
+    struct Entry {
+        uint32_t ip_address{};
+        State state{State::INCOMPLETE};
+        EthernetAddress ethernet_address{};
+        //! header of the frames that carry IPv4 datagrams to the neighbor, set once it is REACHABLE
+        EthernetHeader ethernet_header{};
+        //! `ethernet_header` serialized, shared by every such frame (see EthernetFrame::assign())
+        Buffer serialized_header{};
+        //! when a REACHABLE entry's address expires, or when an INCOMPLETE entry's next request is due (ms)
+        uint64_t deadline{0};
+        uint8_t requests{0};  //!< ARP requests sent since the entry was last INCOMPLETE with no request out
+        std::vector<InternetDatagram> pending{};  //!< datagrams waiting for the Ethernet address
+    };
+
+  private:
+    struct Slot {
+        Entry entry{};
+        bool used{false};
+    };
+
+    std::vector<Slot> _slots;
+    unsigned _shift;  //!< 32 minus log2 of the number of slots
+    size_t _size{0};
+
+    //! The slot where the search for `ip_address` starts
+    size_t _home(const uint32_t ip_address) const { return (ip_address * 0x9e3779b1u) >> _shift; }
+
+    //! Double the number of slots
+    void _grow();
+
+  public:
+    //! An empty table, with room for `capacity` entries before it grows
+    explicit ArpTable(const size_t capacity = 16);
+
+    //! The entry for `ip_address`, or nullptr if there is none
+    Entry *find(const uint32_t ip_address) {
+        const size_t mask = _slots.size() - 1;
+        for (size_t i = _home(ip_address);; i = (i + 1) & mask) {
+            if (not _slots[i].used) {
+                return nullptr;
+            }
+            if (_slots[i].entry.ip_address == ip_address) {
+                return &_slots[i].entry;
+            }
+        }
+    }
+
+    //! The entry for `ip_address`, added (INCOMPLETE, with no request sent) if there is none
+    Entry &insert(const uint32_t ip_address);
+
+    //! Remove the entry for `ip_address`, if there is one
+    void erase(const uint32_t ip_address);
+
+    //! Number of entries
+    size_t size() const { return _size; }
+};
+
+#endif  // SPONGE_LIBSPONGE_ARP_TABLE_HH
@@ -3,20 +3,55 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 
 using namespace std;
 
-ParseResult EthernetFrame::parse(const Buffer buffer) {
-    NetParser p{buffer};
+ParseResult EthernetFrame::parse(Buffer buffer) {
+    NetParser p{move(buffer)};
     _header.parse(p);
-    _payload = p.buffer();
+    _payload = p.take_buffer();
+    _serialized = BufferList{};
 
     return p.get_error();
 }
 
+void EthernetFrame::assign(const EthernetHeader &header, const Buffer &serialized, BufferList payload) {
+    _header = header;
+    _payload = move(payload);
+    if (_payload.buffers().size() == 1) {
+        Buffer packet = _payload.buffers().front();
+        if (uint8_t *out = packet.claim_headroom(EthernetHeader::LENGTH)) {
+            const string_view bytes = serialized.str();
+            copy(bytes.begin(), bytes.end(), out);
+            _serialized = move(packet);
+            return;
+        }
+    }
+
+    // e.g. a forwarded datagram, whose header and payload are separate pieces
+    _serialized = serialized;
+    _serialized.append(_payload);
+}
+
 BufferList EthernetFrame::serialize() const {
+    if (not _serialized.buffers().empty()) {
+        return _serialized;
+    }
+
+    // prepend the header in place if the payload left room for it in front (see TCPSegment::serialize())
+    if (_payload.buffers().size() == 1) {
+        Buffer packet = _payload.buffers().front();
+        if (uint8_t *out = packet.claim_headroom(EthernetHeader::LENGTH)) {
+            _header.serialize_into(out);
+            return packet;
+        }
+    }
+
     BufferList ret;
     ret.append(_header.serialize());
     ret.append(_payload);
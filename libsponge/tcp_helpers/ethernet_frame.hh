@@ -10,20 +10,36 @@ class EthernetFrame {
     EthernetHeader _header{};
     BufferList _payload{};
 
+    //! the whole frame, as assign() built it from the serialized header (empty otherwise)
+    BufferList _serialized{};
+
   public:
     //! \brief Parse the frame from a string
-    ParseResult parse(const Buffer buffer);
+    ParseResult parse(Buffer buffer);
+
+    //! \brief Make the frame `header` + `payload`, given `header` already serialized (e.g. kept per neighbor)
+    //! \details If the payload has room in front of it, the serialized header is copied there; otherwise
+    //! `serialized` itself (which is shared, not copied) is put in front of the payload. Either way,
+    //! serialize() returns the result without formatting the header again.
+    void assign(const EthernetHeader &header, const Buffer &serialized, BufferList payload);
 
     //! \brief Serialize the frame to a string
     BufferList serialize() const;
 
     //! \name Accessors
+    //! \note The mutable accessors discard what assign() prepended, since the frame may change
     //!@{
     const EthernetHeader &header() const { return _header; }
-    EthernetHeader &header() { return _header; }
+    EthernetHeader &header() {
+        _serialized = BufferList{};
+        return _header;
+    }
 
     const BufferList &payload() const { return _payload; }
-    BufferList &payload() { return _payload; }
+    BufferList &payload() {
+        _serialized = BufferList{};
+        return _payload;
+    }
     //!@}
 };
 
@@ -2,50 +2,47 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
 using namespace std;
 
 ParseResult EthernetHeader::parse(NetParser &p) {
-    if (p.buffer().size() < EthernetHeader::LENGTH) {
+    // check the length once, then decode the header in place
+    const uint8_t *fixed = p.peek(EthernetHeader::LENGTH);
+    if (not fixed) {
         return ParseResult::PacketTooShort;
     }
 
     /* read destination address */
-    for (auto &byte : dst) {
-        byte = p.u8();
-    }
+    copy(fixed, fixed + dst.size(), dst.begin());
 
     /* read source address */
-    for (auto &byte : src) {
-        byte = p.u8();
-    }
+    copy(fixed + dst.size(), fixed + dst.size() + src.size(), src.begin());
 
     /* read the frame's type (e.g. IPv4, ARP, or something else) */
-    type = p.u16();
+    type = NetParser::load_u16(fixed + 12);
+    p.remove_prefix(EthernetHeader::LENGTH);
 
     return p.get_error();
 }
 
 string EthernetHeader::serialize() const {
-    string ret;
-    ret.reserve(LENGTH);
+    string ret(LENGTH, 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()));
+    return ret;
+}
 
+void EthernetHeader::serialize_into(uint8_t *out) const {
     /* write destination address */
-    for (auto &byte : dst) {
-        NetUnparser::u8(ret, byte);
-    }
+    copy(dst.begin(), dst.end(), out);
 
     /* write source address */
-    for (auto &byte : src) {
-        NetUnparser::u8(ret, byte);
-    }
+    copy(src.begin(), src.end(), out + dst.size());
 
     /* write the frame's type (e.g. IPv4, ARP or something else) */
-    NetUnparser::u16(ret, type);
-
-    return ret;
+    NetUnparser::store_u16(out + 12, type);
 }
 
 //! \returns A string with a textual representation of an Ethernet address
@@ -1,5 +1,6 @@
 #include "fd_adapter.hh"
 
+#include <arpa/inet.h>
 #include <iostream>
 #include <stdexcept>
 #include <utility>
@@ -19,7 +20,7 @@ using namespace std;
 //! the result that future outgoing segments go to the sender of the SYN segment.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
-    auto datagram = _sock.recv();
+    auto datagram = _sock.recv_packet();
 
     // is it for us?
     if (not listening() and (datagram.source_address != config().destination)) {
@@ -53,5 +54,36 @@ void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     _sock.sendto(config().destination, seg.serialize(0));
 }
 
+//! \details For TCP over UDP, the "addresses and ports" of the four-tuple are those of the UDP
+//! endpoints: the local side is the configured source address, and the remote side is the address
+//! the datagram came from. The port numbers inside the TCP header are ignored on receipt.
+//! \returns a std::optional<TaggedSegment> that is empty if the payload was not a valid TCP segment
+optional<TaggedSegment> TCPOverUDPSocketAdapter::read_tagged() {
+    auto datagram = _sock.recv_packet();
+
+    TaggedSegment ret;
+    if (ParseResult::NoError != ret.segment.parse(move(datagram.payload), 0)) {
+        return {};
+    }
+
+    const auto [remote_ip, remote_port] = datagram.source_address.ip_port();
+    ret.tuple = {
+        config().source.ipv4_numeric(), Address(remote_ip).ipv4_numeric(), config().source.port(), remote_port};
+    return ret;
+}
+
+//! \param[in] tagged is the TCP segment to write, and the connection (UDP endpoints) it belongs to
+void TCPOverUDPSocketAdapter::write_tagged(TaggedSegment &tagged) {
+    tagged.segment.header().sport = tagged.tuple.local_port;
+    tagged.segment.header().dport = tagged.tuple.remote_port;
+
+    sockaddr_in destination{};
+    destination.sin_family = AF_INET;
+    destination.sin_addr.s_addr = htobe32(tagged.tuple.remote_address);
+    destination.sin_port = htobe16(tagged.tuple.remote_port);
+
+    _sock.sendto({reinterpret_cast<sockaddr *>(&destination), sizeof(destination)}, tagged.segment.serialize(0));
+}
+
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
 template class LossyFdAdapter<TCPOverUDPSocketAdapter>;
@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "four_tuple.hh"
 #include "lossy_fd_adapter.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
@@ -57,6 +58,12 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
     //! Writes a TCP segment into a UDP payload
     void write(TCPSegment &seg);
 
+    //! Attempts to read and return a TCP segment of any connection from a UDP payload
+    std::optional<TaggedSegment> read_tagged();
+
+    //! Writes a TCP segment of the given connection into a UDP payload sent to the remote side of its tuple
+    void write_tagged(TaggedSegment &tagged);
+
     //! Access the underlying UDP socket
     operator UDPSocket &() { return _sock; }
 
@@ -0,0 +1,23 @@
+#include "four_tuple.hh"
+
+#include "address.hh"
+
+using namespace std;
+
+string FourTuple::to_string() const {
+    return Address::from_ipv4_numeric(local_address).ip() + ":" + ::to_string(local_port) + " <-> " +
+           Address::from_ipv4_numeric(remote_address).ip() + ":" + ::to_string(remote_port);
+}
+
+//! \details Packs the tuple into two 64-bit words and mixes them with the 64-bit finalizer
+//! from MurmurHash3, so that tuples differing only in the low bits of a port spread across buckets.
+size_t FourTupleHash::operator()(const FourTuple &tuple) const {
+    uint64_t h = (uint64_t(tuple.local_address) << 32) | tuple.remote_address;
+    h ^= ((uint64_t(tuple.local_port) << 16) | tuple.remote_port) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,43 @@
+#ifndef SPONGE_LIBSPONGE_FOUR_TUPLE_HH
+#define SPONGE_LIBSPONGE_FOUR_TUPLE_HH
+
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//! \brief Identifies a TCP connection by its local and remote addresses and ports
+//! \note Addresses and ports are always stored from the local endpoint's point of view,
+//! so the tuple of an incoming segment has its destination as the local side.
+struct FourTuple {
+    uint32_t local_address = 0;   //!< local IPv4 address, in host byte order
+    uint32_t remote_address = 0;  //!< remote IPv4 address, in host byte order
+    uint16_t local_port = 0;      //!< local TCP port
+    uint16_t remote_port = 0;     //!< remote TCP port
+
+    bool operator==(const FourTuple &other) const {
+        return local_address == other.local_address and remote_address == other.remote_address and
+               local_port == other.local_port and remote_port == other.remote_port;
+    }
+
+    bool operator!=(const FourTuple &other) const { return not operator==(other); }
+
+    //! Human-readable form, e.g. "169.254.144.9:80 <-> 169.254.144.1:5555"
+    std::string to_string() const;
+};
+
+//! Hash functor so that a FourTuple can key an std::unordered_map
+struct FourTupleHash {
+    size_t operator()(const FourTuple &tuple) const;
+};
+
+//! \brief A TCP segment together with the connection it belongs to
+//! \details Produced by the `read_tagged()` method of the FD adapters and consumed by their `write_tagged()`;
+//! used to multiplex many connections over one adapter (see TCPDemultiplexer).
+struct TaggedSegment {
+    FourTuple tuple{};     //!< the connection, from the local endpoint's point of view
+    TCPSegment segment{};  //!< the segment itself
+};
+
+#endif  // SPONGE_LIBSPONGE_FOUR_TUPLE_HH
@@ -3,20 +3,33 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <array>
 #include <stdexcept>
 #include <string>
+#include <utility>
 
 using namespace std;
 
-ParseResult IPv4Datagram::parse(const Buffer buffer) {
-    NetParser p{buffer};
-    _header.parse(p);
-    _payload = p.buffer();
+//! Are the headers the same, except perhaps for their TTL and checksum?
+static bool same_except_ttl(const IPv4Header &a, const IPv4Header &b) {
+    return a.ver == b.ver and a.hlen == b.hlen and a.tos == b.tos and a.len == b.len and a.id == b.id and
+           a.df == b.df and a.mf == b.mf and a.offset == b.offset and a.proto == b.proto and a.src == b.src and
+           a.dst == b.dst;
+}
+
+ParseResult IPv4Datagram::parse(Buffer buffer) {
+    NetParser p{move(buffer)};
+    _parsed_header.reset();
+    const ParseResult header_result = _header.parse(p);
+    _payload = p.take_buffer();
 
     if (_payload.size() != _header.payload_length()) {
         return ParseResult::PacketTooShort;
     }
 
+    if (header_result == ParseResult::NoError and _header.hlen * 4 == IPv4Header::LENGTH) {
+        _parsed_header = _header;
+    }
     return p.get_error();
 }
 
@@ -26,13 +39,31 @@ BufferList IPv4Datagram::serialize() const {
     }
 
     IPv4Header header_out = _header;
-    header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
+    if (_parsed_header and same_except_ttl(header_out, _parsed_header.value())) {
+        // only the TTL can have changed since the checksum was verified: update it (RFC 1624)
+        const IPv4Header &parsed = _parsed_header.value();
+        const uint16_t old_word = (parsed.ttl << 8) | parsed.proto;
+        const uint16_t new_word = (header_out.ttl << 8) | header_out.proto;
+        header_out.cksum = InternetChecksum::update(parsed.cksum, old_word, new_word);
+    } else {
+        header_out.cksum = 0;
+        array<uint8_t, 60> header_zero_checksum;
+        header_out.serialize_into(header_zero_checksum.data());
 
-    // calculate checksum -- taken over header only
-    InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
+        // calculate checksum -- taken over header only
+        InternetChecksum check;
+        check.add({reinterpret_cast<const char *>(header_zero_checksum.data()), 4 * size_t(header_out.hlen)});
+        header_out.cksum = check.value();
+    }
+
+    // prepend the header in place if the payload left room for it in front (see TCPSegment::serialize())
+    if (_payload.buffers().size() == 1) {
+        Buffer packet = _payload.buffers().front();
+        if (uint8_t *out = packet.claim_headroom(4 * header_out.hlen)) {
+            header_out.serialize_into(out);
+            return packet;
+        }
+    }
 
     BufferList ret;
     ret.append(header_out.serialize());
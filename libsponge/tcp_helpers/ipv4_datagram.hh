@@ -4,15 +4,21 @@
 #include "buffer.hh"
 #include "ipv4_header.hh"
 
+#include <optional>
+
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram
 class IPv4Datagram {
   private:
     IPv4Header _header{};
     BufferList _payload{};
 
+    //! the header as parsed (with a verified checksum), so that serialize() can update the checksum
+    //! instead of recomputing it when only the TTL has changed since (as when forwarding)
+    std::optional<IPv4Header> _parsed_header{};
+
   public:
     //! \brief Parse the segment from a string
-    ParseResult parse(const Buffer buffer);
+    ParseResult parse(Buffer buffer);
 
     //! \brief Serialize the segment to a string
     BufferList serialize() const;
@@ -2,6 +2,7 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <iomanip>
 #include <sstream>
@@ -24,27 +25,29 @@ ParseResult IPv4Header::parse(NetParser &p) {
     Buffer original_serialized_version = p.buffer();
 
     const size_t data_size = p.buffer().size();
-    if (data_size < IPv4Header::LENGTH) {
+
+    // check the length once, then decode the fixed-size header in place
+    const uint8_t *fixed = p.peek(IPv4Header::LENGTH);
+    if (not fixed) {
         return ParseResult::PacketTooShort;
     }
+    ver = fixed[0] >> 4;                   // version
+    hlen = fixed[0] & 0x0f;                // header length
+    tos = fixed[1];                        // type of service
+    len = NetParser::load_u16(fixed + 2);  // length
+    id = NetParser::load_u16(fixed + 4);   // id
 
-    const uint8_t first_byte = p.u8();
-    ver = first_byte >> 4;     // version
-    hlen = first_byte & 0x0f;  // header length
-    tos = p.u8();              // type of service
-    len = p.u16();             // length
-    id = p.u16();              // id
-
-    const uint16_t fo_val = p.u16();
+    const uint16_t fo_val = NetParser::load_u16(fixed + 6);
     df = static_cast<bool>(fo_val & 0x4000);  // don't fragment
     mf = static_cast<bool>(fo_val & 0x2000);  // more fragments
     offset = fo_val & 0x1fff;                 // offset
 
-    ttl = p.u8();     // ttl
-    proto = p.u8();   // proto
-    cksum = p.u16();  // checksum
-    src = p.u32();    // source address
-    dst = p.u32();    // destination address
+    ttl = fixed[8];                           // ttl
+    proto = fixed[9];                         // proto
+    cksum = NetParser::load_u16(fixed + 10);  // checksum
+    src = NetParser::load_u32(fixed + 12);    // source address
+    dst = NetParser::load_u32(fixed + 16);    // destination address
+    p.remove_prefix(IPv4Header::LENGTH);
 
     if (data_size < 4 * hlen) {
         return ParseResult::PacketTooShort;
@@ -76,6 +79,13 @@ ParseResult IPv4Header::parse(NetParser &p) {
 
 //! Serialize the IPv4Header to a string (does not recompute the checksum)
 string IPv4Header::serialize() const {
+    string ret(4 * max<size_t>(hlen, 5), 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()));
+    return ret;
+}
+
+//! \param[out] out is where to write the header (does not recompute the checksum)
+void IPv4Header::serialize_into(uint8_t *out) const {
     // sanity checks
     if (ver != 4) {
         throw runtime_error("wrong IP version");
@@ -84,29 +94,30 @@ string IPv4Header::serialize() const {
         throw runtime_error("IP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * hlen);
-
-    const uint8_t first_byte = (ver << 4) | (hlen & 0xf);
-    NetUnparser::u8(ret, first_byte);  // version and header length
-    NetUnparser::u8(ret, tos);         // type of service
-    NetUnparser::u16(ret, len);        // length
-    NetUnparser::u16(ret, id);         // id
+    out[0] = (ver << 4) | (hlen & 0xf);    // version and header length
+    out[1] = tos;                          // type of service
+    NetUnparser::store_u16(out + 2, len);  // length
+    NetUnparser::store_u16(out + 4, id);   // id
 
     const uint16_t fo_val = (df ? 0x4000 : 0) | (mf ? 0x2000 : 0) | (offset & 0x1fff);
-    NetUnparser::u16(ret, fo_val);  // flags and offset
+    NetUnparser::store_u16(out + 6, fo_val);  // flags and offset
 
-    NetUnparser::u8(ret, ttl);    // time to live
-    NetUnparser::u8(ret, proto);  // protocol number
+    out[8] = ttl;    // time to live
+    out[9] = proto;  // protocol number
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    NetUnparser::store_u16(out + 10, cksum);  // checksum
 
-    NetUnparser::u32(ret, src);  // src address
-    NetUnparser::u32(ret, dst);  // dst address
+    NetUnparser::store_u32(out + 12, src);  // src address
+    NetUnparser::store_u32(out + 16, dst);  // dst address
 
-    ret.resize(4 * hlen);  // expand header to advertised size
+    fill(out + IPv4Header::LENGTH, out + 4 * hlen, 0);  // expand header to advertised size
+}
 
-    return ret;
+//! \details TTL shares a 16-bit word of the header with the protocol number.
+void IPv4Header::decrement_ttl() {
+    const uint16_t old_word = (ttl << 8) | proto;
+    --ttl;
+    cksum = InternetChecksum::update(cksum, old_word, (ttl << 8) | proto);
 }
 
 uint16_t IPv4Header::payload_length() const { return len - 4 * hlen; }
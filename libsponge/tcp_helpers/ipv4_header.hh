@@ -52,6 +52,12 @@ struct IPv4Header {
     //! Serialize the IP fields
     std::string serialize() const;
 
+    //! Serialize the IP fields to the `4 * hlen` bytes at `out` (options are zeroed)
+    void serialize_into(uint8_t *out) const;
+
+    //! Decrement `ttl`, updating `cksum` incrementally (it stays right if it was right)
+    void decrement_ttl();
+
     //! Length of the payload
     uint16_t payload_length() const;
 
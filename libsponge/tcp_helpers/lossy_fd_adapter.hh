@@ -56,6 +56,27 @@ class LossyFdAdapter {
         return _adapter.write(seg);
     }
 
+    //! \brief Read a tagged segment from the underlying AdapterT instance, potentially dropping it
+    //! \returns std::optional<TaggedSegment> that is empty if the segment was dropped or if
+    //!          the underlying AdapterT returned an empty value
+    auto read_tagged() {
+        auto ret = _adapter.read_tagged();
+        if (_should_drop(false)) {
+            return decltype(ret){};
+        }
+        return ret;
+    }
+
+    //! \brief Write a tagged segment to the underlying AdapterT instance, potentially dropping it
+    //! \param[in] tagged is the packet to either write or drop
+    template <typename TaggedT>
+    void write_tagged(TaggedT &tagged) {
+        if (_should_drop(true)) {
+            return;
+        }
+        return _adapter.write_tagged(tagged);
+    }
+
     //! \name
     //! Passthrough functions to the underlying AdapterT instance
 
@@ -0,0 +1,60 @@
+#ifndef SPONGE_LIBSPONGE_PACKET_VIEW_HH
+#define SPONGE_LIBSPONGE_PACKET_VIEW_HH
+
+#include "ipv4_header.hh"
+#include "parser.hh"
+
+#include <cstdint>
+#include <string_view>
+
+//! \brief A read-only view of the addressing fields of a raw IPv4 datagram
+//! \details Reads the addresses, the protocol and (for an unfragmented TCP or UDP datagram) the ports
+//! straight from the bytes, without parsing or checksumming anything, so that datagrams for other
+//! hosts or connections can be dropped before an IPv4Datagram or TCPSegment is built for them.
+//! A datagram that passes the filter still has to be parsed (and its checksums verified).
+class PacketView {
+  private:
+    std::string_view _data;
+    size_t _header_length{0};  //!< 0 unless the view holds at least a whole IPv4 header
+
+    const uint8_t *_bytes() const { return reinterpret_cast<const uint8_t *>(_data.data()); }
+
+  public:
+    //! Protocol number for UDP
+    static constexpr uint8_t PROTO_UDP = 17;
+
+    //! \param[in] datagram is the raw datagram, which must outlive the view
+    explicit PacketView(const std::string_view datagram) : _data(datagram) {
+        if (_data.size() >= IPv4Header::LENGTH and (_bytes()[0] >> 4) == 4) {
+            const size_t header_length = 4 * size_t(_bytes()[0] & 0x0f);
+            if (header_length >= IPv4Header::LENGTH and header_length <= _data.size()) {
+                _header_length = header_length;
+            }
+        }
+    }
+
+    //! Whether the view holds a whole IPv4 header (if not, no other accessor may be used)
+    bool is_ipv4() const { return _header_length != 0; }
+
+    //! \name IPv4 header fields
+    //!@{
+    uint8_t proto() const { return _bytes()[9]; }
+    uint32_t src() const { return NetParser::load_u32(_bytes() + 12); }
+    uint32_t dst() const { return NetParser::load_u32(_bytes() + 16); }
+    //!@}
+
+    //! Whether the datagram starts a TCP or UDP header whose ports are within the view
+    bool has_ports() const {
+        const bool first_fragment = (NetParser::load_u16(_bytes() + 6) & 0x1fff) == 0;
+        return (proto() == IPv4Header::PROTO_TCP or proto() == PROTO_UDP) and first_fragment and
+               _data.size() >= _header_length + 4;
+    }
+
+    //! \name Ports of a TCP or UDP datagram (only if has_ports())
+    //!@{
+    uint16_t sport() const { return NetParser::load_u16(_bytes() + _header_length); }
+    uint16_t dport() const { return NetParser::load_u16(_bytes() + _header_length + 2); }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_PACKET_VIEW_HH
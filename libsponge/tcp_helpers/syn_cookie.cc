@@ -0,0 +1,63 @@
+#include "syn_cookie.hh"
+
+#include <cstring>
+#include <string_view>
+
+using namespace std;
+
+static constexpr uint32_t COUNTER_BITS = 5;
+static constexpr uint32_t MSS_BITS = 2;
+static constexpr uint32_t MAC_BITS = 32 - COUNTER_BITS - MSS_BITS;
+static constexpr uint32_t MAC_MASK = (1u << MAC_BITS) - 1;
+static constexpr uint32_t COUNTER_MASK = (1u << COUNTER_BITS) - 1;
+
+static uint32_t counter_at(const uint64_t now_ms) {
+    return (now_ms / SynCookies::COUNTER_PERIOD_MS) & COUNTER_MASK;
+}
+
+uint32_t SynCookies::_mac(const FourTuple &tuple,
+                          const WrappingInt32 peer_isn,
+                          const uint32_t counter,
+                          const uint32_t mss_index) const {
+    const uint32_t words[5] = {tuple.local_address,
+                               tuple.remote_address,
+                               (uint32_t(tuple.local_port) << 16) | tuple.remote_port,
+                               peer_isn.raw_value(),
+                               (counter << MSS_BITS) | mss_index};
+    char input[sizeof(words)];
+    memcpy(input, words, sizeof(words));
+    return _hash({input, sizeof(input)}) & MAC_MASK;
+}
+
+WrappingInt32 SynCookies::make(const FourTuple &tuple,
+                               const WrappingInt32 peer_isn,
+                               const uint16_t peer_mss,
+                               const uint64_t now_ms) const {
+    uint32_t mss_index = 0;
+    while (mss_index + 1 < MSS_TABLE.size() and MSS_TABLE[mss_index + 1] <= peer_mss) {
+        ++mss_index;
+    }
+
+    const uint32_t counter = counter_at(now_ms);
+    return WrappingInt32{(counter << (MSS_BITS + MAC_BITS)) | (mss_index << MAC_BITS) |
+                         _mac(tuple, peer_isn, counter, mss_index)};
+}
+
+optional<uint16_t> SynCookies::check(const FourTuple &tuple,
+                                     const WrappingInt32 peer_isn,
+                                     const WrappingInt32 cookie,
+                                     const uint64_t now_ms) const {
+    const uint32_t counter = cookie.raw_value() >> (MSS_BITS + MAC_BITS);
+    const uint32_t mss_index = (cookie.raw_value() >> MAC_BITS) & ((1u << MSS_BITS) - 1);
+
+    // the counter wraps around, so compare its age modulo its range
+    const uint32_t age = (counter_at(now_ms) - counter) & COUNTER_MASK;
+    if (age > 1) {
+        return {};
+    }
+
+    if ((cookie.raw_value() & MAC_MASK) != _mac(tuple, peer_isn, counter, mss_index)) {
+        return {};
+    }
+    return MSS_TABLE[mss_index];
+}
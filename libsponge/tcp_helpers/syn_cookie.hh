@@ -0,0 +1,69 @@
+#ifndef SPONGE_LIBSPONGE_SYN_COOKIE_HH
+#define SPONGE_LIBSPONGE_SYN_COOKIE_HH
+
+#include "four_tuple.hh"
+#include "siphash.hh"
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+//! \brief Makes and checks SYN cookies: initial sequence numbers that encode a listener's half-open state
+//! \details A listener that answers a SYN with a cookie as its ISN does not need to remember the SYN:
+//! the peer's ACK of the SYN-ACK carries the cookie back (as ackno - 1), along with the peer's own
+//! ISN (as seqno - 1), and the listener can check that it made the cookie for this connection.
+//!
+//! The 32 bits of a cookie are
+//!
+//!     | time counter (5) | MSS index (2) | keyed hash (25) |
+//!
+//! where the time counter advances every COUNTER_PERIOD_MS, the MSS index picks one of MSS_TABLE,
+//! and the hash (SipHash under a secret key) covers the 4-tuple, the peer's ISN, the counter and the
+//! MSS index. A cookie is accepted while its counter is at most one period old.
+class SynCookies {
+  public:
+    //! How long each value of the time counter lasts
+    static constexpr uint64_t COUNTER_PERIOD_MS = 64000;
+
+    //! MSS values that a cookie can encode (the largest that does not exceed the peer's is chosen)
+    static constexpr std::array<uint16_t, 4> MSS_TABLE = {536, 1000, 1220, 1460};
+
+    //! MSS of a peer whose SYN announces none ([RFC 1122](\ref rfc::rfc1122), section 4.2.2.6)
+    static constexpr uint16_t DEFAULT_PEER_MSS = 536;
+
+  private:
+    SipHash _hash;
+
+    uint32_t _mac(const FourTuple &tuple,
+                  const WrappingInt32 peer_isn,
+                  const uint32_t counter,
+                  const uint32_t mss_index) const;
+
+  public:
+    //! \param[in] key is the secret key; a listener should use a random one (the default)
+    explicit SynCookies(const SipHash::Key &key = SipHash::random_key()) : _hash(key) {}
+
+    //! \brief The ISN with which to answer a SYN
+    //! \param[in] tuple is the connection that the SYN asks for
+    //! \param[in] peer_isn is the SYN's sequence number
+    //! \param[in] peer_mss is the MSS that the peer announced (or the default one)
+    //! \param[in] now_ms is the current time
+    WrappingInt32 make(const FourTuple &tuple,
+                       const WrappingInt32 peer_isn,
+                       const uint16_t peer_mss,
+                       const uint64_t now_ms) const;
+
+    //! \brief Check the cookie echoed by an ACK
+    //! \param[in] tuple is the connection that the ACK belongs to
+    //! \param[in] peer_isn is the ACK's sequence number minus one
+    //! \param[in] cookie is the ACK's acknowledgment number minus one
+    //! \param[in] now_ms is the current time
+    //! \returns the MSS encoded in the cookie, or an empty std::optional if the cookie is invalid or expired
+    std::optional<uint16_t> check(const FourTuple &tuple,
+                                  const WrappingInt32 peer_isn,
+                                  const WrappingInt32 cookie,
+                                  const uint64_t now_ms) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_SYN_COOKIE_HH
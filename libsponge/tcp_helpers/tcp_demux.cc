@@ -0,0 +1,364 @@
+#include "tcp_demux.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+using namespace std;
+
+TCPDemultiplexer::ConnectionMap::iterator TCPDemultiplexer::_find(const FourTuple &tuple) {
+    const auto it = _connections.find(tuple);
+    if (it == _connections.end()) {
+        throw runtime_error("TCPDemultiplexer: no connection " + tuple.to_string());
+    }
+    return it;
+}
+
+TCPDemultiplexer::ConnectionMap::const_iterator TCPDemultiplexer::_find(const FourTuple &tuple) const {
+    const auto it = _connections.find(tuple);
+    if (it == _connections.end()) {
+        throw runtime_error("TCPDemultiplexer: no connection " + tuple.to_string());
+    }
+    return it;
+}
+
+//! \details An embryonic connection becomes Queued once its SYN has been acknowledged. Connections
+//! that are no longer active are removed, unless the application still owns them (it may still
+//! want to read what is left in the inbound stream); those are removed by release().
+TCPDemultiplexer::ConnectionMap::iterator TCPDemultiplexer::_service(ConnectionMap::iterator it) {
+    Entry &entry = it->second;
+    auto &segments = entry.connection.segments_out();
+    while (not segments.empty()) {
+        _segments_out.push({it->first, move(segments.front())});
+        segments.pop();
+    }
+
+    if (entry.state == EntryState::Embryonic and entry.connection.active() and
+        entry.connection.bytes_in_flight() == 0) {
+        entry.state = EntryState::Queued;
+        --_embryonic;
+        ++_queued;
+        _accept_queue.push(it->first);
+    }
+
+    if (entry.state == EntryState::Released and entry.connection.lingering()) {
+        _enter_time_wait(it->first, entry);
+    }
+
+    if (entry.connection.active() or entry.state == EntryState::Accepted) {
+        return next(it);
+    }
+
+    if (entry.state == EntryState::Embryonic) {
+        --_embryonic;
+    } else if (entry.state == EntryState::Queued) {
+        --_queued;
+    }
+    return _connections.erase(it);
+}
+
+//! \details Follows the reset generation rules of RFC 793 (p. 36): if the offending segment
+//! carries an ACK, the RST takes its sequence number from that ackno; otherwise the RST has
+//! sequence number zero and acknowledges everything the segment occupied.
+void TCPDemultiplexer::_send_reset(const TaggedSegment &tagged) {
+    const TCPHeader &in = tagged.segment.header();
+
+    TaggedSegment rst;
+    rst.tuple = tagged.tuple;
+    TCPHeader &out = rst.segment.header();
+    out.rst = true;
+    if (in.ack) {
+        out.seqno = in.ackno;
+    } else {
+        out.ack = true;
+        out.ackno = in.seqno + tagged.segment.length_in_sequence_space();
+    }
+
+    _segments_out.push(move(rst));
+}
+
+void TCPDemultiplexer::_tick(Entry &entry) {
+    entry.connection.tick(_now - entry.last_tick);
+    entry.last_tick = _now;
+}
+
+//! \details The record expires when the connection would have stopped lingering: 10 * rt_timeout
+//! after the last segment it received (the connection may not have been ticked up to `_now`).
+void TCPDemultiplexer::_enter_time_wait(const FourTuple &tuple, Entry &entry) {
+    TCPConnection &connection = entry.connection;
+    const uint64_t linger_ms = 10 * uint64_t(_cfg.rt_timeout);
+    const uint64_t since_last =
+        min<uint64_t>(connection.time_since_last_segment_received() + (_now - entry.last_tick), linger_ms);
+    const uint64_t deadline = _now + linger_ms - since_last;
+
+    _time_wait.insert_or_assign(tuple,
+                                TimeWaitRecord{connection.next_seqno(),
+                                               connection.ackno().value(),
+                                               uint16_t(min<size_t>(connection.window_size(), UINT16_MAX)),
+                                               deadline});
+    _time_wait_expiry.emplace(deadline, tuple);
+    connection.stop_lingering();
+}
+
+//! \details Follows RFC 793's TIME-WAIT rules: a RST ends TIME_WAIT, and a retransmitted FIN (or anything
+//! else that occupies sequence space) is acknowledged again and restarts the linger time. A new SYN
+//! whose sequence number is beyond the old connection's is allowed to open a new incarnation
+//! (as in RFC 1122, 4.2.2.13).
+bool TCPDemultiplexer::_time_wait_received(const TaggedSegment &tagged) {
+    const auto it = _time_wait.find(tagged.tuple);
+    if (it == _time_wait.end()) {
+        return false;
+    }
+
+    const TCPHeader &header = tagged.segment.header();
+    TimeWaitRecord &record = it->second;
+
+    if (header.rst) {
+        _time_wait.erase(it);
+        return true;
+    }
+
+    if (header.syn and not header.ack and _listening_ports.count(tagged.tuple.local_port) and
+        header.seqno - record.rcv_nxt > 0) {
+        _time_wait.erase(it);
+        return false;
+    }
+
+    if (tagged.segment.length_in_sequence_space() > 0) {
+        TaggedSegment ack;
+        ack.tuple = tagged.tuple;
+        ack.segment.header().seqno = record.snd_nxt;
+        ack.segment.header().ack = true;
+        ack.segment.header().ackno = record.rcv_nxt;
+        ack.segment.header().win = record.win;
+        _segments_out.push(move(ack));
+
+        record.deadline = _now + 10 * uint64_t(_cfg.rt_timeout);
+        _time_wait_expiry.emplace(record.deadline, tagged.tuple);
+    }
+    return true;
+}
+
+void TCPDemultiplexer::_expire_time_wait() {
+    while (not _time_wait_expiry.empty() and _time_wait_expiry.top().first <= _now) {
+        const auto it = _time_wait.find(_time_wait_expiry.top().second);
+        if (it != _time_wait.end() and it->second.deadline <= _now) {
+            _time_wait.erase(it);
+        }
+        _time_wait_expiry.pop();
+    }
+}
+
+//! \details The SYN-ACK is what the connection would have sent in SYN_RCVD, except that its ISN is a
+//! cookie, which records the MSS that the SYN announced (or SynCookies::DEFAULT_PEER_MSS if it has none).
+void TCPDemultiplexer::_send_syn_cookie(const TaggedSegment &syn) {
+    const TCPHeader &in = syn.segment.header();
+
+    TaggedSegment synack;
+    synack.tuple = syn.tuple;
+    TCPHeader &out = synack.segment.header();
+    out.syn = true;
+    const uint16_t peer_mss = in.options.mss().value_or(SynCookies::DEFAULT_PEER_MSS);
+    out.seqno = _syn_cookies.make(syn.tuple, in.seqno, peer_mss, timestamp_ms());
+    out.ack = true;
+    out.ackno = in.seqno + 1;
+    out.win = min<size_t>(_cfg.recv_capacity, numeric_limits<uint16_t>::max());
+
+    _segments_out.push(move(synack));
+    ++_syn_cookies_sent;
+}
+
+//! \details The connection is given the cookie as its fixed ISN and brought to SYN_RCVD by replaying
+//! the peer's SYN (reconstructed from the ACK, with the MSS that the cookie recorded); the SYN-ACK that
+//! it generates in reply was already sent, so it is discarded. The ACK itself (and any data it carries)
+//! then completes the handshake.
+bool TCPDemultiplexer::_open_from_syn_cookie(const TaggedSegment &ack) {
+    const TCPHeader &header = ack.segment.header();
+    const WrappingInt32 peer_isn = header.seqno - 1;
+    const WrappingInt32 cookie = header.ackno - 1;
+    const auto peer_mss = _syn_cookies.check(ack.tuple, peer_isn, cookie, timestamp_ms());
+    if (not peer_mss.has_value()) {
+        return false;
+    }
+
+    TCPConfig cfg = _cfg;
+    cfg.fixed_isn = cookie;
+    const auto it = _connections
+                        .emplace(piecewise_construct,
+                                 forward_as_tuple(ack.tuple),
+                                 forward_as_tuple(cfg, EntryState::Embryonic, _now))
+                        .first;
+    ++_embryonic;
+    ++_syn_cookies_validated;
+
+    TCPConnection &connection = it->second.connection;
+    TCPSegment syn;
+    syn.header().syn = true;
+    syn.header().seqno = peer_isn;
+    syn.header().options.add_mss(peer_mss.value());
+    connection.segment_received(syn);
+    connection.segments_out() = {};
+
+    connection.segment_received(ack.segment);
+    _service(it);
+    return true;
+}
+
+//! \details A segment for an unknown tuple creates a connection only if it is a SYN (without ACK)
+//! addressed to a listening port. If the backlog is full, such a SYN is silently dropped so that
+//! the peer retransmits it later, unless SYN cookies are in use. With SYN cookies, an ACK for an
+//! unknown tuple on a listening port may also create a connection, if it echoes a valid cookie.
+//! Any other unknown segment is answered with a RST (unless it is one).
+void TCPDemultiplexer::segment_received(TaggedSegment &&tagged) {
+    _expire_time_wait();
+
+    auto it = _connections.find(tagged.tuple);
+    if (it == _connections.end()) {
+        if (_time_wait_received(tagged)) {
+            return;
+        }
+
+        const TCPHeader &header = tagged.segment.header();
+        if (header.rst) {
+            return;
+        }
+
+        const bool listening = _listening_ports.count(tagged.tuple.local_port);
+        const bool backlog_full = _embryonic + _queued >= _backlog;
+
+        if (listening and header.ack and not header.syn and _syn_cookie_mode != SynCookieMode::Never) {
+            if (backlog_full or _open_from_syn_cookie(tagged)) {
+                return;
+            }
+        }
+
+        if (not listening or not header.syn or header.ack) {
+            _send_reset(tagged);
+            return;
+        }
+
+        if (_syn_cookie_mode == SynCookieMode::Always or
+            (_syn_cookie_mode == SynCookieMode::WhenBacklogFull and backlog_full)) {
+            _send_syn_cookie(tagged);
+            return;
+        }
+
+        if (backlog_full) {
+            return;
+        }
+
+        it = _connections
+                 .emplace(piecewise_construct,
+                          forward_as_tuple(tagged.tuple),
+                          forward_as_tuple(_cfg, EntryState::Embryonic, _now))
+                 .first;
+        ++_embryonic;
+    }
+
+    it->second.connection.segment_received(tagged.segment);
+    _service(it);
+}
+
+//! \param[in] ms_since_last_tick number of milliseconds since the last call to either tick() or advance()
+void TCPDemultiplexer::tick(const size_t ms_since_last_tick) {
+    advance(ms_since_last_tick);
+    for (auto it = _connections.begin(); it != _connections.end();) {
+        _tick(it->second);
+        it = _service(it);
+    }
+}
+
+//! \param[in] tuple identifies the connection to tick
+//! \param[in] tuple identifies the connection to tick
+//! \param[in] ms_since_last_tick number of milliseconds since the last call to either tick() or advance()
+void TCPDemultiplexer::tick(const FourTuple &tuple, const size_t ms_since_last_tick) {
+    const auto it = _find(tuple);
+    advance(ms_since_last_tick);
+    _tick(it->second);
+    _service(it);
+}
+
+//! \param[in] ms_since_last_tick number of milliseconds since the last call to either tick() or advance()
+void TCPDemultiplexer::advance(const size_t ms_since_last_tick) {
+    _now += ms_since_last_tick;
+    _expire_time_wait();
+}
+
+//! \details May be earlier than needed (the earliest deadline may have been moved), never later.
+optional<uint64_t> TCPDemultiplexer::time_wait_timeout() const {
+    if (_time_wait_expiry.empty()) {
+        return {};
+    }
+    const uint64_t deadline = _time_wait_expiry.top().first;
+    return deadline > _now ? deadline - _now : 0;
+}
+
+void TCPDemultiplexer::connect(const FourTuple &tuple) {
+    if (_connections.count(tuple)) {
+        throw runtime_error("TCPDemultiplexer: connection " + tuple.to_string() + " already exists");
+    }
+
+    const auto it =
+        _connections
+            .emplace(piecewise_construct, forward_as_tuple(tuple), forward_as_tuple(_cfg, EntryState::Accepted, _now))
+            .first;
+    it->second.connection.connect();
+    _service(it);
+}
+
+//! \returns the tuple of the accepted connection, or an empty std::optional if none is ready
+optional<FourTuple> TCPDemultiplexer::accept() {
+    while (not _accept_queue.empty()) {
+        const FourTuple tuple = _accept_queue.front();
+        _accept_queue.pop();
+
+        // skip tuples of connections that were reset (and reaped) while waiting in the queue
+        const auto it = _connections.find(tuple);
+        if (it != _connections.end() and it->second.state == EntryState::Queued) {
+            it->second.state = EntryState::Accepted;
+            --_queued;
+            return tuple;
+        }
+    }
+    return {};
+}
+
+//! \returns the number of bytes from `data` that were actually written
+size_t TCPDemultiplexer::write(const FourTuple &tuple, const string &data) {
+    const auto it = _find(tuple);
+    const size_t written = it->second.connection.write(data);
+    _service(it);
+    return written;
+}
+
+void TCPDemultiplexer::end_input_stream(const FourTuple &tuple) {
+    const auto it = _find(tuple);
+    it->second.connection.end_input_stream();
+    _service(it);
+}
+
+ByteStream &TCPDemultiplexer::inbound_stream(const FourTuple &tuple) {
+    return _find(tuple)->second.connection.inbound_stream();
+}
+
+const TCPConnection &TCPDemultiplexer::connection(const FourTuple &tuple) const {
+    return _find(tuple)->second.connection;
+}
+
+void TCPDemultiplexer::release(const FourTuple &tuple) {
+    const auto it = _find(tuple);
+    if (it->second.state != EntryState::Accepted) {
+        throw runtime_error("TCPDemultiplexer: release() of connection " + tuple.to_string() +
+                            " not owned by the application");
+    }
+
+    it->second.state = EntryState::Released;
+    if (it->second.connection.active()) {
+        it->second.connection.end_input_stream();
+    }
+    _service(it);
+}
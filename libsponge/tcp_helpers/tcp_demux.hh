@@ -0,0 +1,221 @@
+#ifndef SPONGE_LIBSPONGE_TCP_DEMUX_HH
+#define SPONGE_LIBSPONGE_TCP_DEMUX_HH
+
+#include "byte_stream.hh"
+#include "four_tuple.hh"
+#include "syn_cookie.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+//! \brief Demultiplexes TCP segments from one adapter to many TCPConnection instances
+//! \details Connections are kept in a hash table keyed by their FourTuple. A SYN addressed to a
+//! listening port creates a new (embryonic) connection, as long as fewer than `backlog` connections
+//! are waiting to be accepted; once its handshake completes the connection is queued for accept().
+//! Segments that belong to no connection are answered with a RST.
+//!
+//! A connection that the application has released and that reaches TIME_WAIT is collapsed into a
+//! compact TimeWaitRecord, which is enough to keep ACKing retransmissions of the peer's FIN until the
+//! linger time (10 * TCPConfig::rt_timeout, as in TCPConnection) has passed.
+//!
+//! Time is what the owner tells tick(): the demultiplexer keeps a clock that both overloads advance,
+//! and brings each connection up to it when it ticks the connection, so an owner may tick only the
+//! connections that need it (see TCPReactor). TIME_WAIT deadlines are on the same clock.
+//!
+//! In SYN-cookie mode (see SynCookieMode), a SYN is instead answered statelessly with a SYN-ACK whose
+//! ISN is a SynCookies cookie, and the connection (with its ByteStreams and reassembler) is only
+//! created once the peer's ACK echoes a valid cookie, so a flood of SYNs costs no memory.
+//!
+//! The demultiplexer does no I/O itself: the owner feeds it with segment_received() and tick(), and
+//! sends whatever it leaves in segments_out() (see TCPListener).
+class TCPDemultiplexer {
+  public:
+    //! Who is responsible for a connection, and what is left to do with it
+    enum class EntryState {
+        Embryonic,  //!< handshake in progress; reaped by the demultiplexer if it fails
+        Queued,     //!< handshake complete; waiting in the accept queue
+        Accepted,   //!< owned by the application (accepted or actively opened)
+        Released    //!< given back by the application; reaped once it is no longer active
+    };
+
+    //! When to answer SYNs with SYN cookies instead of creating embryonic connections
+    enum class SynCookieMode {
+        Never,            //!< never; a SYN that does not fit in the backlog is dropped
+        WhenBacklogFull,  //!< only for SYNs that do not fit in the backlog
+        Always            //!< for every SYN
+    };
+
+  private:
+    struct Entry {
+        TCPConnection connection;
+        EntryState state;
+        uint64_t last_tick;  //!< the clock when the connection was last ticked (or created)
+
+        Entry(const TCPConfig &cfg, const EntryState s, const uint64_t now)
+            : connection(cfg), state(s), last_tick(now) {}
+    };
+
+    using ConnectionMap = std::unordered_map<FourTuple, Entry, FourTupleHash>;
+
+    //! What is left of a connection in TIME_WAIT
+    struct TimeWaitRecord {
+        WrappingInt32 snd_nxt;  //!< sequence number after our FIN
+        WrappingInt32 rcv_nxt;  //!< sequence number after the peer's FIN
+        uint16_t win;           //!< window to advertise
+        uint64_t deadline;      //!< when the record expires (on `_now`)
+    };
+
+    TCPConfig _cfg;
+    size_t _backlog;
+
+    //! the clock: the sum of the times passed to tick() (ms)
+    uint64_t _now{0};
+
+    std::unordered_set<uint16_t> _listening_ports{};
+    ConnectionMap _connections{};
+
+    //! tuples of connections in the Queued state, oldest first (may hold stale tuples of reaped connections)
+    std::queue<FourTuple> _accept_queue{};
+
+    size_t _embryonic{0};  //!< number of connections in the Embryonic state
+    size_t _queued{0};     //!< number of connections in the Queued state
+
+    std::queue<TaggedSegment> _segments_out{};
+
+    std::unordered_map<FourTuple, TimeWaitRecord, FourTupleHash> _time_wait{};
+
+    //! (deadline, tuple) of a TIME_WAIT record
+    using TimeWaitExpiry = std::pair<uint64_t, FourTuple>;
+
+    //! orders `_time_wait_expiry` so that the earliest deadline is on top
+    struct LaterDeadline {
+        bool operator()(const TimeWaitExpiry &a, const TimeWaitExpiry &b) const { return a.first > b.first; }
+    };
+
+    //! deadlines of TIME_WAIT records, earliest first (a record's linger may restart, and a connection
+    //! enters TIME_WAIT with what is left of its own, so they arrive in no order); may hold stale entries
+    std::priority_queue<TimeWaitExpiry, std::vector<TimeWaitExpiry>, LaterDeadline> _time_wait_expiry{};
+
+    SynCookies _syn_cookies{};
+    SynCookieMode _syn_cookie_mode{SynCookieMode::Never};
+    uint64_t _syn_cookies_sent{0};
+    uint64_t _syn_cookies_validated{0};
+
+    //! \throws std::runtime_error if there is no connection with this tuple
+    ConnectionMap::iterator _find(const FourTuple &tuple);
+    ConnectionMap::const_iterator _find(const FourTuple &tuple) const;
+
+    //! move a connection's outbound segments to segments_out(), then advance or reap its entry
+    //! \returns an iterator to the entry following `it` if it was reaped, or else `std::next(it)`
+    ConnectionMap::iterator _service(ConnectionMap::iterator it);
+
+    //! answer a segment that belongs to no connection
+    void _send_reset(const TaggedSegment &tagged);
+
+    //! tick a connection up to `_now`
+    void _tick(Entry &entry);
+
+    //! replace a lingering connection with a TimeWaitRecord
+    void _enter_time_wait(const FourTuple &tuple, Entry &entry);
+
+    //! handle a segment for a tuple in TIME_WAIT
+    //! \returns `true` if the segment was consumed; `false` if it may start a new connection
+    bool _time_wait_received(const TaggedSegment &tagged);
+
+    //! remove TIME_WAIT records whose deadline has passed
+    void _expire_time_wait();
+
+    //! answer a SYN with a SYN-ACK that carries a SYN cookie, without creating a connection
+    void _send_syn_cookie(const TaggedSegment &syn);
+
+    //! if `ack` echoes a valid SYN cookie, create its connection and give it the ACK
+    //! \returns `true` if the connection was created
+    bool _open_from_syn_cookie(const TaggedSegment &ack);
+
+  public:
+    //! \param[in] cfg is the configuration of every TCPConnection created by the demultiplexer
+    //! \param[in] backlog is the maximum number of connections that may be embryonic or waiting for accept()
+    explicit TCPDemultiplexer(const TCPConfig &cfg, const size_t backlog = 16) : _cfg(cfg), _backlog(backlog) {}
+
+    //! Accept connections addressed to `port` (on any local address)
+    void listen(const uint16_t port) { _listening_ports.insert(port); }
+
+    //! Choose when SYNs to listening ports are answered with SYN cookies (default: never)
+    void set_syn_cookie_mode(const SynCookieMode mode) { _syn_cookie_mode = mode; }
+
+    //! Hand a segment read from the network to the connection it belongs to
+    void segment_received(TaggedSegment &&tagged);
+
+    //! \name Passage of time
+    //! `ms_since_last_tick` is the time since the last call to either overload; it advances the clock,
+    //! and TIME_WAIT records whose deadline has passed are removed.
+    //!@{
+
+    //! Called periodically when time elapses; ticks every connection and reaps the finished ones
+    void tick(const size_t ms_since_last_tick);
+
+    //! \brief Tick one connection (which is reaped if it has finished), by all the time since it was last ticked
+    //! \details For owners that tick a connection only when something happens to it (see TCPReactor)
+    //! \throws std::runtime_error if there is no connection with this tuple
+    void tick(const FourTuple &tuple, const size_t ms_since_last_tick);
+
+    //! Advance the clock without ticking any connection (e.g. to let TIME_WAIT records expire)
+    void advance(const size_t ms_since_last_tick);
+    //!@}
+
+    //! Time until the earliest TIME_WAIT record expires, or an empty std::optional if there are none
+    std::optional<uint64_t> time_wait_timeout() const;
+
+    //! \brief Actively open a connection (owned by the application, as if accepted)
+    //! \throws std::runtime_error if a connection with this tuple already exists
+    void connect(const FourTuple &tuple);
+
+    //! \brief Take the oldest connection whose handshake is complete, if any
+    std::optional<FourTuple> accept();
+
+    //! \name Per-connection interface for the application
+    //! \throws std::runtime_error if there is no connection with this tuple
+    //!@{
+    size_t write(const FourTuple &tuple, const std::string &data);
+    void end_input_stream(const FourTuple &tuple);
+    ByteStream &inbound_stream(const FourTuple &tuple);
+    const TCPConnection &connection(const FourTuple &tuple) const;
+
+    //! \brief Give a connection back to the demultiplexer
+    //! \details Its outbound stream is ended (if it was not already) and the connection is removed
+    //! once it is no longer active.
+    void release(const FourTuple &tuple);
+    //!@}
+
+    //! Is there a connection with this tuple?
+    bool contains(const FourTuple &tuple) const { return _connections.count(tuple); }
+
+    //! Number of connections, in any state
+    size_t size() const { return _connections.size(); }
+
+    //! Number of connections waiting for accept()
+    size_t accept_queue_size() const { return _queued; }
+
+    //! Number of connections in TIME_WAIT (kept as compact records, not counted by size())
+    size_t time_wait_size() const { return _time_wait.size(); }
+
+    //! Number of SYNs answered with a SYN cookie
+    uint64_t syn_cookies_sent() const { return _syn_cookies_sent; }
+
+    //! Number of connections created from a valid SYN cookie
+    uint64_t syn_cookies_validated() const { return _syn_cookies_validated; }
+
+    //! Segments (from any connection) that the demultiplexer wants sent
+    std::queue<TaggedSegment> &segments_out() { return _segments_out; }
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_DEMUX_HH
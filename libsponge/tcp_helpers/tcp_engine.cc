@@ -0,0 +1,88 @@
+#include "tcp_engine.hh"
+
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+#include <utility>
+
+using namespace std;
+
+template <typename AdaptT>
+TCPEngine<AdaptT>::TCPEngine(AdaptT &&adapter, const TCPConfig &cfg, const size_t backlog)
+    : _adapter(move(adapter)), _reactor(cfg, backlog, [this] { _wakeup.notify(); }) {
+    // rule 1: read segments of any connection from the adapter and hand them to the reactor
+    _eventloop.add_rule(_adapter, Direction::In, [&] {
+        auto tagged = _adapter.read_tagged();
+        if (tagged) {
+            _reactor.segment_received(move(tagged.value()));
+        }
+    });
+
+    // rule 2: drain wakeups from application threads (their segments are taken below)
+    _eventloop.add_rule(_wakeup, Direction::In, [&] { _wakeup.clear(); });
+
+    // rule 3: send the segments that the connections have enqueued
+    _eventloop.add_rule(_adapter,
+                        Direction::Out,
+                        [&] {
+                            while (not _outbound.empty()) {
+                                _adapter.write_tagged(_outbound.front());
+                                _outbound.pop();
+                            }
+                        },
+                        [&] { return not _outbound.empty(); });
+
+    _thread = thread(&TCPEngine::_main, this);
+}
+
+template <typename AdaptT>
+void TCPEngine<AdaptT>::_main() {
+    try {
+        auto base_time = timestamp_ms();
+        while (not _abort) {
+            _reactor.take_segments(_outbound);
+
+            // sleep until the next timer (or forever), unless there is something to send
+            const int timeout = _outbound.empty() ? _reactor.timeout_ms() : 0;
+            if (_eventloop.wait_next_event(timeout) == EventLoop::Result::Exit) {
+                break;
+            }
+
+            _reactor.expire_timers();
+
+            const auto next_time = timestamp_ms();
+            _adapter.tick(next_time - base_time);
+            base_time = next_time;
+        }
+    } catch (const exception &e) {
+        cerr << "Exception in TCPEngine thread: " << e.what() << "\n";
+    }
+    _reactor.shut_down();
+}
+
+template <typename AdaptT>
+TCPEngine<AdaptT>::~TCPEngine() {
+    try {
+        _abort.store(true);
+        _wakeup.notify();
+        _thread.join();
+    } catch (const exception &e) {
+        cerr << "Exception destructing TCPEngine: " << e.what() << endl;
+    }
+}
+
+//! Specialization of TCPEngine for TCPOverUDPSocketAdapter
+template class TCPEngine<TCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPEngine for TCPOverIPv4OverTunFdAdapter
+template class TCPEngine<TCPOverIPv4OverTunFdAdapter>;
+
+//! Specialization of TCPEngine for TCPOverIPv4OverEthernetAdapter
+template class TCPEngine<TCPOverIPv4OverEthernetAdapter>;
+
+//! Specialization of TCPEngine for LossyTCPOverUDPSocketAdapter
+template class TCPEngine<LossyTCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPEngine for LossyTCPOverIPv4OverTunFdAdapter
+template class TCPEngine<LossyTCPOverIPv4OverTunFdAdapter>;
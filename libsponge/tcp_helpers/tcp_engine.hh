@@ -0,0 +1,89 @@
+#ifndef SPONGE_LIBSPONGE_TCP_ENGINE_HH
+#define SPONGE_LIBSPONGE_TCP_ENGINE_HH
+
+#include "eventfd.hh"
+#include "eventloop.hh"
+#include "fd_adapter.hh"
+#include "four_tuple.hh"
+#include "tcp_config.hh"
+#include "tcp_reactor.hh"
+#include "tuntap_adapter.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <thread>
+
+//! \brief Runs many TCP connections over one adapter on a single event-loop thread
+//! \details Unlike TCPSpongeSocket, which needs a thread, an event loop and a socketpair per connection
+//! (each waking every few milliseconds), the engine has one thread for all of its connections. That
+//! thread sleeps in poll(2) until a segment arrives, the application hands it something to send
+//! (signalled through an eventfd), or the earliest timer of its TCPReactor expires; connections with
+//! nothing to time never wake it. The application uses one TCPReactor::Handle per connection, from
+//! any thread.
+template <typename AdaptT>
+class TCPEngine {
+  private:
+    //! Adapter to the underlying datagram socket (e.g., UDP or IP); used only by the engine thread
+    AdaptT _adapter;
+
+    //! notified by application threads to wake the engine thread
+    EventFD _wakeup{};
+
+    TCPReactor _reactor;
+
+    EventLoop _eventloop{};
+
+    //! segments taken from the reactor and waiting for the adapter to be writable
+    std::queue<TaggedSegment> _outbound{};
+
+    std::atomic_bool _abort{false};  //!< Flag used by the owner to force the engine thread to shut down
+
+    std::thread _thread{};
+
+    //! Main loop of the engine thread
+    void _main();
+
+  public:
+    //! \param[in] adapter is the adapter that all connections share
+    //! \param[in] cfg is the configuration of every TCPConnection
+    //! \param[in] backlog is the maximum number of connections that may be embryonic or waiting for accept()
+    TCPEngine(AdaptT &&adapter, const TCPConfig &cfg, const size_t backlog = 16);
+
+    //! Stop the engine thread; blocked application threads fail, and remaining connections are dropped
+    ~TCPEngine();
+
+    //! Accept connections addressed to `port`
+    void listen(const uint16_t port) { _reactor.listen(port); }
+
+    //! Choose when SYNs are answered with SYN cookies
+    void set_syn_cookie_mode(const TCPDemultiplexer::SynCookieMode mode) { _reactor.set_syn_cookie_mode(mode); }
+
+    //! Block until a connection has completed its handshake, and take it
+    TCPReactor::Handle accept() { return _reactor.accept(); }
+
+    //! Actively open a connection
+    TCPReactor::Handle connect(const FourTuple &tuple) { return _reactor.connect(tuple); }
+
+    //! The connections
+    TCPReactor &reactor() { return _reactor; }
+
+    //! \name
+    //! This object cannot be moved or copied, since it is in use by two threads simultaneously
+    //!@{
+    TCPEngine(const TCPEngine &other) = delete;
+    TCPEngine(TCPEngine &&other) = delete;
+    TCPEngine &operator=(const TCPEngine &other) = delete;
+    TCPEngine &operator=(TCPEngine &&other) = delete;
+    //!@}
+};
+
+using TCPOverUDPEngine = TCPEngine<TCPOverUDPSocketAdapter>;
+using TCPOverIPv4Engine = TCPEngine<TCPOverIPv4OverTunFdAdapter>;
+using TCPOverIPv4OverEthernetEngine = TCPEngine<TCPOverIPv4OverEthernetAdapter>;
+
+using LossyTCPOverUDPEngine = TCPEngine<LossyTCPOverUDPSocketAdapter>;
+using LossyTCPOverIPv4Engine = TCPEngine<LossyTCPOverIPv4OverTunFdAdapter>;
+
+#endif  // SPONGE_LIBSPONGE_TCP_ENGINE_HH
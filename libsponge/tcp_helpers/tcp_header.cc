@@ -1,5 +1,6 @@
 #include "tcp_header.hh"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
@@ -14,14 +15,36 @@ using namespace std;
 //! - the header's `doff` field is shorter than the minimum allowed
 //! - there is less data in the header than the `doff` field claims
 //! - the checksum is bad
+//!
+//! Options are decoded into `options`; if they are malformed, only the options before the bad one are kept.
 ParseResult TCPHeader::parse(NetParser &p) {
-    sport = p.u16();                 // source port
-    dport = p.u16();                 // destination port
-    seqno = WrappingInt32{p.u32()};  // sequence number
-    ackno = WrappingInt32{p.u32()};  // ack number
-    doff = p.u8() >> 4;              // data offset
+    uint8_t fl_b = 0;  // byte including flags
+    options.clear();
+
+    if (const uint8_t *fixed = p.peek(TCPHeader::LENGTH)) {
+        // fast path: the whole fixed-size header is there, so decode it in place
+        sport = NetParser::load_u16(fixed);                     // source port
+        dport = NetParser::load_u16(fixed + 2);                 // destination port
+        seqno = WrappingInt32{NetParser::load_u32(fixed + 4)};  // sequence number
+        ackno = WrappingInt32{NetParser::load_u32(fixed + 8)};  // ack number
+        doff = fixed[12] >> 4;                                  // data offset
+        fl_b = fixed[13];
+        win = NetParser::load_u16(fixed + 14);    // window size
+        cksum = NetParser::load_u16(fixed + 16);  // checksum
+        uptr = NetParser::load_u16(fixed + 18);   // urgent pointer
+        p.remove_prefix(TCPHeader::LENGTH);
+    } else {
+        sport = p.u16();                 // source port
+        dport = p.u16();                 // destination port
+        seqno = WrappingInt32{p.u32()};  // sequence number
+        ackno = WrappingInt32{p.u32()};  // ack number
+        doff = p.u8() >> 4;              // data offset
+        fl_b = p.u8();
+        win = p.u16();    // window size
+        cksum = p.u16();  // checksum
+        uptr = p.u16();   // urgent pointer
+    }
 
-    const uint8_t fl_b = p.u8();                  // byte including flags
     urg = static_cast<bool>(fl_b & 0b0010'0000);  // binary literals and ' digit separator since C++14!!!
     ack = static_cast<bool>(fl_b & 0b0001'0000);
     psh = static_cast<bool>(fl_b & 0b0000'1000);
@@ -29,16 +52,16 @@ ParseResult TCPHeader::parse(NetParser &p) {
     syn = static_cast<bool>(fl_b & 0b0000'0010);
     fin = static_cast<bool>(fl_b & 0b0000'0001);
 
-    win = p.u16();    // window size
-    cksum = p.u16();  // checksum
-    uptr = p.u16();   // urgent pointer
-
     if (doff < 5) {
         return ParseResult::HeaderTooShort;
     }
 
-    // skip any options or anything extra in the header
-    p.remove_prefix(doff * 4 - TCPHeader::LENGTH);
+    // decode the options, then skip them (and anything extra in the header)
+    const size_t options_length = doff * 4 - TCPHeader::LENGTH;
+    if (const uint8_t *raw_options = p.peek(options_length)) {
+        options.parse(raw_options, options_length);
+    }
+    p.remove_prefix(options_length);
 
     if (p.error()) {
         return p.get_error();
@@ -49,32 +72,40 @@ ParseResult TCPHeader::parse(NetParser &p) {
 
 //! Serialize the TCPHeader to a string (does not recompute the checksum)
 string TCPHeader::serialize() const {
+    string ret(4 * max<size_t>(doff, 5), 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()));
+    return ret;
+}
+
+//! \param[out] out is where to write the header (does not recompute the checksum)
+void TCPHeader::serialize_into(uint8_t *out) const {
     // sanity check
     if (doff < 5) {
         throw runtime_error("TCP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * doff);
-
-    NetUnparser::u16(ret, sport);              // source port
-    NetUnparser::u16(ret, dport);              // destination port
-    NetUnparser::u32(ret, seqno.raw_value());  // sequence number
-    NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
+    NetUnparser::store_u16(out, sport);                  // source port
+    NetUnparser::store_u16(out + 2, dport);              // destination port
+    NetUnparser::store_u32(out + 4, seqno.raw_value());  // sequence number
+    NetUnparser::store_u32(out + 8, ackno.raw_value());  // ack number
+    out[12] = doff << 4;                                 // data offset
 
     const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) |
                          (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
-    NetUnparser::u8(ret, fl_b);  // flags
-    NetUnparser::u16(ret, win);  // window size
-
-    NetUnparser::u16(ret, cksum);  // checksum
+    out[13] = fl_b;                         // flags
+    NetUnparser::store_u16(out + 14, win);  // window size
 
-    NetUnparser::u16(ret, uptr);  // urgent pointer
+    NetUnparser::store_u16(out + 16, cksum);  // checksum
 
-    ret.resize(4 * doff);  // expand header to advertised size
+    NetUnparser::store_u16(out + 18, uptr);  // urgent pointer
 
-    return ret;
+    // options, if they fit, then expand header to advertised size
+    uint8_t *options_end = out + TCPHeader::LENGTH;
+    if (options.padded_length() <= 4 * doff - TCPHeader::LENGTH) {
+        options.serialize_into(options_end);
+        options_end += options.padded_length();
+    }
+    fill(options_end, out + 4 * doff, 0);
 }
 
 //! \returns A string with the header's contents
@@ -89,7 +120,8 @@ string TCPHeader::to_string() const {
        << " fin: " << fin << '\n'
        << "TCP winsize: " << +win << '\n'
        << "TCP cksum: " << +cksum << '\n'
-       << "TCP uptr: " << +uptr << '\n';
+       << "TCP uptr: " << +uptr << '\n'
+       << dec << "TCP options: " << options.to_string() << '\n';
     return ss.str();
 }
 
@@ -104,5 +136,5 @@ bool TCPHeader::operator==(const TCPHeader &other) const {
     // TODO(aozdemir) more complete check (right now we omit cksum, src, dst
     return seqno == other.seqno && ackno == other.ackno && doff == other.doff && urg == other.urg && ack == other.ack &&
            psh == other.psh && rst == other.rst && syn == other.syn && fin == other.fin && win == other.win &&
-           uptr == other.uptr;
+           uptr == other.uptr && options == other.options;
 }
@@ -2,10 +2,11 @@
 #define SPONGE_LIBSPONGE_TCP_HEADER_HH
 
 #include "parser.hh"
+#include "tcp_options.hh"
 #include "wrapping_integers.hh"
 
 //! \brief [TCP](\ref rfc::rfc793) segment header
-//! \note TCP options are not supported
+//! \note Options are kept in `options` (see TCPOptions); malformed options are dropped when parsing
 struct TCPHeader {
     static constexpr size_t LENGTH = 20;  //!< [TCP](\ref rfc::rfc793) header length, not including options
 
@@ -48,6 +49,7 @@ struct TCPHeader {
     uint16_t win = 0;           //!< window size
     uint16_t cksum = 0;         //!< checksum
     uint16_t uptr = 0;          //!< urgent pointer
+    TCPOptions options{};       //!< options (serialized only if they fit in `doff`)
     //!@}
 
     //! Parse the TCP fields from the provided NetParser
@@ -56,6 +58,22 @@ struct TCPHeader {
     //! Serialize the TCP fields
     std::string serialize() const;
 
+    //! Serialize the TCP fields to the `4 * doff` bytes at `out` (the rest of the header after options is zeroed)
+    void serialize_into(uint8_t *out) const;
+
+    //! Replace the options, and set `doff` to fit them
+    void set_options(const TCPOptions &new_options) {
+        options = new_options;
+        doff = (LENGTH + options.padded_length()) / 4;
+    }
+
+    //! \brief Rewrite the port numbers
+    //! \note `cksum` is left as it is: TCPSegment::serialize() updates the checksum it verified for them
+    void set_ports(const uint16_t new_sport, const uint16_t new_dport) {
+        sport = new_sport;
+        dport = new_dport;
+    }
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
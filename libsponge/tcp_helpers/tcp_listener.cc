@@ -0,0 +1,80 @@
+#include "tcp_listener.hh"
+
+#include "util.hh"
+
+#include <utility>
+
+using namespace std;
+
+static constexpr int TCP_TICK_MS = 10;
+
+template <typename AdaptT>
+TCPListener<AdaptT>::TCPListener(AdaptT &&adapter, const TCPConfig &cfg, const size_t backlog)
+    : _adapter(move(adapter)), _demux(cfg, backlog), _base_time(timestamp_ms()) {
+    // rule 1: read segments of any connection from the adapter and hand them to the demultiplexer
+    _eventloop.add_rule(_adapter, Direction::In, [&] {
+        auto tagged = _adapter.read_tagged();
+        if (tagged) {
+            _demux.segment_received(move(tagged.value()));
+        }
+    });
+
+    // rule 2: send the segments that the connections have enqueued
+    _eventloop.add_rule(_adapter,
+                        Direction::Out,
+                        [&] {
+                            auto &segments = _demux.segments_out();
+                            while (not segments.empty()) {
+                                _adapter.write_tagged(segments.front());
+                                segments.pop();
+                            }
+                        },
+                        [&] { return not _demux.segments_out().empty(); });
+}
+
+//! \param[in] timeout_ms is the longest time to wait for a network event, in milliseconds
+template <typename AdaptT>
+void TCPListener<AdaptT>::poll(const int timeout_ms) {
+    _eventloop.wait_next_event(timeout_ms);
+
+    const auto next_time = timestamp_ms();
+    if (next_time != _base_time) {
+        _demux.tick(next_time - _base_time);
+        _adapter.tick(next_time - _base_time);
+        _base_time = next_time;
+    }
+}
+
+//! \param[in] condition is a function returning true if the loop should continue
+template <typename AdaptT>
+void TCPListener<AdaptT>::run_while(const function<bool()> &condition) {
+    while (condition()) {
+        poll(TCP_TICK_MS);
+    }
+}
+
+template <typename AdaptT>
+FourTuple TCPListener<AdaptT>::accept() {
+    while (true) {
+        const auto tuple = _demux.accept();
+        if (tuple) {
+            return tuple.value();
+        }
+        poll(TCP_TICK_MS);
+    }
+}
+
+//! Specialization of TCPListener for TCPOverUDPSocketAdapter
+template class TCPListener<TCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPListener for TCPOverIPv4OverTunFdAdapter
+template class TCPListener<TCPOverIPv4OverTunFdAdapter>;
+
+//! Specialization of TCPListener for TCPOverIPv4OverEthernetAdapter
+template class TCPListener<TCPOverIPv4OverEthernetAdapter>;
+
+//! Specialization of TCPListener for LossyTCPOverUDPSocketAdapter
+template class TCPListener<LossyTCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPListener for LossyTCPOverIPv4OverTunFdAdapter
+template class TCPListener<LossyTCPOverIPv4OverTunFdAdapter>;
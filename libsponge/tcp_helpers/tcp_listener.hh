@@ -0,0 +1,74 @@
+#ifndef SPONGE_LIBSPONGE_TCP_LISTENER_HH
+#define SPONGE_LIBSPONGE_TCP_LISTENER_HH
+
+#include "eventloop.hh"
+#include "fd_adapter.hh"
+#include "four_tuple.hh"
+#include "tcp_config.hh"
+#include "tcp_demux.hh"
+#include "tuntap_adapter.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+//! \brief Serves many TCP connections over a single adapter (e.g. one TUN device or one UDP socket)
+//! \details The listener owns a TCPDemultiplexer and an EventLoop that moves segments between it and
+//! the adapter. Everything runs in the calling thread: accept() and run_while() process network events
+//! (and time) until their condition is met, and the application reads and writes its accepted
+//! connections through demux() in between.
+template <typename AdaptT>
+class TCPListener {
+  private:
+    //! Adapter to the underlying datagram socket (e.g., UDP or IP); must not filter on a single peer
+    AdaptT _adapter;
+
+    TCPDemultiplexer _demux;
+
+    EventLoop _eventloop{};
+
+    //! timestamp of the last tick given to the demultiplexer and adapter
+    uint64_t _base_time;
+
+  public:
+    //! \param[in] adapter is the adapter that all connections share
+    //! \param[in] cfg is the configuration of every TCPConnection
+    //! \param[in] backlog is the maximum number of connections that may be embryonic or waiting for accept()
+    TCPListener(AdaptT &&adapter, const TCPConfig &cfg, const size_t backlog = 16);
+
+    //! Accept connections addressed to `port`
+    void listen(const uint16_t port) { _demux.listen(port); }
+
+    //! Wait (at most `timeout_ms`) for network events, process them, then tick all connections
+    void poll(const int timeout_ms);
+
+    //! Process network events while `condition` returns true
+    void run_while(const std::function<bool()> &condition);
+
+    //! Block until a connection has completed its handshake, and take it from the accept queue
+    FourTuple accept();
+
+    //! The connections; the application reads and writes its accepted connections here
+    TCPDemultiplexer &demux() { return _demux; }
+
+    //! The underlying adapter
+    AdaptT &adapter() { return _adapter; }
+
+    //! \name
+    //! This object cannot be moved or copied, since its event loop refers to it
+    //!@{
+    TCPListener(const TCPListener &other) = delete;
+    TCPListener(TCPListener &&other) = delete;
+    TCPListener &operator=(const TCPListener &other) = delete;
+    TCPListener &operator=(TCPListener &&other) = delete;
+    //!@}
+};
+
+using TCPOverUDPListener = TCPListener<TCPOverUDPSocketAdapter>;
+using TCPOverIPv4Listener = TCPListener<TCPOverIPv4OverTunFdAdapter>;
+using TCPOverIPv4OverEthernetListener = TCPListener<TCPOverIPv4OverEthernetAdapter>;
+
+using LossyTCPOverUDPListener = TCPListener<LossyTCPOverUDPSocketAdapter>;
+using LossyTCPOverIPv4Listener = TCPListener<LossyTCPOverIPv4OverTunFdAdapter>;
+
+#endif  // SPONGE_LIBSPONGE_TCP_LISTENER_HH
@@ -0,0 +1,190 @@
+#include "tcp_options.hh"
+
+#include "parser.hh"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+//! \details Parsing stops at an END option. A NOP is skipped. Any other option must have a length byte
+//! of at least 2 that keeps it within the option space; otherwise it is malformed.
+bool TCPOptions::parse(const uint8_t *data, const size_t length) {
+    clear();
+
+    const size_t limit = min(length, MAX_LENGTH);
+    size_t i = 0;
+    bool ok = length <= MAX_LENGTH;
+    while (i < limit) {
+        const uint8_t kind = data[i];
+        if (kind == END) {
+            break;
+        }
+        if (kind == NOP) {
+            ++i;
+            continue;
+        }
+        if (i + 1 >= limit or data[i + 1] < 2 or i + data[i + 1] > limit) {
+            ok = false;
+            break;
+        }
+
+        const uint8_t option_length = data[i + 1];
+        _options[_count++] = {kind, uint8_t(i + 2), uint8_t(option_length - 2)};
+        i += option_length;
+    }
+
+    copy(data, data + i, _bytes.begin());
+    _length = i;
+    return ok;
+}
+
+void TCPOptions::serialize_into(uint8_t *out) const {
+    copy(_bytes.begin(), _bytes.begin() + _length, out);
+    fill(out + _length, out + padded_length(), uint8_t(END));
+}
+
+const TCPOptions::Option *TCPOptions::_find(const uint8_t kind) const {
+    const auto it = find_if(begin(), end(), [kind](const Option &option) { return option.kind == kind; });
+    return it == end() ? nullptr : it;
+}
+
+bool TCPOptions::_add(const uint8_t kind, const string_view value, const bool align) {
+    const size_t option_length = 2 + value.size();
+    const size_t nops = align ? (4 - (_length + option_length) % 4) % 4 : 0;
+    if (kind == END or kind == NOP or option_length > UINT8_MAX or _length + nops + option_length > MAX_LENGTH) {
+        return false;
+    }
+
+    fill_n(_bytes.begin() + _length, nops, uint8_t(NOP));
+    _length += nops;
+
+    _options[_count++] = {kind, uint8_t(_length + 2), uint8_t(value.size())};
+    _bytes[_length] = kind;
+    _bytes[_length + 1] = option_length;
+    copy(value.begin(), value.end(), _bytes.begin() + _length + 2);
+    _length += option_length;
+    return true;
+}
+
+//! \name Typed accessors
+//!@{
+
+optional<uint16_t> TCPOptions::mss() const {
+    const Option *option = _find(MSS);
+    if (not option or option->length != 2) {
+        return {};
+    }
+    return NetParser::load_u16(_bytes.data() + option->offset);
+}
+
+optional<uint8_t> TCPOptions::window_scale() const {
+    const Option *option = _find(WINDOW_SCALE);
+    if (not option or option->length != 1) {
+        return {};
+    }
+    return _bytes[option->offset];
+}
+
+bool TCPOptions::sack_permitted() const {
+    const Option *option = _find(SACK_PERMITTED);
+    return option and option->length == 0;
+}
+
+optional<TCPOptions::Timestamps> TCPOptions::timestamps() const {
+    const Option *option = _find(TIMESTAMPS);
+    if (not option or option->length != 8) {
+        return {};
+    }
+    const uint8_t *value = _bytes.data() + option->offset;
+    return Timestamps{NetParser::load_u32(value), NetParser::load_u32(value + 4)};
+}
+
+TCPOptions::SACKBlocks TCPOptions::sack() const {
+    SACKBlocks ret;
+    const Option *option = _find(SACK);
+    if (not option or option->length % 8 != 0 or option->length / 8 > MAX_SACK_BLOCKS) {
+        return ret;
+    }
+    for (const uint8_t *value = _bytes.data() + option->offset; ret.count < option->length / 8u; value += 8) {
+        ret.blocks[ret.count++] = {WrappingInt32{NetParser::load_u32(value)},
+                                   WrappingInt32{NetParser::load_u32(value + 4)}};
+    }
+    return ret;
+}
+
+//!@}
+
+//! \name Adding options
+//!@{
+
+bool TCPOptions::add_mss(const uint16_t mss) {
+    array<uint8_t, 2> value;
+    NetUnparser::store_u16(value.data(), mss);
+    return _add(MSS, {reinterpret_cast<const char *>(value.data()), value.size()}, true);
+}
+
+bool TCPOptions::add_window_scale(const uint8_t shift) {
+    return _add(WINDOW_SCALE, {reinterpret_cast<const char *>(&shift), 1}, true);
+}
+
+bool TCPOptions::add_sack_permitted() { return _add(SACK_PERMITTED, {}, false); }
+
+bool TCPOptions::add_timestamps(const Timestamps &timestamps) {
+    array<uint8_t, 8> value;
+    NetUnparser::store_u32(value.data(), timestamps.value);
+    NetUnparser::store_u32(value.data() + 4, timestamps.echo_reply);
+    return _add(TIMESTAMPS, {reinterpret_cast<const char *>(value.data()), value.size()}, true);
+}
+
+bool TCPOptions::add_sack(const SACKBlock *blocks, const size_t count) {
+    if (count == 0 or count > MAX_SACK_BLOCKS) {
+        return false;
+    }
+    array<uint8_t, 8 * MAX_SACK_BLOCKS> value;
+    for (size_t i = 0; i < count; ++i) {
+        NetUnparser::store_u32(value.data() + 8 * i, blocks[i].left.raw_value());
+        NetUnparser::store_u32(value.data() + 8 * i + 4, blocks[i].right.raw_value());
+    }
+    return _add(SACK, {reinterpret_cast<const char *>(value.data()), 8 * count}, true);
+}
+
+bool TCPOptions::add(const uint8_t kind, const string_view value) { return _add(kind, value, false); }
+
+//!@}
+
+string TCPOptions::to_string() const {
+    stringstream ss{};
+    for (const Option &option : *this) {
+        if (&option != begin()) {
+            ss << ' ';
+        }
+        switch (option.kind) {
+            case MSS:
+                ss << "mss=" << mss().value_or(0);
+                break;
+            case WINDOW_SCALE:
+                ss << "wscale=" << +window_scale().value_or(0);
+                break;
+            case SACK_PERMITTED:
+                ss << "sackOK";
+                break;
+            case TIMESTAMPS: {
+                const Timestamps ts = timestamps().value_or(Timestamps{0, 0});
+                ss << "ts=" << ts.value << "/" << ts.echo_reply;
+                break;
+            }
+            case SACK: {
+                const SACKBlocks sacked = sack();
+                ss << "sack=";
+                for (size_t i = 0; i < sacked.count; ++i) {
+                    ss << (i ? "," : "") << sacked.blocks[i].left << "-" << sacked.blocks[i].right;
+                }
+                break;
+            }
+            default:
+                ss << "kind" << +option.kind << "(" << +option.length << " bytes)";
+        }
+    }
+    return ss.str();
+}
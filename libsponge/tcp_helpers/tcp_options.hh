@@ -0,0 +1,138 @@
+#ifndef SPONGE_LIBSPONGE_TCP_OPTIONS_HH
+#define SPONGE_LIBSPONGE_TCP_OPTIONS_HH
+
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+//! \brief The options of a [TCP](\ref rfc::rfc793) header, in at most 40 bytes and without allocating
+//! \details The options are kept as the bytes they are encoded in (so that options this class does not
+//! know are carried unchanged), plus an index of where each one is. Typed accessors decode the MSS and
+//! the options of RFC 7323 (window scale, timestamps) and RFC 2018 (SACK); typed add_*() methods encode
+//! them, with NOP padding in front where that aligns their values the way the RFCs recommend, and refuse
+//! an option that would not fit in the 40 bytes of option space.
+class TCPOptions {
+  public:
+    static constexpr size_t MAX_LENGTH = 40;  //!< Room for options in a TCP header (whose data offset is 4 bits)
+
+    //! Option kinds (see the IANA "TCP Option Kind Numbers" registry)
+    enum Kind : uint8_t {
+        END = 0,             //!< End of option list
+        NOP = 1,             //!< No-operation (padding)
+        MSS = 2,             //!< Maximum segment size
+        WINDOW_SCALE = 3,    //!< Window scale shift count
+        SACK_PERMITTED = 4,  //!< Selective acknowledgments are permitted
+        SACK = 5,            //!< Selective acknowledgment blocks
+        TIMESTAMPS = 8,      //!< Timestamp value and echo reply
+    };
+
+    //! Where an option (other than END and NOP) is in bytes()
+    struct Option {
+        uint8_t kind;    //!< the option's kind
+        uint8_t offset;  //!< offset of the option's value (after its kind and length bytes)
+        uint8_t length;  //!< length of the option's value
+    };
+
+    //! Contents of a TIMESTAMPS option
+    struct Timestamps {
+        uint32_t value;       //!< TSval
+        uint32_t echo_reply;  //!< TSecr
+    };
+
+    //! One block of a SACK option
+    struct SACKBlock {
+        WrappingInt32 left{0};   //!< first sequence number of the block
+        WrappingInt32 right{0};  //!< sequence number just after the block
+    };
+
+    //! Maximum number of blocks in a SACK option
+    static constexpr size_t MAX_SACK_BLOCKS = 4;
+
+    //! Contents of a SACK option
+    struct SACKBlocks {
+        std::array<SACKBlock, MAX_SACK_BLOCKS> blocks{};
+        size_t count{};
+    };
+
+  private:
+    std::array<uint8_t, MAX_LENGTH> _bytes{};  //!< the encoded options, up to (not including) any END option
+    uint8_t _length{};                         //!< number of bytes used in `_bytes`
+    std::array<Option, MAX_LENGTH / 2> _options{};
+    uint8_t _count{};  //!< number of options in `_options`
+
+    const Option *_find(const uint8_t kind) const;
+
+    //! Append an option (if it fits), after enough NOPs to end it on a multiple of four bytes if `align`
+    bool _add(const uint8_t kind, const std::string_view value, const bool align);
+
+  public:
+    //! \brief Decode the `length` bytes of options at `data`
+    //! \returns `false` if an option is malformed; the options before it are kept
+    bool parse(const uint8_t *data, const size_t length);
+
+    //! Forget all options
+    void clear() { _length = _count = 0; }
+
+    //! \name The options, in order (not counting END and NOP)
+    //!@{
+    size_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+    const Option *begin() const { return _options.data(); }
+    const Option *end() const { return _options.data() + _count; }
+
+    //! The value of `option`
+    std::string_view value(const Option &option) const {
+        return {reinterpret_cast<const char *>(_bytes.data()) + option.offset, option.length};
+    }
+    //!@}
+
+    //! \name Encoded form
+    //!@{
+
+    //! The encoded options, without padding
+    std::string_view bytes() const { return {reinterpret_cast<const char *>(_bytes.data()), _length}; }
+
+    //! Length of the encoded options, padded to a multiple of four bytes
+    size_t padded_length() const { return (_length + 3) & ~size_t(3); }
+
+    //! Write padded_length() bytes of encoded options (padded with END) to `out`
+    void serialize_into(uint8_t *out) const;
+    //!@}
+
+    //! \name Typed accessors (empty if the option is absent or has the wrong length)
+    //!@{
+    std::optional<uint16_t> mss() const;
+    std::optional<uint8_t> window_scale() const;
+    bool sack_permitted() const;
+    std::optional<Timestamps> timestamps() const;
+    SACKBlocks sack() const;
+    //!@}
+
+    //! \name Append options
+    //! Each returns `false` (and leaves the options unchanged) if the option does not fit. The MSS, window
+    //! scale, timestamps and SACK options are padded to end on a four-byte boundary (e.g. NOP, NOP, TIMESTAMPS,
+    //! as in RFC 7323, Appendix A); SACK_PERMITTED is not, so that it can share a word with the timestamps.
+    //!@{
+    bool add_mss(const uint16_t mss);
+    bool add_window_scale(const uint8_t shift);
+    bool add_sack_permitted();
+    bool add_timestamps(const Timestamps &timestamps);
+    bool add_sack(const SACKBlock *blocks, const size_t count);
+
+    //! Append an option of any other kind (not END or NOP), without alignment
+    bool add(const uint8_t kind, const std::string_view value);
+    //!@}
+
+    //! A human-readable summary of the options
+    std::string to_string() const;
+
+    bool operator==(const TCPOptions &other) const { return bytes() == other.bytes(); }
+    bool operator!=(const TCPOptions &other) const { return not operator==(other); }
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_OPTIONS_HH
@@ -2,6 +2,7 @@
 
 #include "ipv4_datagram.hh"
 #include "ipv4_header.hh"
+#include "packet_view.hh"
 #include "parser.hh"
 
 #include <arpa/inet.h>
@@ -70,17 +71,52 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
     return tcp_seg;
 }
 
+//! \details Applies the same address and port checks as the function above, but to a PacketView of the
+//! raw bytes, so that a datagram that is not for the current connection is dropped without being parsed
+//! or checksummed.
+optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(Buffer datagram) {
+    const PacketView view{datagram};
+    if (not view.is_ipv4() or view.proto() != IPv4Header::PROTO_TCP or not view.has_ports()) {
+        return {};
+    }
+
+    if (view.dport() != config().source.port()) {
+        return {};
+    }
+
+    if (not listening() and
+        (view.dst() != config().source.ipv4_numeric() or view.src() != config().destination.ipv4_numeric() or
+         view.sport() != config().destination.port())) {
+        return {};
+    }
+
+    InternetDatagram ip_dgram;
+    if (ip_dgram.parse(move(datagram)) != ParseResult::NoError) {
+        return {};
+    }
+    return unwrap_tcp_in_ip(ip_dgram);
+}
+
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+    const FourTuple tuple{config().source.ipv4_numeric(),
+                          config().destination.ipv4_numeric(),
+                          config().source.port(),
+                          config().destination.port()};
+    return wrap_tcp_in_ip(tuple, seg);
+}
+
+//! \param[in] tuple identifies the connection (local side is the source of the datagram)
+//! \param[in] seg is the TCP segment to convert; its port numbers are overwritten from `tuple`
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg) {
     // set the port numbers in the TCP segment
-    seg.header().sport = config().source.port();
-    seg.header().dport = config().destination.port();
+    seg.header().set_ports(tuple.local_port, tuple.remote_port);
 
     // create an Internet Datagram and set its addresses and length
     InternetDatagram ip_dgram;
-    ip_dgram.header().src = config().source.ipv4_numeric();
-    ip_dgram.header().dst = config().destination.ipv4_numeric();
+    ip_dgram.header().src = tuple.local_address;
+    ip_dgram.header().dst = tuple.remote_address;
     ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
 
     // set payload, calculating TCP checksum using information from IP header
@@ -88,3 +124,47 @@ InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
 
     return ip_dgram;
 }
+
+//! \details Unlike unwrap_tcp_in_ip(), this function does not filter on the peer's address or on
+//! port numbers, and never changes the adapter's configuration; it only checks that the datagram is
+//! addressed to the configured source address (any address, if that is INADDR_ANY) and that it carries
+//! a valid TCP segment. Deciding which connection (if any) the segment belongs to is left to the caller,
+//! e.g. a TCPDemultiplexer.
+//! \returns a std::optional<TaggedSegment> that is empty if the datagram was invalid or not for us
+optional<TaggedSegment> TCPOverIPv4Adapter::unwrap_tagged_tcp_in_ip(const InternetDatagram &ip_dgram) {
+    // is the IPv4 datagram for us?
+    const uint32_t local_address = config().source.ipv4_numeric();
+    if (local_address != 0 and ip_dgram.header().dst != local_address) {
+        return {};
+    }
+
+    // does the IPv4 datagram claim that its payload is a TCP segment?
+    if (ip_dgram.header().proto != IPv4Header::PROTO_TCP) {
+        return {};
+    }
+
+    // is the payload a valid TCP segment?
+    TaggedSegment ret;
+    if (ParseResult::NoError != ret.segment.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+        return {};
+    }
+
+    ret.tuple = {ip_dgram.header().dst, ip_dgram.header().src, ret.segment.header().dport, ret.segment.header().sport};
+    return ret;
+}
+
+//! \details Applies the same address check as the function above, but to a PacketView of the raw bytes.
+optional<TaggedSegment> TCPOverIPv4Adapter::unwrap_tagged_tcp_in_ip(Buffer datagram) {
+    const PacketView view{datagram};
+    const uint32_t local_address = config().source.ipv4_numeric();
+    if (not view.is_ipv4() or view.proto() != IPv4Header::PROTO_TCP or
+        (local_address != 0 and view.dst() != local_address)) {
+        return {};
+    }
+
+    InternetDatagram ip_dgram;
+    if (ip_dgram.parse(move(datagram)) != ParseResult::NoError) {
+        return {};
+    }
+    return unwrap_tagged_tcp_in_ip(ip_dgram);
+}
@@ -3,6 +3,7 @@
 
 #include "buffer.hh"
 #include "fd_adapter.hh"
+#include "four_tuple.hh"
 #include "ipv4_datagram.hh"
 #include "tcp_segment.hh"
 
@@ -13,7 +14,21 @@ class TCPOverIPv4Adapter : public FdAdapterBase {
   public:
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
+    //! Like unwrap_tcp_in_ip(const InternetDatagram &), from a raw datagram that is only parsed if it passes a
+    //! PacketView filter
+    std::optional<TCPSegment> unwrap_tcp_in_ip(Buffer datagram);
+
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! Wrap a TCP segment of an arbitrary connection, identified by `tuple`, in an IPv4 datagram
+    InternetDatagram wrap_tcp_in_ip(const FourTuple &tuple, TCPSegment &seg);
+
+    //! Parse any TCP segment addressed to the local address, tagged with the connection it belongs to
+    std::optional<TaggedSegment> unwrap_tagged_tcp_in_ip(const InternetDatagram &ip_dgram);
+
+    //! Like unwrap_tagged_tcp_in_ip(const InternetDatagram &), from a raw datagram that is only parsed if it
+    //! passes a PacketView filter
+    std::optional<TaggedSegment> unwrap_tagged_tcp_in_ip(Buffer datagram);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
@@ -0,0 +1,307 @@
+#include "tcp_reactor.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+using namespace std;
+
+TCPReactor::TCPReactor(const TCPConfig &cfg, const size_t backlog, function<void()> wake)
+    : _wake(move(wake))
+    , _demux(cfg, backlog)
+    , _timers(timestamp_ms(), TIMER_GRANULARITY_MS)
+    , _last_tick(timestamp_ms()) {}
+
+TCPReactor::ConnectionState &TCPReactor::_state(const FourTuple &tuple) {
+    const auto it = _states.find(tuple);
+    if (it == _states.end()) {
+        throw runtime_error("TCPReactor: no connection " + tuple.to_string());
+    }
+    return it->second;
+}
+
+//! \details A connection is only ticked when it needs to be, so before anything else happens to it
+//! (a segment arrives, the application writes) it must first be brought up to date. Otherwise the
+//! first tick after an idle period would charge the whole period to a retransmission timer that
+//! was only just started. Without a connection the clock still moves, so that one created next
+//! starts at `now`.
+void TCPReactor::_sync(const FourTuple &tuple, const uint64_t now) {
+    const uint64_t elapsed = _advance_clock(now);
+    if (_demux.contains(tuple)) {
+        _demux.tick(tuple, elapsed);
+    } else {
+        _demux.advance(elapsed);
+    }
+}
+
+//! \details Threads read the time before taking the lock, so `now` may be a little behind.
+uint64_t TCPReactor::_advance_clock(const uint64_t now) {
+    if (now <= _last_tick) {
+        return 0;
+    }
+    return now - exchange(_last_tick, now);
+}
+
+void TCPReactor::_arm_time_wait(const uint64_t now) {
+    const auto timeout = _demux.time_wait_timeout();
+    if (not timeout.has_value()) {
+        _timers.cancel(TIME_WAIT_TIMER);
+        return;
+    }
+
+    const uint64_t deadline = now + timeout.value();
+    if (not _timers.scheduled(TIME_WAIT_TIMER) or deadline < _time_wait_deadline) {
+        _time_wait_deadline = deadline;
+        _timers.schedule(TIME_WAIT_TIMER, deadline);
+    }
+}
+
+void TCPReactor::_update(const FourTuple &tuple, const uint64_t now) {
+    _arm_time_wait(now);
+    auto it = _states.find(tuple);
+
+    if (not _demux.contains(tuple)) {
+        // never created (e.g. answered with a RST), or reaped by the demultiplexer
+        if (it != _states.end()) {
+            _timers.cancel(it->second.timer_id);
+            _timer_owners.erase(it->second.timer_id);
+            _states.erase(it);
+        }
+        return;
+    }
+
+    if (it == _states.end()) {
+        const TimerWheel::TimerId id = _next_timer_id++;
+        it = _states.emplace(piecewise_construct, forward_as_tuple(tuple), forward_as_tuple(id)).first;
+        _timer_owners.emplace(id, tuple);
+    }
+    ConnectionState &state = it->second;
+
+    // the connection has just been ticked up to `_last_tick`, so that is what its timeout counts from
+    const auto timeout = _demux.connection(tuple).next_timeout();
+    if (not timeout.has_value()) {
+        _timers.cancel(state.timer_id);
+    } else if (not _timers.scheduled(state.timer_id) or state.deadline != _last_tick + timeout.value()) {
+        state.deadline = _last_tick + timeout.value();
+        _timers.schedule(state.timer_id, state.deadline);
+    }
+
+    state.changed.notify_all();
+    if (_demux.accept_queue_size() > 0) {
+        _acceptable.notify_all();
+        if (_accept_callback) {
+            _accept_callback();
+        }
+    }
+}
+
+void TCPReactor::segment_received(TaggedSegment &&tagged) {
+    const uint64_t now = timestamp_ms();
+    const FourTuple tuple = tagged.tuple;
+
+    lock_guard<mutex> lock(_mutex);
+    _sync(tuple, now);
+    _demux.segment_received(move(tagged));
+    _update(tuple, now);
+}
+
+void TCPReactor::expire_timers() {
+    const uint64_t now = timestamp_ms();
+
+    lock_guard<mutex> lock(_mutex);
+    _timers.advance(now, [&](const TimerWheel::TimerId id) {
+        if (id == TIME_WAIT_TIMER) {
+            _demux.advance(_advance_clock(now));
+            _arm_time_wait(now);
+            return;
+        }
+        const auto owner = _timer_owners.find(id);
+        if (owner == _timer_owners.end()) {
+            return;
+        }
+        const FourTuple tuple = owner->second;
+        _sync(tuple, now);
+        _update(tuple, now);
+    });
+}
+
+int TCPReactor::timeout_ms() const {
+    lock_guard<mutex> lock(_mutex);
+    return _timers.timeout_ms(timestamp_ms());
+}
+
+void TCPReactor::take_segments(queue<TaggedSegment> &segments) {
+    lock_guard<mutex> lock(_mutex);
+    auto &pending = _demux.segments_out();
+    while (not pending.empty()) {
+        segments.push(move(pending.front()));
+        pending.pop();
+    }
+}
+
+void TCPReactor::shut_down() {
+    lock_guard<mutex> lock(_mutex);
+    _shut_down = true;
+    _acceptable.notify_all();
+    for (auto &[tuple, state] : _states) {
+        state.changed.notify_all();
+    }
+}
+
+void TCPReactor::listen(const uint16_t port) {
+    lock_guard<mutex> lock(_mutex);
+    _demux.listen(port);
+}
+
+void TCPReactor::set_syn_cookie_mode(const TCPDemultiplexer::SynCookieMode mode) {
+    lock_guard<mutex> lock(_mutex);
+    _demux.set_syn_cookie_mode(mode);
+}
+
+TCPReactor::Handle TCPReactor::accept() {
+    unique_lock<mutex> lock(_mutex);
+    _acceptable.wait(lock, [&] { return _shut_down or _demux.accept_queue_size() > 0; });
+    if (_shut_down) {
+        throw runtime_error("TCPReactor: accept() after shut down");
+    }
+
+    const auto tuple = _demux.accept();
+    return {*this, tuple.value()};
+}
+
+optional<TCPReactor::Handle> TCPReactor::try_accept() {
+    lock_guard<mutex> lock(_mutex);
+    const auto tuple = _demux.accept();
+    if (not tuple) {
+        return {};
+    }
+    return Handle{*this, tuple.value()};
+}
+
+void TCPReactor::set_accept_callback(function<void()> callback) {
+    lock_guard<mutex> lock(_mutex);
+    _accept_callback = move(callback);
+}
+
+TCPReactor::Handle TCPReactor::connect(const FourTuple &tuple) {
+    const uint64_t now = timestamp_ms();
+    {
+        lock_guard<mutex> lock(_mutex);
+        _sync(tuple, now);
+        _demux.connect(tuple);
+        _update(tuple, now);
+    }
+    _wake();
+    return {*this, tuple};
+}
+
+size_t TCPReactor::size() const {
+    lock_guard<mutex> lock(_mutex);
+    return _demux.size();
+}
+
+size_t TCPReactor::timers_armed() const {
+    lock_guard<mutex> lock(_mutex);
+    return _timers.size() - _timers.scheduled(TIME_WAIT_TIMER);
+}
+
+string TCPReactor::_read(const FourTuple &tuple, const size_t limit) {
+    unique_lock<mutex> lock(_mutex);
+    ByteStream &inbound = _demux.inbound_stream(tuple);
+    _state(tuple).changed.wait(lock, [&] {
+        return _shut_down or not inbound.buffer_empty() or inbound.input_ended() or inbound.error() or
+               not _demux.connection(tuple).active();
+    });
+    return inbound.read(min(limit, inbound.buffer_size()));
+}
+
+void TCPReactor::_write(const FourTuple &tuple, const string &data) {
+    unique_lock<mutex> lock(_mutex);
+    ConnectionState &state = _state(tuple);
+    size_t written = 0;
+    while (written < data.size()) {
+        state.changed.wait(lock, [&] {
+            return _shut_down or not _demux.connection(tuple).active() or
+                   _demux.connection(tuple).remaining_outbound_capacity() > 0;
+        });
+        if (_shut_down or not _demux.connection(tuple).active()) {
+            throw runtime_error("TCPReactor: connection " + tuple.to_string() + " closed during write()");
+        }
+
+        const uint64_t now = timestamp_ms();
+        _sync(tuple, now);
+        written += _demux.write(tuple, data.substr(written));
+        _update(tuple, now);
+        _wake();
+    }
+}
+
+void TCPReactor::_shutdown_write(const FourTuple &tuple) {
+    const uint64_t now = timestamp_ms();
+    {
+        lock_guard<mutex> lock(_mutex);
+        _sync(tuple, now);
+        _demux.end_input_stream(tuple);
+        _update(tuple, now);
+    }
+    _wake();
+}
+
+void TCPReactor::_release(const FourTuple &tuple) {
+    const uint64_t now = timestamp_ms();
+    {
+        lock_guard<mutex> lock(_mutex);
+        _sync(tuple, now);
+        _demux.release(tuple);
+        _update(tuple, now);
+    }
+    _wake();
+}
+
+TCPReactor &TCPReactor::Handle::_owner() const {
+    if (not _reactor) {
+        throw runtime_error("TCPReactor::Handle: use of closed handle");
+    }
+    return *_reactor;
+}
+
+string TCPReactor::Handle::read(const size_t limit) { return _owner()._read(_tuple, limit); }
+
+void TCPReactor::Handle::write(const string &data) { _owner()._write(_tuple, data); }
+
+void TCPReactor::Handle::shutdown_write() { _owner()._shutdown_write(_tuple); }
+
+void TCPReactor::Handle::close() {
+    if (_reactor) {
+        auto *reactor = exchange(_reactor, nullptr);
+        reactor->_release(_tuple);
+    }
+}
+
+TCPReactor::Handle::~Handle() {
+    try {
+        close();
+    } catch (const exception &e) {
+        cerr << "Exception closing TCPReactor::Handle: " << e.what() << endl;
+    }
+}
+
+TCPReactor::Handle::Handle(Handle &&other) noexcept
+    : _reactor(exchange(other._reactor, nullptr)), _tuple(other._tuple) {}
+
+TCPReactor::Handle &TCPReactor::Handle::operator=(Handle &&other) noexcept {
+    if (this != &other) {
+        try {
+            close();
+        } catch (const exception &e) {
+            cerr << "Exception closing TCPReactor::Handle: " << e.what() << endl;
+        }
+        _reactor = exchange(other._reactor, nullptr);
+        _tuple = other._tuple;
+    }
+    return *this;
+}
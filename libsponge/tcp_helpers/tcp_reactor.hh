@@ -0,0 +1,195 @@
+#ifndef SPONGE_LIBSPONGE_TCP_REACTOR_HH
+#define SPONGE_LIBSPONGE_TCP_REACTOR_HH
+
+#include "four_tuple.hh"
+#include "tcp_config.hh"
+#include "tcp_demux.hh"
+#include "timer_wheel.hh"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+
+//! \brief Many TCPConnections driven by one thread, and used by any number of application threads
+//! \details The reactor wraps a TCPDemultiplexer with the bookkeeping that lets one thread run it
+//! without polling every connection: a connection is ticked (by the demultiplexer, up to its clock)
+//! only when something happens to it or when its timer on the shared TimerWheel expires. The timer
+//! is armed for the connection's next deadline (see TCPConnection::next_timeout()): its retransmission
+//! timeout, or the end of a close. Idle connections cost nothing. One more timer expires the TIME_WAIT
+//! records of the demultiplexer, so that they go away even if nothing else happens.
+//!
+//! The thread that owns the network (see TCPEngine) calls segment_received(), expire_timers() and
+//! take_segments(); the application uses a Handle per connection. All state is guarded by one mutex,
+//! and `wake` is called whenever the application gave a connection something to send.
+class TCPReactor {
+  public:
+    class Handle;
+
+    //! Granularity of the timer wheel: a connection is ticked up to this long after its deadline
+    static constexpr uint64_t TIMER_GRANULARITY_MS = 10;
+
+  private:
+    struct ConnectionState {
+        TimerWheel::TimerId timer_id;
+        uint64_t deadline{0};               //!< when the timer is armed to expire (if it is armed)
+        std::condition_variable changed{};  //!< notified whenever the connection may have changed
+
+        explicit ConnectionState(const TimerWheel::TimerId id) : timer_id(id) {}
+    };
+
+    //! the timer that expires TIME_WAIT records (connections' timers are numbered from 1)
+    static constexpr TimerWheel::TimerId TIME_WAIT_TIMER = 0;
+
+    std::function<void()> _wake;
+    std::function<void()> _accept_callback{};
+
+    mutable std::mutex _mutex{};
+    std::condition_variable _acceptable{};
+
+    TCPDemultiplexer _demux;
+    TimerWheel _timers;
+    std::unordered_map<FourTuple, ConnectionState, FourTupleHash> _states{};
+    std::unordered_map<TimerWheel::TimerId, FourTuple> _timer_owners{};
+    TimerWheel::TimerId _next_timer_id{TIME_WAIT_TIMER + 1};
+
+    //! the time (see timestamp_ms()) up to which the demultiplexer's clock has been advanced
+    uint64_t _last_tick;
+
+    //! when TIME_WAIT_TIMER is armed to expire
+    uint64_t _time_wait_deadline{0};
+
+    bool _shut_down{false};
+
+    //! \name Helpers; the caller holds `_mutex`
+    //!@{
+
+    //! advance the demultiplexer's clock to `now`, ticking the connection (if there is one)
+    void _sync(const FourTuple &tuple, const uint64_t now);
+
+    //! move `_last_tick` to `now`; returns how far it moved
+    uint64_t _advance_clock(const uint64_t now);
+
+    //! arm TIME_WAIT_TIMER for the earliest TIME_WAIT record, if it is not armed for that time already
+    void _arm_time_wait(const uint64_t now);
+
+    //! after the connection may have changed: start or forget its state, (dis)arm its timer, wake waiters
+    void _update(const FourTuple &tuple, const uint64_t now);
+
+    ConnectionState &_state(const FourTuple &tuple);
+    //!@}
+
+    //! \name Per-connection operations behind Handle
+    //!@{
+    std::string _read(const FourTuple &tuple, const size_t limit);
+    void _write(const FourTuple &tuple, const std::string &data);
+    void _shutdown_write(const FourTuple &tuple);
+    void _release(const FourTuple &tuple);
+    //!@}
+
+  public:
+    //! \param[in] cfg is the configuration of every TCPConnection
+    //! \param[in] backlog is the maximum number of connections that may be embryonic or waiting for accept()
+    //! \param[in] wake is called (possibly from an application thread) when there are segments to take
+    TCPReactor(const TCPConfig &cfg, const size_t backlog, std::function<void()> wake);
+
+    //! \name Interface for the thread that owns the network
+    //!@{
+
+    //! Hand a segment read from the network to its connection
+    void segment_received(TaggedSegment &&tagged);
+
+    //! Tick every connection whose timer has expired
+    void expire_timers();
+
+    //! \returns how long the network thread may sleep before calling expire_timers() (-1 for forever)
+    int timeout_ms() const;
+
+    //! Move every segment waiting to be sent to `segments`
+    void take_segments(std::queue<TaggedSegment> &segments);
+
+    //! Wake every blocked application thread; accept() and blocked reads and writes fail from now on
+    void shut_down();
+    //!@}
+
+    //! \name Interface for the application
+    //!@{
+
+    //! Accept connections addressed to `port`
+    void listen(const uint16_t port);
+
+    //! Choose when SYNs are answered with SYN cookies (see TCPDemultiplexer::SynCookieMode)
+    void set_syn_cookie_mode(const TCPDemultiplexer::SynCookieMode mode);
+
+    //! \brief Block until a connection has completed its handshake, and take it from the accept queue
+    //! \throws std::runtime_error if the reactor is shut down
+    Handle accept();
+
+    //! Take a connection from the accept queue if one is ready, without blocking
+    std::optional<Handle> try_accept();
+
+    //! \brief Set a function to call whenever connections are waiting to be accepted
+    //! \note The function is called with the reactor's lock held, and must not call back into the reactor
+    void set_accept_callback(std::function<void()> callback);
+
+    //! \brief Actively open a connection; data written before the handshake completes is sent afterwards
+    //! \throws std::runtime_error if a connection with this tuple already exists
+    Handle connect(const FourTuple &tuple);
+
+    //! Number of connections, in any state
+    size_t size() const;
+
+    //! Number of connections whose timer is armed
+    size_t timers_armed() const;
+    //!@}
+};
+
+//! \brief The application's end of one connection of a TCPReactor
+//! \details A Handle owns its connection: destroying it (or calling close()) gives the connection back
+//! to the reactor, which finishes the close in the background. Handles can be moved but not copied,
+//! and must not outlive their reactor.
+class TCPReactor::Handle {
+  private:
+    TCPReactor *_reactor;
+    FourTuple _tuple;
+
+    //! \throws std::runtime_error if the handle was closed (or moved from)
+    TCPReactor &_owner() const;
+
+  public:
+    Handle(TCPReactor &reactor, const FourTuple &tuple) : _reactor(&reactor), _tuple(tuple) {}
+
+    //! The connection's 4-tuple
+    const FourTuple &tuple() const { return _tuple; }
+
+    //! \brief Block until inbound data is available, then read up to `limit` bytes of it
+    //! \returns the data read, or an empty string once the inbound stream has ended (or was reset)
+    std::string read(const size_t limit = 65536);
+
+    //! \brief Write all of `data`, blocking while the outbound stream is full
+    //! \throws std::runtime_error if the connection is reset (or the reactor shut down) first
+    void write(const std::string &data);
+
+    //! End the outbound stream (the peer reads EOF); reading is still possible
+    void shutdown_write();
+
+    //! Give the connection back to the reactor, which ends the outbound stream and reaps it once closed
+    void close();
+
+    //! \name
+    //! moving is allowed; copying is disallowed
+    //!@{
+    ~Handle();  //!< calls close() if the handle still owns a connection
+    Handle(Handle &&other) noexcept;
+    Handle &operator=(Handle &&other) noexcept;
+    Handle(const Handle &other) = delete;
+    Handle &operator=(const Handle &other) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_REACTOR_HH
@@ -1,24 +1,41 @@
 #include "tcp_segment.hh"
 
+#include "packet_buffer.hh"
 #include "parser.hh"
 #include "util.hh"
 
+#include <array>
+#include <utility>
 #include <variant>
 
 using namespace std;
 
+//! fold a pseudo-header checksum into 16 bits
+static uint16_t fold(uint32_t sum) {
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return sum;
+}
+
 //! \param[in] buffer string/Buffer to be parsed
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
-ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer_checksum) {
+ParseResult TCPSegment::parse(Buffer buffer, const uint32_t datagram_layer_checksum) {
+    _parsed = {};
+
     InternetChecksum check(datagram_layer_checksum);
     check.add(buffer);
     if (check.value()) {
         return ParseResult::BadChecksum;
     }
 
-    NetParser p{buffer};
+    NetParser p{move(buffer)};
     _header.parse(p);
-    _payload = p.buffer();
+    _payload = p.take_buffer();
+
+    if (not p.error() and _header.doff * 4 == TCPHeader::LENGTH) {
+        _parsed = Parsed{true, _header, fold(datagram_layer_checksum), _payload};
+    }
     return p.get_error();
 }
 
@@ -29,17 +46,31 @@ size_t TCPSegment::length_in_sequence_space() const {
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
-    header_out.cksum = 0;
 
-    // calculate checksum -- taken over entire segment
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
-    check.add(_payload);
-    header_out.cksum = check.value();
+    // TCPHeader::operator== ignores the ports and the checksum
+    if (_parsed.valid and header_out == _parsed.header and _payload.str().data() == _parsed.payload.str().data() and
+        _payload.size() == _parsed.payload.size()) {
+        // update the verified checksum for the new pseudo-header and ports (RFC 1624)
+        uint16_t cksum = _parsed.header.cksum;
+        cksum = InternetChecksum::update(cksum, _parsed.pseudo_sum, fold(datagram_layer_checksum));
+        cksum = InternetChecksum::update(cksum, _parsed.header.sport, header_out.sport);
+        cksum = InternetChecksum::update(cksum, _parsed.header.dport, header_out.dport);
+        header_out.cksum = cksum;
+    } else {
+        header_out.cksum = 0;
+        array<uint8_t, 60> header_zero_checksum;
+        header_out.serialize_into(header_zero_checksum.data());
 
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
+        // calculate checksum -- taken over entire segment (the payload's sum is cached by its Buffer)
+        InternetChecksum check(datagram_layer_checksum);
+        check.add({reinterpret_cast<const char *>(header_zero_checksum.data()), 4 * size_t(header_out.doff)});
+        check.add_partial_sum(_payload.partial_checksum(), _payload.size());
+        header_out.cksum = check.value();
+    }
 
-    return ret;
+    // the whole segment goes in one buffer, with headroom for the headers of the layers below it
+    PacketBuffer packet{PacketBuffer::DEFAULT_HEADROOM, 4 * size_t(header_out.doff) + _payload.size()};
+    packet.append(_payload);
+    header_out.serialize_into(packet.prepend(4 * header_out.doff));
+    return packet.release();
 }
@@ -12,11 +12,25 @@ class TCPSegment {
     TCPHeader _header{};
     Buffer _payload{};
 
+    //! What the checksum was verified against by parse()
+    struct Parsed {
+        bool valid{};           //!< whether parse() succeeded with a header this can describe
+        TCPHeader header{};
+        uint16_t pseudo_sum{};  //!< the (folded) checksum of the pseudo-header
+        Buffer payload{};       //!< shares its storage with the parsed payload, which therefore cannot be reused
+    };
+
+    //! lets serialize() update the checksum instead of recomputing it over the whole payload, when only
+    //! the ports or the pseudo-header (addresses) have changed since parse() (e.g. when relaying)
+    Parsed _parsed{};
+
   public:
     //! \brief Parse the segment from a string
-    ParseResult parse(const Buffer buffer, const uint32_t datagram_layer_checksum = 0);
+    ParseResult parse(Buffer buffer, const uint32_t datagram_layer_checksum = 0);
 
     //! \brief Serialize the segment to a string
+    //! \details The result is a single Buffer with headroom, so that the layers below can prepend their
+    //! headers in place (see Buffer::claim_headroom()).
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
 
     //! \name Accessors
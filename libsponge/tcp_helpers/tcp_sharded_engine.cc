@@ -0,0 +1,222 @@
+#include "tcp_sharded_engine.hh"
+
+#include "util.hh"
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+//! Longest time the dispatcher sleeps without ticking the adapter (e.g. for ARP timers)
+static constexpr int ADAPTER_TICK_MS = 1000;
+
+//! How soon a shard retries handing over segments when the outbound ring was full
+static constexpr int RING_RETRY_MS = 1;
+
+template <typename AdaptT>
+TCPShardedEngine<AdaptT>::Shard::Shard(const TCPConfig &cfg, const size_t backlog, const size_t ring_capacity)
+    : inbound(ring_capacity), reactor(cfg, backlog, [this] { wakeup.notify(); }) {
+    eventloop.add_rule(wakeup, Direction::In, [&] { wakeup.clear(); });
+}
+
+template <typename AdaptT>
+TCPShardedEngine<AdaptT>::TCPShardedEngine(AdaptT &&adapter,
+                                           const TCPConfig &cfg,
+                                           const size_t num_shards,
+                                           const size_t backlog,
+                                           const size_t ring_capacity)
+    : _adapter(move(adapter)), _outbound_ring(ring_capacity) {
+    if (num_shards == 0) {
+        throw runtime_error("TCPShardedEngine: need at least one shard");
+    }
+
+    for (size_t i = 0; i < num_shards; ++i) {
+        _shards.push_back(make_unique<Shard>(cfg, backlog, ring_capacity));
+        _shards.back()->reactor.set_accept_callback([this] {
+            {
+                lock_guard<mutex> lock(_accept_mutex);
+                ++_accept_generation;
+            }
+            _acceptable.notify_all();
+        });
+    }
+
+    // rule 1: read segments from the adapter and steer each to the shard that owns its connection
+    _eventloop.add_rule(_adapter, Direction::In, [&] {
+        auto tagged = _adapter.read_tagged();
+        if (not tagged) {
+            return;
+        }
+        Shard &shard = _shard_for(tagged->tuple);
+        if (shard.inbound.try_push(move(tagged.value()))) {
+            shard.wakeup.notify();
+        } else {
+            ++_dropped;
+        }
+    });
+
+    // rule 2: drain wakeups from the shards (their segments are taken below)
+    _eventloop.add_rule(_wakeup, Direction::In, [&] { _wakeup.clear(); });
+
+    // rule 3: send the segments that the shards have handed over
+    _eventloop.add_rule(_adapter,
+                        Direction::Out,
+                        [&] {
+                            while (not _outbound.empty()) {
+                                _adapter.write_tagged(_outbound.front());
+                                _outbound.pop();
+                            }
+                        },
+                        [&] { return not _outbound.empty(); });
+
+    for (auto &shard : _shards) {
+        shard->thread = thread(&TCPShardedEngine::_shard_main, this, ref(*shard));
+    }
+    _dispatcher = thread(&TCPShardedEngine::_dispatch_main, this);
+}
+
+//! \details The input to the hash is laid out as a NIC would for an inbound TCP/IPv4 packet
+//! (source address, destination address, source port, destination port, in network byte order),
+//! so for a given key a connection lands on the same shard as the NIC's RSS queue would pick.
+template <typename AdaptT>
+size_t TCPShardedEngine<AdaptT>::shard_of(const FourTuple &tuple) const {
+    char input[12];
+    const uint32_t src = htonl(tuple.remote_address), dst = htonl(tuple.local_address);
+    const uint16_t sport = htons(tuple.remote_port), dport = htons(tuple.local_port);
+    memcpy(input, &src, 4);
+    memcpy(input + 4, &dst, 4);
+    memcpy(input + 8, &sport, 2);
+    memcpy(input + 10, &dport, 2);
+    return _hash({input, sizeof(input)}) % _shards.size();
+}
+
+template <typename AdaptT>
+void TCPShardedEngine<AdaptT>::_dispatch_main() {
+    try {
+        auto base_time = timestamp_ms();
+        while (not _abort) {
+            while (auto tagged = _outbound_ring.try_pop()) {
+                _outbound.push(move(tagged.value()));
+            }
+
+            const int timeout = _outbound.empty() ? ADAPTER_TICK_MS : 0;
+            if (_eventloop.wait_next_event(timeout) == EventLoop::Result::Exit) {
+                break;
+            }
+
+            const auto next_time = timestamp_ms();
+            _adapter.tick(next_time - base_time);
+            base_time = next_time;
+        }
+    } catch (const exception &e) {
+        cerr << "Exception in TCPShardedEngine dispatcher thread: " << e.what() << "\n";
+    }
+}
+
+template <typename AdaptT>
+void TCPShardedEngine<AdaptT>::_shard_main(Shard &shard) {
+    try {
+        while (not _abort) {
+            while (auto tagged = shard.inbound.try_pop()) {
+                shard.reactor.segment_received(move(tagged.value()));
+            }
+            shard.reactor.expire_timers();
+
+            shard.reactor.take_segments(shard.outbound);
+            bool handed_over = false;
+            while (not shard.outbound.empty() and _outbound_ring.try_push(move(shard.outbound.front()))) {
+                shard.outbound.pop();
+                handed_over = true;
+            }
+            if (handed_over) {
+                _wakeup.notify();
+            }
+
+            const int timeout = shard.outbound.empty() ? shard.reactor.timeout_ms() : RING_RETRY_MS;
+            shard.eventloop.wait_next_event(timeout);
+        }
+    } catch (const exception &e) {
+        cerr << "Exception in TCPShardedEngine shard thread: " << e.what() << "\n";
+    }
+    shard.reactor.shut_down();
+}
+
+template <typename AdaptT>
+TCPShardedEngine<AdaptT>::~TCPShardedEngine() {
+    try {
+        _abort.store(true);
+        {
+            lock_guard<mutex> lock(_accept_mutex);
+            ++_accept_generation;
+        }
+        _acceptable.notify_all();
+
+        _wakeup.notify();
+        _dispatcher.join();
+        for (auto &shard : _shards) {
+            shard->wakeup.notify();
+            shard->thread.join();
+        }
+    } catch (const exception &e) {
+        cerr << "Exception destructing TCPShardedEngine: " << e.what() << endl;
+    }
+}
+
+template <typename AdaptT>
+void TCPShardedEngine<AdaptT>::listen(const uint16_t port) {
+    for (auto &shard : _shards) {
+        shard->reactor.listen(port);
+    }
+}
+
+template <typename AdaptT>
+void TCPShardedEngine<AdaptT>::set_syn_cookie_mode(const TCPDemultiplexer::SynCookieMode mode) {
+    for (auto &shard : _shards) {
+        shard->reactor.set_syn_cookie_mode(mode);
+    }
+}
+
+//! \details Shards are tried in turn, starting after the one that the previous accept() took from,
+//! so that a busy shard cannot starve the others.
+template <typename AdaptT>
+TCPReactor::Handle TCPShardedEngine<AdaptT>::accept() {
+    while (true) {
+        uint64_t generation = 0;
+        size_t first = 0;
+        {
+            lock_guard<mutex> lock(_accept_mutex);
+            generation = _accept_generation;
+            first = _next_accept_shard;
+        }
+
+        for (size_t i = 0; i < _shards.size(); ++i) {
+            const size_t index = (first + i) % _shards.size();
+            auto handle = _shards[index]->reactor.try_accept();
+            if (handle) {
+                lock_guard<mutex> lock(_accept_mutex);
+                _next_accept_shard = (index + 1) % _shards.size();
+                return move(handle.value());
+            }
+        }
+
+        unique_lock<mutex> lock(_accept_mutex);
+        _acceptable.wait(lock, [&] { return _abort or _accept_generation != generation; });
+        if (_abort) {
+            throw runtime_error("TCPShardedEngine: accept() after shut down");
+        }
+    }
+}
+
+//! Specialization of TCPShardedEngine for TCPOverUDPSocketAdapter
+template class TCPShardedEngine<TCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPShardedEngine for TCPOverIPv4OverTunFdAdapter
+template class TCPShardedEngine<TCPOverIPv4OverTunFdAdapter>;
+
+//! Specialization of TCPShardedEngine for TCPOverIPv4OverEthernetAdapter
+template class TCPShardedEngine<TCPOverIPv4OverEthernetAdapter>;
@@ -0,0 +1,142 @@
+#ifndef SPONGE_LIBSPONGE_TCP_SHARDED_ENGINE_HH
+#define SPONGE_LIBSPONGE_TCP_SHARDED_ENGINE_HH
+
+#include "eventfd.hh"
+#include "eventloop.hh"
+#include "fd_adapter.hh"
+#include "four_tuple.hh"
+#include "ring_buffer.hh"
+#include "tcp_config.hh"
+#include "tcp_reactor.hh"
+#include "toeplitz.hh"
+#include "tuntap_adapter.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+//! \brief Runs many TCP connections over one adapter, spread across several worker threads
+//! \details Connections are sharded the way a NIC does receive-side scaling: the Toeplitz hash of a
+//! connection's 4-tuple picks the shard that owns it for its whole life. Each shard is a thread with its
+//! own TCPReactor (connections, timers and buffers), so shards share no locks with each other.
+//!
+//! One dispatcher thread owns the adapter. It steers each segment it reads to its shard through that
+//! shard's lock-free RingBuffer, and sends the segments that the shards leave in a shared lock-free
+//! RingBuffer. If a shard falls behind and its ring fills up, further segments for it are dropped (and
+//! counted), as a NIC would; TCP retransmits them.
+template <typename AdaptT>
+class TCPShardedEngine {
+  private:
+    //! One worker thread and the connections it owns
+    struct Shard {
+        EventFD wakeup{};                      //!< notified when `inbound` or the reactor has work
+        RingBuffer<TaggedSegment> inbound;     //!< segments steered to this shard by the dispatcher
+        TCPReactor reactor;                    //!< the shard's connections and timers
+        EventLoop eventloop{};                 //!< polls `wakeup`
+        std::queue<TaggedSegment> outbound{};  //!< segments waiting for room in the engine's outbound ring
+        std::thread thread{};
+
+        Shard(const TCPConfig &cfg, const size_t backlog, const size_t ring_capacity);
+    };
+
+    //! Adapter to the underlying datagram socket (e.g., UDP or IP); used only by the dispatcher thread
+    AdaptT _adapter;
+
+    ToeplitzHash _hash{};
+
+    //! notified by the shards when they have put segments in `_outbound_ring`
+    EventFD _wakeup{};
+
+    //! segments from all shards, waiting for the dispatcher to send them
+    RingBuffer<TaggedSegment> _outbound_ring;
+
+    std::vector<std::unique_ptr<Shard>> _shards{};
+
+    EventLoop _eventloop{};
+
+    //! segments taken from `_outbound_ring` and waiting for the adapter to be writable
+    std::queue<TaggedSegment> _outbound{};
+
+    std::atomic_bool _abort{false};  //!< Flag used by the owner to force all threads to shut down
+
+    std::atomic<uint64_t> _dropped{0};
+
+    //! \name Blocking accept() across shards
+    //!@{
+    std::mutex _accept_mutex{};
+    std::condition_variable _acceptable{};
+    uint64_t _accept_generation{0};  //!< incremented whenever some shard has connections to accept
+    size_t _next_accept_shard{0};
+    //!@}
+
+    std::thread _dispatcher{};
+
+    //! Main loop of the dispatcher thread
+    void _dispatch_main();
+
+    //! Main loop of a shard's thread
+    void _shard_main(Shard &shard);
+
+    //! The shard that owns the connection with this tuple
+    Shard &_shard_for(const FourTuple &tuple) { return *_shards[shard_of(tuple)]; }
+
+  public:
+    //! \param[in] adapter is the adapter that all connections share
+    //! \param[in] cfg is the configuration of every TCPConnection
+    //! \param[in] num_shards is the number of worker threads
+    //! \param[in] backlog is the maximum number of connections per shard that may be embryonic or waiting for accept()
+    //! \param[in] ring_capacity is the capacity of each ring (a power of two)
+    TCPShardedEngine(AdaptT &&adapter,
+                     const TCPConfig &cfg,
+                     const size_t num_shards,
+                     const size_t backlog = 16,
+                     const size_t ring_capacity = 4096);
+
+    //! Stop all threads; blocked application threads fail, and remaining connections are dropped
+    ~TCPShardedEngine();
+
+    //! Accept connections addressed to `port` (in every shard)
+    void listen(const uint16_t port);
+
+    //! Choose when SYNs are answered with SYN cookies (in every shard)
+    void set_syn_cookie_mode(const TCPDemultiplexer::SynCookieMode mode);
+
+    //! Block until a connection (in any shard) has completed its handshake, and take it
+    TCPReactor::Handle accept();
+
+    //! Actively open a connection, in the shard that its tuple hashes to
+    TCPReactor::Handle connect(const FourTuple &tuple) { return _shard_for(tuple).reactor.connect(tuple); }
+
+    //! Index of the shard that owns the connection with this tuple
+    size_t shard_of(const FourTuple &tuple) const;
+
+    //! Number of shards
+    size_t num_shards() const { return _shards.size(); }
+
+    //! The connections of shard `i`
+    TCPReactor &shard(const size_t i) { return _shards.at(i)->reactor; }
+
+    //! Number of inbound segments dropped because their shard's ring was full
+    uint64_t dropped() const { return _dropped.load(); }
+
+    //! \name
+    //! This object cannot be moved or copied, since it is in use by several threads simultaneously
+    //!@{
+    TCPShardedEngine(const TCPShardedEngine &other) = delete;
+    TCPShardedEngine(TCPShardedEngine &&other) = delete;
+    TCPShardedEngine &operator=(const TCPShardedEngine &other) = delete;
+    TCPShardedEngine &operator=(TCPShardedEngine &&other) = delete;
+    //!@}
+};
+
+using TCPOverUDPShardedEngine = TCPShardedEngine<TCPOverUDPSocketAdapter>;
+using TCPOverIPv4ShardedEngine = TCPShardedEngine<TCPOverIPv4OverTunFdAdapter>;
+using TCPOverIPv4OverEthernetShardedEngine = TCPShardedEngine<TCPOverIPv4OverEthernetAdapter>;
+
+#endif  // SPONGE_LIBSPONGE_TCP_SHARDED_ENGINE_HH
@@ -17,9 +17,29 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
 }
 
 optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
+    optional<InternetDatagram> ip_dgram = read_datagram();
+
+    // Try to interpret IPv4 datagram as TCP
+    if (ip_dgram) {
+        return unwrap_tcp_in_ip(ip_dgram.value());
+    }
+    return {};
+}
+
+optional<TaggedSegment> TCPOverIPv4OverEthernetAdapter::read_tagged() {
+    optional<InternetDatagram> ip_dgram = read_datagram();
+
+    // Try to interpret IPv4 datagram as TCP, whichever connection it belongs to
+    if (ip_dgram) {
+        return unwrap_tagged_tcp_in_ip(ip_dgram.value());
+    }
+    return {};
+}
+
+optional<InternetDatagram> TCPOverIPv4OverEthernetAdapter::read_datagram() {
     // Read Ethernet frame from the raw device
     EthernetFrame frame;
-    if (frame.parse(_tap.read()) != ParseResult::NoError) {
+    if (frame.parse(_tap.read_packet()) != ParseResult::NoError) {
         return {};
     }
 
@@ -29,11 +49,7 @@ optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
     // The incoming frame may have caused the NetworkInterface to send a frame.
     send_pending();
 
-    // Try to interpret IPv4 datagram as TCP
-    if (ip_dgram) {
-        return unwrap_tcp_in_ip(ip_dgram.value());
-    }
-    return {};
+    return ip_dgram;
 }
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
@@ -48,6 +64,12 @@ void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
     send_pending();
 }
 
+//! \param[in] tagged the TCPSegment to send, and the connection it belongs to
+void TCPOverIPv4OverEthernetAdapter::write_tagged(TaggedSegment &tagged) {
+    _interface.send_datagram(wrap_tcp_in_ip(tagged.tuple, tagged.segment), _next_hop);
+    send_pending();
+}
+
 void TCPOverIPv4OverEthernetAdapter::send_pending() {
     while (not _interface.frames_out().empty()) {
         _tap.write(_interface.frames_out().front().serialize());
@@ -19,17 +19,17 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     explicit TCPOverIPv4OverTunFdAdapter(TunFD &&tun) : _tun(std::move(tun)) {}
 
     //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
-    std::optional<TCPSegment> read() {
-        InternetDatagram ip_dgram;
-        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
-            return {};
-        }
-        return unwrap_tcp_in_ip(ip_dgram);
-    }
+    std::optional<TCPSegment> read() { return unwrap_tcp_in_ip(_tun.read_packet()); }
 
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
     void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
 
+    //! Attempts to read and parse an IPv4 datagram containing a TCP segment of any connection
+    std::optional<TaggedSegment> read_tagged() { return unwrap_tagged_tcp_in_ip(_tun.read_packet()); }
+
+    //! Creates an IPv4 datagram from a TCP segment of the given connection and writes it to the TUN device
+    void write_tagged(TaggedSegment &tagged) { _tun.write(wrap_tcp_in_ip(tagged.tuple, tagged.segment).serialize()); }
+
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
 
@@ -51,6 +51,9 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
 
     void send_pending();  //!< Sends any pending Ethernet frames
 
+    //! Reads an Ethernet frame and hands it to the NetworkInterface, returning any IPv4 datagram it carried
+    std::optional<InternetDatagram> read_datagram();
+
   public:
     //! Construct from a TapFD
     explicit TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
@@ -63,6 +66,12 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
     //! Sends a TCP segment (in an IPv4 datagram, in an Ethernet frame).
     void write(TCPSegment &seg);
 
+    //! Attempts to read and parse an Ethernet frame containing a TCP segment of any connection
+    std::optional<TaggedSegment> read_tagged();
+
+    //! Sends a TCP segment of the given connection (in an IPv4 datagram, in an Ethernet frame).
+    void write_tagged(TaggedSegment &tagged);
+
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
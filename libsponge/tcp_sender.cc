@@ -70,7 +70,7 @@ void TCPSender::fill_window() {
             if (stream_in().eof() && next_seqno_absolute() == stream_in().bytes_written() + 2)
                 break;
             //! \details make sure the payload size
-            size_t payload_size = min(TCPConfig::MAX_PAYLOAD_SIZE,
+            size_t payload_size = min(_max_payload_size,
                                     min(window_left_size, 
                                     stream_in().buffer_size()));
 
@@ -163,6 +163,11 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
 
 unsigned int TCPSender::consecutive_retransmissions() const { return _consecutive_retransmissions; }
 
+optional<size_t> TCPSender::time_until_retransmission() const {
+    if (_timer.is_closed()) return {};
+    return _timer.time_left();
+}
+
 void TCPSender::send_empty_segment() {
     TCPSegment segment;
     segment.header() = make_header(wrap(_next_seqno, _isn));
@@ -6,6 +6,7 @@
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <functional>
 #include <queue>
 
@@ -30,7 +31,9 @@ class Timer {
     //! \brief double the retransmission timeout in the timer
     void double_rto() { _rto *= 2; }
     //! \brief if the time is closed
-    bool is_closed() { return _closed; }
+    bool is_closed() const { return _closed; }
+    //! \brief the time left before the timer expires (if it is running)
+    size_t time_left() const { return _time_left; }
     //! \brief check if the timer is expired when call tick()
     bool is_expired(const size_t& ms_since_last_tick);
 };
@@ -69,6 +72,8 @@ class TCPSender {
     size_t _consecutive_retransmissions{0};
     //! the retransimission timer
     Timer _timer;
+    //! most payload bytes in a segment (less than TCPConfig::MAX_PAYLOAD_SIZE if the peer's MSS is smaller)
+    size_t _max_payload_size{TCPConfig::MAX_PAYLOAD_SIZE};
     //! Make a TCP header
     TCPHeader make_header(const WrappingInt32&& seqno, bool syn = false, bool fin = false) const;
     //! "Send" a TCP segment
@@ -102,6 +107,9 @@ class TCPSender {
     void tick(const size_t ms_since_last_tick);
     //!@}
 
+    //! \brief The peer announced (in its SYN) the largest segment payload it accepts
+    void set_peer_mss(const uint16_t mss) { _max_payload_size = std::min<size_t>(TCPConfig::MAX_PAYLOAD_SIZE, mss); }
+
     //! \name Accessors
     //!@{
 
@@ -113,6 +121,9 @@ class TCPSender {
     //! \brief Number of consecutive retransmissions that have occurred in a row
     unsigned int consecutive_retransmissions() const;
 
+    //! \brief Milliseconds until the retransmission timer expires, or empty if it is not running
+    std::optional<size_t> time_until_retransmission() const;
+
     //! \brief TCPSegments that the TCPSender has enqueued for transmission.
     //! \note These must be dequeued and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
@@ -1,17 +1,92 @@
 #include "buffer.hh"
 
+#include "util.hh"
+
+#include <new>
+
 using namespace std;
 
+Buffer::Storage *Buffer::_allocate(const size_t capacity) {
+    if (capacity <= POOLED_CAPACITY) {
+        void *const slot = PacketPool::allocate();
+        auto *const storage = new (slot) Storage;
+        storage->data = static_cast<char *>(slot) + POOLED_OFFSET;
+        storage->capacity = POOLED_CAPACITY;
+        storage->pooled = true;
+        return storage;
+    }
+
+    auto *const storage = new Storage;
+    storage->owned.resize(capacity);
+    storage->data = storage->owned.data();
+    storage->capacity = capacity;
+    return storage;
+}
+
+Buffer::Storage *Buffer::_adopt(string &&str, const size_t headroom) {
+    auto *const storage = new Storage;
+    storage->owned = move(str);
+    storage->data = storage->owned.data();
+    storage->size = storage->capacity = storage->owned.size();
+    storage->head = headroom;
+    return storage;
+}
+
+void Buffer::_destroy(Storage *storage) noexcept {
+    if (storage->pooled) {
+        storage->~Storage();
+        PacketPool::deallocate(storage);
+    } else {
+        delete storage;
+    }
+}
+
 void Buffer::remove_prefix(const size_t n) {
     if (n > str().size()) {
         throw out_of_range("Buffer::remove_prefix");
     }
     _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
-        _storage.reset();
+    if (_storage and _starting_offset == _storage->size) {
+        _release();
     }
 }
 
+uint8_t *Buffer::claim_headroom(const size_t n) {
+    if (not _storage or n > _starting_offset) {
+        return nullptr;
+    }
+
+    size_t expected = _starting_offset;
+    if (not _storage->head.compare_exchange_strong(expected, _starting_offset - n)) {
+        return nullptr;
+    }
+
+    _starting_offset -= n;
+    return reinterpret_cast<uint8_t *>(_storage->data + _starting_offset);
+}
+
+//! \details The cache holds the sum for one starting offset (usually the only one in use); a Buffer
+//! that has discarded a different prefix recomputes its sum and takes over the cache. Copies of a
+//! Buffer may be used from different threads, so the cache is a single atomic word.
+uint16_t Buffer::partial_checksum() const {
+    if (not _storage) {
+        return 0;
+    }
+
+    constexpr uint64_t VALID = uint64_t(1) << 63;
+    const uint64_t key = VALID | (uint64_t(_starting_offset & 0xffffffff) << 16);
+    const uint64_t cached = _storage->partial_checksum.load(memory_order_relaxed);
+    if ((cached & ~uint64_t(0xffff)) == key and _starting_offset <= 0xffffffff) {
+        return cached & 0xffff;
+    }
+
+    InternetChecksum check;
+    check.add(str());
+    const uint16_t sum = ~check.value();
+    _storage->partial_checksum.store(key | sum, memory_order_relaxed);
+    return sum;
+}
+
 void BufferList::append(const BufferList &other) {
     for (const auto &buf : other._buffers) {
         _buffers.push_back(buf);
@@ -95,10 +170,15 @@ size_t BufferViewList::size() const {
 }
 
 vector<iovec> BufferViewList::as_iovecs() const {
-    vector<iovec> ret;
-    ret.reserve(_views.size());
-    for (const auto &x : _views) {
-        ret.push_back({const_cast<char *>(x.data()), x.size()});
-    }
+    vector<iovec> ret(_views.size());
+    as_iovecs(ret.data(), ret.size());
     return ret;
 }
+
+size_t BufferViewList::as_iovecs(iovec *iovecs, const size_t max) const {
+    const size_t n = min(max, _views.size());
+    for (size_t i = 0; i < n; ++i) {
+        iovecs[i] = {const_cast<char *>(_views[i].data()), _views[i].size()};
+    }
+    return n;
+}
@@ -1,27 +1,115 @@
 #ifndef SPONGE_LIBSPONGE_BUFFER_HH
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
+#include "packet_pool.hh"
+#include "small_vector.hh"
+
 #include <algorithm>
-#include <deque>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <numeric>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <sys/uio.h>
+#include <utility>
 #include <vector>
 
 //! \brief A reference-counted read-only string that can discard bytes from the front
+//! \details The bytes are either a string that the Buffer took over, or (for a Buffer built by a
+//! PacketBuffer) a slot from the PacketPool, with the reference count and the other shared bookkeeping
+//! in front of the bytes, so that a packet costs no call to the general-purpose allocator.
 class Buffer {
   private:
-    std::shared_ptr<std::string> _storage{};
+    friend class PacketBuffer;
+
+    //! Shared by every copy of a Buffer, and freed with the last one
+    struct Storage {
+        //! number of Buffers that share the storage (atomic, since copies of a Buffer may be used from
+        //! different threads)
+        std::atomic<size_t> refcount{1};
+
+        //! partial_checksum() of the data from some starting offset, shared by every copy of the Buffer:
+        //! bit 63 is set once it is valid, bits 16-47 hold the offset, and bits 0-15 hold the sum
+        std::atomic<uint64_t> partial_checksum{0};
+
+        //! offset of the first byte that any Buffer may use; the bytes before it are free headroom
+        std::atomic<size_t> head{0};
+
+        char *data{};         //!< the bytes: in the same PacketPool slot, or in `owned`
+        size_t size{};        //!< number of bytes in use
+        size_t capacity{};    //!< number of bytes available
+        bool pooled{};        //!< whether the storage is a PacketPool slot
+        std::string owned{};  //!< backing string, unless the storage is pooled
+    };
+
+    //! Room for the bytes in a PacketPool slot, after the Storage
+    static constexpr size_t POOLED_OFFSET = (sizeof(Storage) + 15) & ~size_t(15);
+
+    Storage *_storage{};
     size_t _starting_offset{};
 
+    //! \brief New storage (with no bytes in use) for at least `capacity` bytes, from the PacketPool if they fit
+    static Storage *_allocate(const size_t capacity);
+
+    //! \brief New storage holding the contents of `str`
+    static Storage *_adopt(std::string &&str, const size_t headroom);
+
+    //! \brief Free the storage once its last Buffer has let go of it
+    static void _destroy(Storage *storage) noexcept;
+
+    //! \brief Let go of the storage
+    void _release() noexcept {
+        if (_storage and _storage->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            _destroy(_storage);
+        }
+        _storage = nullptr;
+    }
+
   public:
+    //! Number of bytes that fit in storage from the PacketPool
+    static constexpr size_t POOLED_CAPACITY = PacketPool::SLOT_SIZE - POOLED_OFFSET;
+
     Buffer() = default;
 
     //! \brief Construct by taking ownership of a string
-    Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
+    Buffer(std::string &&str) noexcept : _storage(_adopt(std::move(str), 0)) {}
+
+    //! \brief Construct by taking ownership of a string whose first `headroom` bytes are free space
+    //! \details The Buffer starts after the headroom, which can be taken with claim_headroom().
+    Buffer(std::string &&str, const size_t headroom)
+        : _storage(_adopt(std::move(str), headroom)), _starting_offset(headroom) {}
+
+    //! \name Copy and move (a copy shares the storage)
+    //!@{
+    Buffer(const Buffer &other) noexcept : _storage(other._storage), _starting_offset(other._starting_offset) {
+        if (_storage) {
+            _storage->refcount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Buffer(Buffer &&other) noexcept
+        : _storage(std::exchange(other._storage, nullptr)), _starting_offset(other._starting_offset) {}
+
+    Buffer &operator=(const Buffer &other) noexcept {
+        Buffer copy{other};
+        std::swap(_storage, copy._storage);
+        _starting_offset = copy._starting_offset;
+        return *this;
+    }
+
+    Buffer &operator=(Buffer &&other) noexcept {
+        if (this != &other) {
+            _release();
+            _storage = std::exchange(other._storage, nullptr);
+            _starting_offset = other._starting_offset;
+        }
+        return *this;
+    }
+
+    ~Buffer() { _release(); }
+    //!@}
 
     //! \name Expose contents as a std::string_view
     //!@{
@@ -29,7 +117,7 @@ class Buffer {
         if (not _storage) {
             return {};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return {_storage->data + _starting_offset, _storage->size - _starting_offset};
     }
 
     operator std::string_view() const { return str(); }
@@ -44,9 +132,21 @@ class Buffer {
     //! \brief Make a copy to a new std::string
     std::string copy() const { return std::string(str()); }
 
+    //! \brief The one's-complement sum of the contents, as used by InternetChecksum::add_partial_sum()
+    //! \details Computed on first use and cached in the shared storage, so that a payload that is
+    //! checksummed many times (e.g. a TCP segment that is retransmitted) is only summed once.
+    uint16_t partial_checksum() const;
+
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Grow the Buffer by `n` bytes at the front, taking them from the free headroom in its storage
+    //! \details Succeeds only if the `n` bytes just in front of the Buffer are unclaimed headroom: the first
+    //! Buffer to claim them owns them, and its copies (or any other Buffer sharing the storage) cannot claim
+    //! them again, so prepending a header never overwrites bytes that another Buffer can see.
+    //! \returns a pointer to the `n` new bytes (for the caller to fill in), or `nullptr` if there is no room
+    uint8_t *claim_headroom(const size_t n);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -54,9 +154,14 @@ class Buffer {
 //! + a payload. This allows us to prepend headers (e.g., to
 //! encapsulate a TCP payload in a TCPSegment, and then encapsulate
 //! the TCPSegment in an IPv4Datagram) without copying the payload.
+//! Room for the usual handful of Buffers (headers plus payload) is kept inline.
 class BufferList {
+  public:
+    //! The sequence of Buffers
+    using Buffers = SmallVector<Buffer, 4>;
+
   private:
-    std::deque<Buffer> _buffers{};
+    Buffers _buffers{};
 
   public:
     //! \name Constructors
@@ -65,17 +170,14 @@ class BufferList {
     BufferList() = default;
 
     //! \brief Construct from a Buffer
-    BufferList(Buffer buffer) : _buffers{buffer} {}
+    BufferList(Buffer buffer) { _buffers.push_back(std::move(buffer)); }
 
     //! \brief Construct by taking ownership of a std::string
-    BufferList(std::string &&str) noexcept {
-        Buffer buf{std::move(str)};
-        append(buf);
-    }
+    BufferList(std::string &&str) noexcept { _buffers.emplace_back(std::move(str)); }
     //!@}
 
     //! \brief Access the underlying queue of Buffers
-    const std::deque<Buffer> &buffers() const { return _buffers; }
+    const Buffers &buffers() const { return _buffers; }
 
     //! \brief Append a BufferList
     void append(const BufferList &other);
@@ -96,7 +198,7 @@ class BufferList {
 
 //! \brief A non-owning temporary view (similar to std::string_view) of a discontiguous string
 class BufferViewList {
-    std::deque<std::string_view> _views{};
+    SmallVector<std::string_view, 4> _views{};
 
   public:
     //! \name Constructors
@@ -112,7 +214,7 @@ class BufferViewList {
     BufferViewList(const BufferList &buffers);
 
     //! \brief Construct from a std::string_view
-    BufferViewList(std::string_view str) { _views.push_back({const_cast<char *>(str.data()), str.size()}); }
+    BufferViewList(std::string_view str) { _views.push_back(str); }
     //!@}
 
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
@@ -121,10 +223,17 @@ class BufferViewList {
     //! \brief Size of the string
     size_t size() const;
 
+    //! \brief Number of discontiguous pieces
+    size_t count() const { return _views.size(); }
+
     //! \brief Convert to a vector of `iovec` structures
     //! \note used for system calls that write discontiguous buffers,
     //! e.g. [writev(2)](\ref man2::writev) and [sendmsg(2)](\ref man2::sendmsg)
     std::vector<iovec> as_iovecs() const;
+
+    //! \brief Fill the caller's array (e.g. on the stack) with `iovec` structures for the first pieces
+    //! \returns the number of `iovec`s filled in: count(), or `max` if there are more pieces than that
+    size_t as_iovecs(iovec *iovecs, const size_t max) const;
 };
 
 #endif  // SPONGE_LIBSPONGE_BUFFER_HH
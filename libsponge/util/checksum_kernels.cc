@@ -0,0 +1,74 @@
+#include "checksum_kernels.hh"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//! \details The 64-bit accumulator cannot overflow before 2^31 iterations (16 GiB of data).
+uint64_t checksum_kernel_word64(const uint8_t *data, const size_t len) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        sum += (word & 0xffffffff) + (word >> 32);
+    }
+    for (; i + 2 <= len; i += 2) {
+        uint16_t word;
+        memcpy(&word, data + i, sizeof(word));
+        sum += word;
+    }
+    return sum;
+}
+
+#if defined(__x86_64__)
+uint64_t checksum_kernel_sse2(const uint8_t *data, const size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(v, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(v, zero));
+    }
+
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    return lanes[0] + lanes[1] + checksum_kernel_word64(data + i, len - i);
+}
+
+__attribute__((target("avx2"))) uint64_t checksum_kernel_avx2(const uint8_t *data, const size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        acc = _mm256_add_epi64(acc, _mm256_unpacklo_epi32(v, zero));
+        acc = _mm256_add_epi64(acc, _mm256_unpackhi_epi32(v, zero));
+    }
+
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + checksum_kernel_word64(data + i, len - i);
+}
+#endif
+
+vector<pair<string, ChecksumKernel>> available_checksum_kernels() {
+    vector<pair<string, ChecksumKernel>> kernels{{"word64", checksum_kernel_word64}};
+#if defined(__x86_64__)
+    kernels.emplace_back("sse2", checksum_kernel_sse2);
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.emplace_back("avx2", checksum_kernel_avx2);
+    }
+#endif
+    return kernels;
+}
+
+ChecksumKernel best_checksum_kernel() {
+    static const ChecksumKernel best = available_checksum_kernels().back().second;
+    return best;
+}
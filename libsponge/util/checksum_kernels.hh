@@ -0,0 +1,37 @@
+#ifndef SPONGE_LIBSPONGE_CHECKSUM_KERNELS_HH
+#define SPONGE_LIBSPONGE_CHECKSUM_KERNELS_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! \brief A routine that adds up a run of bytes for InternetChecksum
+//! \details The kernel treats `data` as 16-bit words in *host* byte order and returns their sum,
+//! unfolded. Since the one's-complement sum commutes with byte swapping (RFC 1071, section 2(B)),
+//! InternetChecksum folds the result and swaps it to network order once per call. `len` must be even.
+using ChecksumKernel = uint64_t (*)(const uint8_t *data, const size_t len);
+
+//! \name Kernels behind InternetChecksum::add
+//!@{
+
+//! Portable: eight bytes per iteration, added as two 32-bit halves into a 64-bit accumulator
+uint64_t checksum_kernel_word64(const uint8_t *data, const size_t len);
+
+#if defined(__x86_64__)
+//! 16 bytes per iteration, widened to two 64-bit lanes (every x86-64 CPU has SSE2)
+uint64_t checksum_kernel_sse2(const uint8_t *data, const size_t len);
+
+//! 32 bytes per iteration, widened to four 64-bit lanes; only call it if the CPU supports AVX2
+uint64_t checksum_kernel_avx2(const uint8_t *data, const size_t len);
+#endif
+//!@}
+
+//! The kernels this CPU can run, with their names, slowest first
+std::vector<std::pair<std::string, ChecksumKernel>> available_checksum_kernels();
+
+//! The fastest kernel this CPU can run (detected once, on first use)
+ChecksumKernel best_checksum_kernel();
+
+#endif  // SPONGE_LIBSPONGE_CHECKSUM_KERNELS_HH
@@ -0,0 +1,139 @@
+#include "epoch.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+//! Epoch of a thread that is not inside a Guard
+constexpr uint64_t IDLE = 0;
+
+//! The epoch, advanced by each defer(); starts above IDLE
+atomic<uint64_t> global_epoch{1};
+
+//! A thread's announcement of the epoch it entered its Guard at; records are reused, never freed
+struct Record {
+    atomic<uint64_t> epoch{IDLE};
+    atomic<bool> in_use{true};
+    Record *next = nullptr;
+};
+
+atomic<Record *> records{nullptr};
+
+//! Claim an unused record, or add a new one
+Record *acquire_record() {
+    for (Record *record = records.load(); record; record = record->next) {
+        bool expected = false;
+        if (record->in_use.compare_exchange_strong(expected, true)) {
+            return record;
+        }
+    }
+
+    Record *record = new Record;
+    record->next = records.load();
+    while (not records.compare_exchange_weak(record->next, record)) {
+    }
+    return record;
+}
+
+//! This thread's record (claimed on first use, released when the thread exits) and Guard depth
+struct LocalState {
+    Record *record = nullptr;
+    unsigned depth = 0;
+
+    LocalState() = default;
+    LocalState(const LocalState &other) = delete;
+    LocalState &operator=(const LocalState &other) = delete;
+
+    ~LocalState() {
+        if (record) {
+            record->epoch.store(IDLE);
+            record->in_use.store(false);
+        }
+    }
+};
+
+thread_local LocalState local{};
+
+//! Reclamations not yet run, in the order they were deferred (so, mostly, in epoch order)
+struct Deferred {
+    mutex lock{};
+    deque<pair<uint64_t, function<void()>>> queue{};
+};
+
+Deferred &deferred() {
+    static Deferred *const ret = new Deferred;
+    return *ret;
+}
+
+}  // namespace
+
+Epoch::Guard::Guard() {
+    if (local.depth++ == 0) {
+        if (not local.record) {
+            local.record = acquire_record();
+        }
+        local.record->epoch.store(global_epoch.load(), memory_order_relaxed);
+
+        // the announcement must be visible before this thread reads any shared pointer (see reclaim())
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+}
+
+Epoch::Guard::~Guard() {
+    if (--local.depth == 0) {
+        local.record->epoch.store(IDLE, memory_order_release);
+    }
+}
+
+//! \details The caller must already have unpublished what `reclaim` frees. A reader that enters its
+//! Guard after the epoch advances here cannot find it; one that entered before holds back reclaim().
+void Epoch::defer(function<void()> reclaim) {
+    const uint64_t epoch = global_epoch.fetch_add(1);
+
+    Deferred &all = deferred();
+    const lock_guard<mutex> guard(all.lock);
+    all.queue.emplace_back(epoch, move(reclaim));
+}
+
+size_t Epoch::reclaim() {
+    // pairs with the fence in Guard(): either a reader's announcement is seen here, or the reader
+    // sees the writes that unpublished every object deferred so far
+    atomic_thread_fence(memory_order_seq_cst);
+
+    uint64_t oldest_reader = UINT64_MAX;
+    for (Record *record = records.load(); record; record = record->next) {
+        const uint64_t epoch = record->epoch.load();
+        if (epoch != IDLE and epoch < oldest_reader) {
+            oldest_reader = epoch;
+        }
+    }
+
+    vector<function<void()>> ready;
+    {
+        Deferred &all = deferred();
+        const lock_guard<mutex> guard(all.lock);
+        while (not all.queue.empty() and all.queue.front().first < oldest_reader) {
+            ready.push_back(move(all.queue.front().second));
+            all.queue.pop_front();
+        }
+    }
+
+    // run outside the lock, as a reclamation may defer another
+    for (auto &reclaim : ready) {
+        reclaim();
+    }
+    return ready.size();
+}
+
+size_t Epoch::pending() {
+    Deferred &all = deferred();
+    const lock_guard<mutex> guard(all.lock);
+    return all.queue.size();
+}
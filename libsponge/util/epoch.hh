@@ -0,0 +1,42 @@
+#ifndef SPONGE_LIBSPONGE_EPOCH_HH
+#define SPONGE_LIBSPONGE_EPOCH_HH
+
+#include <cstddef>
+#include <functional>
+
+//! \brief Epoch-based reclamation, so that readers of shared structures never take a lock
+//! \details A writer that replaces an object readers may be using (e.g. by swapping an atomic pointer)
+//! hands the old one to retire() instead of deleting it. Readers hold a Guard while they use such
+//! objects. An object retired at some epoch is freed by reclaim() only once every thread that was
+//! inside a Guard at that epoch has left it, so a reader never sees an object freed under it.
+//! Entering and leaving a Guard costs a store and a fence; readers should hold one across a batch.
+class Epoch {
+  public:
+    //! \brief Marks the calling thread as reading shared objects, for the Guard's lifetime
+    //! \note Guards may nest; only the outermost one has any cost
+    class Guard {
+      public:
+        Guard();
+        ~Guard();
+        Guard(const Guard &other) = delete;
+        Guard &operator=(const Guard &other) = delete;
+    };
+
+    //! \brief Run `reclaim` once no reader can still hold what was unpublished before this call
+    static void defer(std::function<void()> reclaim);
+
+    //! \brief Delete `object` once no reader can still hold it
+    template <typename T>
+    static void retire(T *object) {
+        defer([object] { delete object; });
+    }
+
+    //! \brief Run the deferred reclamations that are now safe
+    //! \returns the number that were run
+    static size_t reclaim();
+
+    //! Number of deferred reclamations not run yet
+    static size_t pending();
+};
+
+#endif  // SPONGE_LIBSPONGE_EPOCH_HH
@@ -0,0 +1,21 @@
+#include "eventfd.hh"
+
+#include "util.hh"
+
+#include <cerrno>
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+EventFD::EventFD() : FileDescriptor(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK))) {}
+
+//! \details Calls write(2) directly rather than FileDescriptor::write(), which would update the
+//! (unsynchronized) write counter shared with the polling thread.
+void EventFD::notify() const {
+    const uint64_t one = 1;
+    SystemCall("write", ::write(fd_num(), &one, sizeof(one)), EAGAIN);
+}
+
+void EventFD::clear() { read(sizeof(uint64_t)); }
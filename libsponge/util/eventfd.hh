@@ -0,0 +1,21 @@
+#ifndef SPONGE_LIBSPONGE_EVENTFD_HH
+#define SPONGE_LIBSPONGE_EVENTFD_HH
+
+#include "file_descriptor.hh"
+
+//! \brief A FileDescriptor to a non-blocking [eventfd](\ref man2::eventfd), used to wake a thread blocked in poll(2)
+//! \details notify() may be called from any thread; the fd becomes readable until the waiting
+//! thread calls clear(), so any number of notifications between two polls cost one wakeup.
+class EventFD : public FileDescriptor {
+  public:
+    //! Create a new eventfd
+    EventFD();
+
+    //! Make the fd readable (safe to call from any thread)
+    void notify() const;
+
+    //! Consume all notifications so far (call from the thread that polls the fd)
+    void clear();
+};
+
+#endif  // SPONGE_LIBSPONGE_EVENTFD_HH
@@ -1,5 +1,6 @@
 #include "file_descriptor.hh"
 
+#include "packet_buffer.hh"
 #include "util.hh"
 
 #include <algorithm>
@@ -73,13 +74,29 @@ string FileDescriptor::read(const size_t limit) {
     return ret;
 }
 
+Buffer FileDescriptor::read_packet() {
+    PacketBuffer packet{0};
+    auto iovecs = packet.read_iovecs();
+
+    const ssize_t bytes_read = SystemCall("readv", ::readv(fd_num(), iovecs.data(), iovecs.size()));
+    if (bytes_read == 0) {
+        _internal_fd->_eof = true;
+    }
+    packet.commit_read(bytes_read);
+
+    register_read();
+    return packet.release();
+}
+
 size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     size_t total_bytes_written = 0;
 
     do {
-        auto iovecs = buffer.as_iovecs();
+        // a write of more pieces than this takes more than one writev()
+        array<iovec, 16> iovecs;
+        const size_t count = buffer.as_iovecs(iovecs.data(), iovecs.size());
 
-        const ssize_t bytes_written = SystemCall("writev", ::writev(fd_num(), iovecs.data(), iovecs.size()));
+        const ssize_t bytes_written = SystemCall("writev", ::writev(fd_num(), iovecs.data(), count));
         if (bytes_written == 0 and buffer.size() != 0) {
             throw runtime_error("write returned 0 given non-empty input buffer");
         }
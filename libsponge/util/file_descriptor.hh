@@ -61,6 +61,10 @@ class FileDescriptor {
     //! Read up to `limit` bytes into `str` (caller can allocate storage)
     void read(std::string &str, const size_t limit = std::numeric_limits<size_t>::max());
 
+    //! \brief Read one packet (from a packet-oriented file descriptor, such as a TUN or TAP device)
+    //! \details The packet is read into storage from the PacketPool if it fits (see PacketBuffer::read_iovecs()).
+    Buffer read_packet();
+
     //! Write a string, possibly blocking until all is written
     size_t write(const char *str, const bool write_all = true) { return write(BufferViewList(str), write_all); }
 
@@ -0,0 +1,89 @@
+#ifndef SPONGE_LIBSPONGE_MPSC_RING_HH
+#define SPONGE_LIBSPONGE_MPSC_RING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+//! \brief A bounded queue that any number of threads push to and one thread pops from, without locks
+//! \details A ring of slots, each with a sequence number that says whose turn it is (D. Vyukov's bounded
+//! queue). A producer claims a slot by advancing the tail with a compare-and-swap, fills it, and then
+//! publishes it by bumping its sequence; the consumer takes slots in order once they are published.
+//!
+//! Items are swapped in and out rather than copied: a producer gets back what the consumer left in the
+//! slot. With containers as items, their storage goes back and forth instead of being reallocated.
+template <typename T>
+class MPSCRing {
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        T item{};
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;
+
+    //! Next position to push to (shared by the producers)
+    alignas(64) std::atomic<size_t> _tail{0};
+
+    //! Next position to pop from (the consumer's alone)
+    alignas(64) size_t _head{0};
+
+  public:
+    //! \brief A ring of `capacity` slots (rounded up to a power of two, and at least 2)
+    explicit MPSCRing(const size_t capacity) : _slots(), _mask(1) {
+        while (_mask + 1 < capacity) {
+            _mask = (_mask << 1) | 1;
+        }
+        _slots = std::make_unique<Slot[]>(_mask + 1);
+        for (size_t i = 0; i <= _mask; i++) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPSCRing(const MPSCRing &other) = delete;
+    MPSCRing &operator=(const MPSCRing &other) = delete;
+
+    //! \brief Push `item` (swapping it with what the slot held), from any thread
+    //! \returns `false` (leaving `item` alone) if the ring is full
+    bool try_push(T &item) {
+        size_t position = _tail.load(std::memory_order_relaxed);
+        while (true) {
+            Slot &slot = _slots[position & _mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<intptr_t>(sequence - position);
+            if (lag == 0) {
+                // the slot is free: claim it, or retry at the position another producer left
+                if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    std::swap(slot.item, item);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                // the consumer has not yet taken what was pushed here a lap ago
+                return false;
+            } else {
+                position = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //! \brief Pop the oldest item into `item` (swapping it with what `item` held), from the consumer thread
+    //! \returns `false` if the ring is empty (or the next item is still being pushed)
+    bool try_pop(T &item) {
+        Slot &slot = _slots[_head & _mask];
+        if (slot.sequence.load(std::memory_order_acquire) != _head + 1) {
+            return false;
+        }
+        std::swap(slot.item, item);
+        slot.sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return true;
+    }
+
+    //! Number of slots
+    size_t capacity() const { return _mask + 1; }
+};
+
+#endif  // SPONGE_LIBSPONGE_MPSC_RING_HH
@@ -0,0 +1,95 @@
+#include "packet_buffer.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t OVERFLOW_SIZE = 65536;
+
+//! Per-thread space for the part of a received packet that does not fit in its storage
+char *overflow_area() {
+    thread_local const unique_ptr<char[]> area{new char[OVERFLOW_SIZE]};
+    return area.get();
+}
+
+}  // namespace
+
+PacketBuffer::PacketBuffer(const size_t headroom, const size_t capacity) : _head(headroom) {
+    _buffer._storage = Buffer::_allocate(headroom + capacity);
+    _buffer._storage->size = headroom;
+}
+
+void PacketBuffer::_grow(const size_t front, const size_t back) {
+    const size_t old_capacity = _buffer._storage ? _buffer._storage->capacity : 0;
+    Buffer grown;
+    grown._storage = Buffer::_allocate(old_capacity + front + back);
+    grown._storage->size = front + _head + size();
+    if (size() > 0) {
+        memcpy(grown._storage->data + front + _head, _buffer._storage->data + _head, size());
+    }
+    _buffer = move(grown);
+    _head += front;
+}
+
+//! \details If the headroom is exhausted, the packet is moved back far enough to leave the default
+//! headroom in front of the new bytes (so that further layers do not reallocate again).
+uint8_t *PacketBuffer::prepend(const size_t n) {
+    if (n > _head) {
+        _grow(n - _head + DEFAULT_HEADROOM, 0);
+    }
+    _head -= n;
+    return reinterpret_cast<uint8_t *>(_buffer._storage->data + _head);
+}
+
+uint8_t *PacketBuffer::append(const size_t n) {
+    if (n > tailroom()) {
+        _grow(0, n - tailroom());
+    }
+    Buffer::Storage &storage = *_buffer._storage;
+    const size_t old_size = storage.size;
+    storage.size += n;
+    return reinterpret_cast<uint8_t *>(storage.data + old_size);
+}
+
+void PacketBuffer::append(const string_view data) { copy(data.begin(), data.end(), append(data.size())); }
+
+void PacketBuffer::truncate(const size_t n) {
+    if (n > size()) {
+        throw out_of_range("PacketBuffer::truncate");
+    }
+    _buffer._storage->size = _head + n;
+}
+
+array<iovec, 2> PacketBuffer::read_iovecs() {
+    _read_space = tailroom();
+    char *const end = _read_space > 0 ? _buffer._storage->data + _buffer._storage->size : nullptr;
+    return {{{end, _read_space}, {overflow_area(), OVERFLOW_SIZE}}};
+}
+
+void PacketBuffer::commit_read(const size_t n) {
+    if (n > _read_space + OVERFLOW_SIZE) {
+        throw out_of_range("PacketBuffer::commit_read");
+    }
+    const size_t direct = min(n, _read_space);
+    if (direct > 0) {
+        _buffer._storage->size += direct;
+    }
+    if (n > direct) {
+        append(string_view{overflow_area(), n - direct});
+    }
+    _read_space = 0;
+}
+
+Buffer PacketBuffer::release() {
+    if (_buffer._storage) {
+        _buffer._storage->head = _head;
+        _buffer._starting_offset = exchange(_head, 0);
+    }
+    return move(_buffer);
+}
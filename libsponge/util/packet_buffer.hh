@@ -0,0 +1,85 @@
+#ifndef SPONGE_LIBSPONGE_PACKET_BUFFER_HH
+#define SPONGE_LIBSPONGE_PACKET_BUFFER_HH
+
+#include "buffer.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <sys/uio.h>
+
+//! \brief A packet under construction, in one allocation with free space (headroom) in front of it
+//! \details Like a Linux `sk_buff`: the payload is appended once, and then each layer of encapsulation
+//! prepends its header in place, so that a whole frame can be built without allocating a string per
+//! header and written with one contiguous write. release() hands the bytes to a Buffer without copying;
+//! the headroom that is left over goes with them (see Buffer::claim_headroom()). A packet that fits
+//! (headroom included) in Buffer::POOLED_CAPACITY bytes is built in a slot from the PacketPool.
+class PacketBuffer {
+  private:
+    Buffer _buffer{};      //!< the packet's storage, which no other Buffer shares until release()
+    size_t _head{};        //!< offset of the first byte of the packet in the storage
+    size_t _read_space{};  //!< bytes of the storage offered to the last read_iovecs()
+
+    //! \brief Move the packet to new storage with `front` more bytes of headroom and `back` more bytes at the end
+    void _grow(const size_t front, const size_t back);
+
+  public:
+    //! Enough headroom for an Ethernet header and an IPv4 header with options
+    static constexpr size_t DEFAULT_HEADROOM = 96;
+
+    //! \param[in] headroom is the number of bytes to reserve in front of the packet
+    //! \param[in] capacity is the number of bytes the packet itself is expected to need
+    explicit PacketBuffer(const size_t headroom = DEFAULT_HEADROOM, const size_t capacity = 0);
+
+    //! \name A PacketBuffer is the only owner of its storage, so it can be moved but not copied
+    //!@{
+    PacketBuffer(PacketBuffer &&other) = default;
+    PacketBuffer &operator=(PacketBuffer &&other) = default;
+    PacketBuffer(const PacketBuffer &other) = delete;
+    PacketBuffer &operator=(const PacketBuffer &other) = delete;
+    //!@}
+
+    //! \brief Make room for `n` bytes in front of the packet
+    //! \returns a pointer to them (the caller fills them in)
+    //! \note Reallocates (and moves the packet) only if the headroom is exhausted
+    uint8_t *prepend(const size_t n);
+
+    //! \brief Make room for `n` bytes at the end of the packet
+    //! \returns a pointer to them (the caller fills them in)
+    uint8_t *append(const size_t n);
+
+    //! Copy `data` to the end of the packet
+    void append(const std::string_view data);
+
+    //! \brief Discard all but the first `n` bytes of the packet
+    void truncate(const size_t n);
+
+    //! \brief Space to read a packet into with one vectored read (e.g. [readv(2)](\ref man2::readv))
+    //! \details The first iovec is the free space at the end of the packet; the second is a per-thread
+    //! overflow area (64 KiB) for the rest of a packet that does not fit.
+    std::array<iovec, 2> read_iovecs();
+
+    //! \brief Add the first `n` bytes read into the last read_iovecs() to the end of the packet
+    void commit_read(const size_t n);
+
+    //! Size of the packet (not counting the headroom)
+    size_t size() const { return _buffer._storage ? _buffer._storage->size - _head : 0; }
+
+    //! Free space in front of the packet
+    size_t headroom() const { return _head; }
+
+    //! Free space at the end of the packet (filled without reallocating)
+    size_t tailroom() const { return _buffer._storage ? _buffer._storage->capacity - _buffer._storage->size : 0; }
+
+    //! The packet's contents
+    std::string_view str() const {
+        return _buffer._storage ? std::string_view{_buffer._storage->data + _head, size()} : std::string_view{};
+    }
+
+    //! \brief Hand the packet (and its remaining headroom) to a Buffer, without copying
+    //! \note The PacketBuffer is left empty, without headroom
+    Buffer release();
+};
+
+#endif  // SPONGE_LIBSPONGE_PACKET_BUFFER_HH
@@ -0,0 +1,133 @@
+#include "packet_pool.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+using namespace std;
+
+namespace {
+
+//! A free slot holds the link to the next free slot
+struct FreeSlot {
+    FreeSlot *next;
+};
+
+//! A singly linked list of free slots
+struct FreeList {
+    FreeSlot *head = nullptr;
+    size_t count = 0;
+
+    void push(void *slot) {
+        head = new (slot) FreeSlot{head};
+        ++count;
+    }
+
+    void *pop() {
+        FreeSlot *slot = head;
+        head = slot->next;
+        --count;
+        return slot;
+    }
+
+    //! Move up to `n` slots to `other`
+    void move_to(FreeList &other, size_t n) {
+        while (n-- > 0 and head) {
+            other.push(pop());
+        }
+    }
+};
+
+//! A thread keeps at most this many free slots before giving some back
+constexpr size_t LOCAL_LIMIT = 4 * PacketPool::SLOTS_PER_SLAB;
+
+atomic<size_t> slabs_allocated{0};
+
+//! Slots given back by threads; never destroyed, so that it outlives every thread that may use it
+struct SharedList {
+    mutex lock{};
+    FreeList slots{};
+};
+
+SharedList &shared_list() {
+    static SharedList *const shared = new SharedList;
+    return *shared;
+}
+
+//! This thread's free list; trivially destructible, so it remains usable while the thread exits
+thread_local FreeList local_slots{};
+thread_local bool local_exited = false;
+
+//! Gives this thread's free slots back when the thread exits
+struct LocalGuard {
+    bool armed = false;
+
+    ~LocalGuard() {
+        SharedList &shared = shared_list();
+        const lock_guard<mutex> guard(shared.lock);
+        local_slots.move_to(shared.slots, local_slots.count);
+        local_exited = true;
+    }
+};
+
+thread_local LocalGuard local_guard{};
+
+//! Make sure this thread's guard exists (it is constructed on first use) before the thread holds free slots
+void arm_guard() {
+    if (not local_exited) {
+        local_guard.armed = true;
+    }
+}
+
+void refill() {
+    arm_guard();
+
+    {
+        SharedList &shared = shared_list();
+        const lock_guard<mutex> guard(shared.lock);
+        shared.slots.move_to(local_slots, PacketPool::SLOTS_PER_SLAB);
+    }
+    if (local_slots.head) {
+        return;
+    }
+
+    auto *const slab = static_cast<uint8_t *>(
+        ::operator new(PacketPool::SLOT_SIZE * PacketPool::SLOTS_PER_SLAB, align_val_t{64}));
+    ++slabs_allocated;
+    for (size_t i = PacketPool::SLOTS_PER_SLAB; i-- > 0;) {
+        local_slots.push(slab + i * PacketPool::SLOT_SIZE);
+    }
+}
+
+}  // namespace
+
+void *PacketPool::allocate() {
+    if (not local_slots.head) {
+        refill();
+    }
+    return local_slots.pop();
+}
+
+//! \details A thread that frees more slots than it allocates (e.g. the consumer of packets that another
+//! thread receives) gives them back to the shared list a slab's worth at a time.
+void PacketPool::deallocate(void *slot) noexcept {
+    if (local_exited) {
+        SharedList &shared = shared_list();
+        const lock_guard<mutex> guard(shared.lock);
+        shared.slots.push(slot);
+        return;
+    }
+
+    if (not local_slots.head) {
+        arm_guard();
+    }
+    local_slots.push(slot);
+    if (local_slots.count > LOCAL_LIMIT) {
+        SharedList &shared = shared_list();
+        const lock_guard<mutex> guard(shared.lock);
+        local_slots.move_to(shared.slots, SLOTS_PER_SLAB);
+    }
+}
+
+size_t PacketPool::slab_count() { return slabs_allocated; }
@@ -0,0 +1,30 @@
+#ifndef SPONGE_LIBSPONGE_PACKET_POOL_HH
+#define SPONGE_LIBSPONGE_PACKET_POOL_HH
+
+#include <cstddef>
+
+//! \brief Fixed-size memory slots for packets, carved from per-thread slabs
+//! \details Each thread keeps its own free list, so allocate() and deallocate() normally take no lock
+//! and never call the general-purpose allocator. A slot may be freed by a different thread than the
+//! one that allocated it; it then joins the freeing thread's list. A thread whose list grows too long
+//! (or that exits) gives slots back to a shared list, which threads that run out refill from before
+//! they allocate a new slab. Slabs are never returned to the system.
+class PacketPool {
+  public:
+    //! Bytes in each slot: enough for an Ethernet-sized packet, its headroom and its Buffer bookkeeping
+    static constexpr size_t SLOT_SIZE = 2048;
+
+    //! Slots carved from each slab (and moved to or from the shared list at a time)
+    static constexpr size_t SLOTS_PER_SLAB = 64;
+
+    //! \brief Get a slot of SLOT_SIZE bytes (aligned to a cache line)
+    static void *allocate();
+
+    //! \brief Return a slot obtained from allocate()
+    static void deallocate(void *slot) noexcept;
+
+    //! Number of slabs allocated so far, by all threads
+    static size_t slab_count();
+};
+
+#endif  // SPONGE_LIBSPONGE_PACKET_POOL_HH
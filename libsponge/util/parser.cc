@@ -31,10 +31,12 @@ T NetParser::_parse_int() {
         return 0;
     }
 
+    // the size was checked above, so the bytes can be read without further bounds checks
+    const string_view data = _buffer.str();
     T ret = 0;
     for (size_t i = 0; i < len; i++) {
         ret <<= 8;
-        ret += uint8_t(_buffer.at(i));
+        ret += uint8_t(data[i]);
     }
 
     _buffer.remove_prefix(len);
@@ -5,6 +5,8 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <endian.h>
 #include <string>
 #include <utility>
 
@@ -35,10 +37,13 @@ class NetParser {
     T _parse_int();
 
   public:
-    NetParser(Buffer buffer) : _buffer(buffer) {}
+    NetParser(Buffer buffer) : _buffer(std::move(buffer)) {}
 
     Buffer buffer() const { return _buffer; }
 
+    //! Take what is left of the buffer (e.g. a payload), without copying it; leaves the parser empty
+    Buffer take_buffer() { return std::move(_buffer); }
+
     //! Get the current value stored in BaseParser::_error
     ParseResult get_error() const { return _error; }
 
@@ -60,6 +65,35 @@ class NetParser {
 
     //! Remove n bytes from the buffer
     void remove_prefix(const size_t n);
+
+    //! \name Fixed-layout fast path
+    //! A parser that needs a fixed number of bytes can check the length once with peek(), decode the
+    //! fields straight from memory with the unchecked loads below, and then remove_prefix() them,
+    //! falling back to u8()/u16()/u32() (which report errors) when peek() fails.
+    //!@{
+
+    //! \returns a pointer to the next `n` bytes (which are not removed), or `nullptr` if fewer remain
+    const uint8_t *peek(const size_t n) const {
+        if (error() or _buffer.size() < n) {
+            return nullptr;
+        }
+        return reinterpret_cast<const uint8_t *>(_buffer.str().data());
+    }
+
+    //! Load a 32-bit integer in network byte order from (possibly unaligned) memory
+    static uint32_t load_u32(const uint8_t *data) {
+        uint32_t val;
+        std::memcpy(&val, data, sizeof(val));
+        return be32toh(val);
+    }
+
+    //! Load a 16-bit integer in network byte order from (possibly unaligned) memory
+    static uint16_t load_u16(const uint8_t *data) {
+        uint16_t val;
+        std::memcpy(&val, data, sizeof(val));
+        return be16toh(val);
+    }
+    //!@}
 };
 
 struct NetUnparser {
@@ -74,6 +108,22 @@ struct NetUnparser {
 
     //! Write an 8-bit integer into the data stream in network byte order
     static void u8(std::string &s, const uint8_t val);
+
+    //! \name Fixed-layout fast path (the counterpart of NetParser::load_u32() and NetParser::load_u16())
+    //!@{
+
+    //! Store a 32-bit integer in network byte order to (possibly unaligned) memory
+    static void store_u32(uint8_t *data, const uint32_t val) {
+        const uint32_t be = htobe32(val);
+        std::memcpy(data, &be, sizeof(be));
+    }
+
+    //! Store a 16-bit integer in network byte order to (possibly unaligned) memory
+    static void store_u16(uint8_t *data, const uint16_t val) {
+        const uint16_t be = htobe16(val);
+        std::memcpy(data, &be, sizeof(be));
+    }
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_PARSER_HH
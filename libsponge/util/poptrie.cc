@@ -0,0 +1,288 @@
+#include "poptrie.hh"
+
+#include "epoch.hh"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+using namespace std;
+
+static constexpr size_t DIRECT_SIZE = size_t(1) << Poptrie::DIRECT_BITS;
+static constexpr unsigned FANOUT = 1 << Poptrie::STRIDE;
+
+//! A direct-table entry holding a leaf
+static uintptr_t direct_leaf(const uint32_t value) { return (uintptr_t(value) << 1) | 1; }
+
+Poptrie::Poptrie() : _direct(DIRECT_SIZE), _subtrees(DIRECT_SIZE) {
+    for (auto &entry : _direct) {
+        entry.store(direct_leaf(0), memory_order_relaxed);
+    }
+}
+
+uint32_t Poptrie::_find_or_add(const uint32_t prefix, const uint8_t length) {
+    uint32_t node = 0;
+    for (unsigned depth = 0; depth < length; depth++) {
+        const unsigned bit = (prefix >> (31 - depth)) & 1;
+        if (_rib[node].child[bit] == 0) {
+            if (_rib_free.empty()) {
+                _rib[node].child[bit] = _rib.size();
+                _rib.emplace_back();
+            } else {
+                _rib[node].child[bit] = _rib_free.back();
+                _rib_free.pop_back();
+            }
+        }
+        node = _rib[node].child[bit];
+    }
+    return node;
+}
+
+//! \param[in] prefix holds the prefix in its top `length` bits (the rest are ignored)
+//! \param[in] length is the length of the prefix (at most 32)
+//! \param[in] value is what lookup() returns for the addresses this is the longest match for
+optional<uint32_t> Poptrie::insert(const uint32_t prefix, const uint8_t length, const uint32_t value) {
+    if (length > 32) {
+        throw runtime_error("Poptrie::insert: prefix longer than 32 bits");
+    }
+    if (value == UINT32_MAX) {
+        throw runtime_error("Poptrie::insert: value out of range");
+    }
+
+    const lock_guard<mutex> guard(_update_mutex);
+    RibNode &node = _rib[_find_or_add(prefix, length)];
+    const uint32_t old_value = node.value;
+    node.value = value + 1;
+    if (old_value == 0) {
+        _size++;
+    }
+
+    _rebuild_covered(prefix, length);
+    if (old_value == 0) {
+        return {};
+    }
+    return old_value - 1;
+}
+
+optional<uint32_t> Poptrie::remove(const uint32_t prefix, const uint8_t length) {
+    if (length > 32) {
+        throw runtime_error("Poptrie::remove: prefix longer than 32 bits");
+    }
+
+    const lock_guard<mutex> guard(_update_mutex);
+
+    // the path to the prefix's node, to prune the nodes that are left with nothing under them
+    array<uint32_t, 33> path{};
+    for (unsigned depth = 0; depth < length; depth++) {
+        path[depth + 1] = _rib[path[depth]].child[(prefix >> (31 - depth)) & 1];
+        if (path[depth + 1] == 0) {
+            return {};
+        }
+    }
+    const uint32_t old_value = _rib[path[length]].value;
+    if (old_value == 0) {
+        return {};
+    }
+    _rib[path[length]].value = 0;
+    _size--;
+
+    for (unsigned depth = length; depth > 0; depth--) {
+        const RibNode &node = _rib[path[depth]];
+        if (node.value != 0 or node.child[0] != 0 or node.child[1] != 0) {
+            break;
+        }
+        _rib[path[depth - 1]].child[(prefix >> (32 - depth)) & 1] = 0;
+        _rib_free.push_back(path[depth]);
+    }
+
+    _rebuild_covered(prefix, length);
+    return old_value - 1;
+}
+
+optional<uint32_t> Poptrie::find(const uint32_t prefix, const uint8_t length) const {
+    const lock_guard<mutex> guard(_update_mutex);
+    uint32_t node = 0;
+    for (unsigned depth = 0; depth < min<unsigned>(length, 32); depth++) {
+        node = _rib[node].child[(prefix >> (31 - depth)) & 1];
+        if (node == 0) {
+            return {};
+        }
+    }
+    if (_rib[node].value == 0) {
+        return {};
+    }
+    return _rib[node].value - 1;
+}
+
+void Poptrie::_rebuild_covered(const uint32_t prefix, const uint8_t length) {
+    if (length >= DIRECT_BITS) {
+        _rebuild(prefix >> (32 - DIRECT_BITS));
+    } else {
+        const size_t first = length ? (prefix >> (32 - length)) << (DIRECT_BITS - length) : 0;
+        for (size_t index = first; index < first + (size_t(1) << (DIRECT_BITS - length)); index++) {
+            _rebuild(index);
+        }
+    }
+
+    // free the subtrees replaced by earlier changes, if readers are done with them
+    Epoch::reclaim();
+}
+
+void Poptrie::_rebuild(const size_t index) {
+    // walk down to the /16, keeping the value of the longest prefix on the way
+    uint32_t node = 0;
+    uint32_t value = _rib[0].value;
+    for (unsigned depth = 0; depth < DIRECT_BITS; depth++) {
+        node = _rib[node].child[(index >> (DIRECT_BITS - 1 - depth)) & 1];
+        if (node == 0) {
+            break;
+        }
+        if (_rib[node].value != 0) {
+            value = _rib[node].value;
+        }
+    }
+
+    unique_ptr<Subtree> subtree;
+    if (node != 0 and (_rib[node].child[0] or _rib[node].child[1])) {
+        subtree = make_unique<Subtree>();
+        subtree->nodes.push_back({});
+        _build(*subtree, 0, node, value);
+    }
+
+    // publish the new entry, then retire the subtree it replaces once readers cannot be in it
+    const uintptr_t entry = subtree ? reinterpret_cast<uintptr_t>(subtree.get()) : direct_leaf(value);
+    _direct[index].store(entry, memory_order_release);
+    if (_subtrees[index]) {
+        Epoch::retire(_subtrees[index].release());
+    }
+    _subtrees[index] = move(subtree);
+}
+
+//! \details Called for a RIB node `bits` bits above the children of a Poptrie node, this fills in the
+//! `1 << bits` children under it.
+void Poptrie::_expand(
+    uint32_t *child_rib, uint32_t *child_value, const uint32_t rib, const unsigned bits, uint32_t value) {
+    const bool has_children = rib != 0 and (_rib[rib].child[0] or _rib[rib].child[1]);
+    if (rib != 0 and _rib[rib].value != 0) {
+        value = _rib[rib].value;
+    }
+
+    if (bits == 0) {
+        *child_value = value;
+        *child_rib = has_children ? rib : 0;
+    } else if (not has_children) {
+        fill(child_value, child_value + (size_t(1) << bits), value);
+    } else {
+        const size_t half = size_t(1) << (bits - 1);
+        _expand(child_rib, child_value, _rib[rib].child[0], bits - 1, value);
+        _expand(child_rib + half, child_value + half, _rib[rib].child[1], bits - 1, value);
+    }
+}
+
+//! \details The node's children (nodes and leaves) are placed first, each group contiguous, and then
+//! the child nodes are filled in, so that every node's children are next to each other.
+void Poptrie::_build(Subtree &subtree, const size_t node, const uint32_t rib, const uint32_t value) {
+    // for each child: the RIB node (if it has longer prefixes under it) or else the leaf value
+    array<uint32_t, FANOUT> child_rib{};
+    array<uint32_t, FANOUT> child_value{};
+    _expand(child_rib.data(), child_value.data(), rib, STRIDE, value);
+
+    Node out{0, 0, uint32_t(subtree.leaves.size()), uint32_t(subtree.nodes.size())};
+    bool any_leaf = false;
+    for (unsigned child = 0; child < FANOUT; child++) {
+        if (child_rib[child]) {
+            out.vector |= uint64_t(1) << child;
+            subtree.nodes.push_back({});
+        } else if (not any_leaf or subtree.leaves.back() != child_value[child]) {
+            out.leafvec |= uint64_t(1) << child;
+            subtree.leaves.push_back(child_value[child]);
+            any_leaf = true;
+        }
+    }
+    subtree.nodes[node] = out;
+
+    size_t next = out.base1;
+    for (unsigned child = 0; child < FANOUT; child++) {
+        if (child_rib[child]) {
+            _build(subtree, next++, child_rib[child], child_value[child]);
+        }
+    }
+}
+
+//! \details Addresses go in groups of PREFETCH_GROUP. For each group, the direct entries are prefetched, then
+//! the subtrees they point to, then those subtrees' roots, and only then is each address walked down.
+void Poptrie::lookup_batch(const uint32_t *addresses, const size_t count, optional<uint32_t> *values) const {
+    constexpr size_t PREFETCH_GROUP = 16;
+    array<uintptr_t, PREFETCH_GROUP> entries{};
+
+    for (size_t first = 0; first < count; first += PREFETCH_GROUP) {
+        const size_t n = min(count - first, PREFETCH_GROUP);
+        const uint32_t *group = addresses + first;
+
+        for (size_t i = 0; i < n; i++) {
+            __builtin_prefetch(&_direct[group[i] >> (32 - DIRECT_BITS)]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            entries[i] = _direct[group[i] >> (32 - DIRECT_BITS)].load(memory_order_acquire);
+            if (not(entries[i] & 1)) {
+                __builtin_prefetch(reinterpret_cast<const Subtree *>(entries[i]));
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (not(entries[i] & 1)) {
+                __builtin_prefetch(reinterpret_cast<const Subtree *>(entries[i])->nodes.data());
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t value = (entries[i] & 1) ? entries[i] >> 1
+                                                    : _lookup(*reinterpret_cast<const Subtree *>(entries[i]), group[i]);
+            if (value == 0) {
+                values[first + i].reset();
+            } else {
+                values[first + i] = value - 1;
+            }
+        }
+    }
+}
+
+size_t Poptrie::memory_usage() const {
+    const lock_guard<mutex> guard(_update_mutex);
+    size_t ret = _direct.size() * sizeof(_direct[0]);
+    for (const auto &subtree : _subtrees) {
+        if (subtree) {
+            ret += sizeof(Subtree) + subtree->nodes.size() * sizeof(Node) + subtree->leaves.size() * sizeof(uint32_t);
+        }
+    }
+    return ret;
+}
+
+uint32_t Poptrie::_lookup(const Subtree &subtree, const uint32_t address) {
+#if defined(__x86_64__)
+    static const bool has_popcnt = __builtin_cpu_supports("popcnt");
+    if (has_popcnt) {
+        return _walk_popcnt(subtree, address);
+    }
+#endif
+    return _walk(subtree, address);
+}
+
+inline __attribute__((always_inline)) uint32_t Poptrie::_walk(const Subtree &subtree, const uint32_t address) {
+    const uint64_t key = uint64_t(address) << 32;
+    const Node *node = subtree.nodes.data();
+    for (unsigned depth = DIRECT_BITS;; depth += STRIDE) {
+        const uint64_t bit = uint64_t(1) << ((key >> (64 - STRIDE - depth)) & ((1 << STRIDE) - 1));
+        const uint64_t below = (bit << 1) - 1;  // the bits of this child and those before it
+        if (not(node->vector & bit)) {
+            return subtree.leaves[node->base0 + __builtin_popcountll(node->leafvec & below) - 1];
+        }
+        node = subtree.nodes.data() + node->base1 + __builtin_popcountll(node->vector & below) - 1;
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("popcnt"))) uint32_t Poptrie::_walk_popcnt(const Subtree &subtree, const uint32_t address) {
+    return _walk(subtree, address);
+}
+#else
+uint32_t Poptrie::_walk_popcnt(const Subtree &subtree, const uint32_t address) { return _walk(subtree, address); }
+#endif
@@ -0,0 +1,126 @@
+#ifndef SPONGE_LIBSPONGE_POPTRIE_HH
+#define SPONGE_LIBSPONGE_POPTRIE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+//! \brief Longest-prefix match over IPv4 addresses, in a few memory accesses per lookup
+//! \details A Poptrie (Asai and Ohara, SIGCOMM 2015): the top 16 bits of an address index a direct table,
+//! whose entry is either the answer or the root of a multibit trie that consumes 6 bits per level (so a
+//! lookup visits at most three nodes). A node keeps a 64-bit vector of which children are nodes and another
+//! of where runs of equal leaves start; a child is found by counting the bits below it (a popcount), so a
+//! node's children and leaves sit in contiguous arrays with no empty slots.
+//!
+//! The prefixes themselves are kept in a binary trie; when a prefix is inserted or removed, the direct
+//! entries it covers are rebuilt from it. Each /16 has its own subtree, so a long prefix rebuilds only one
+//! subtree. A rebuilt subtree is a copy, swapped into its direct entry atomically; the old one is freed
+//! through Epoch once no reader can be using it. So lookup() never blocks, and may run in any number of
+//! threads (each inside an Epoch::Guard) while other threads change the prefixes.
+class Poptrie {
+  public:
+    static constexpr unsigned DIRECT_BITS = 16;  //!< bits of the address that index the direct table
+    static constexpr unsigned STRIDE = 6;        //!< bits of the address consumed by each node
+
+  private:
+    //! A node of the binary trie that holds the prefixes (index 0 is the root; 0 as a child means none)
+    struct RibNode {
+        uint32_t child[2]{};
+        uint32_t value{};  //!< 1 + the prefix's value, or 0 if no prefix ends here
+    };
+
+    //! A multibit node, with 2^STRIDE children
+    struct Node {
+        uint64_t vector;   //!< bit i is set if child i is a node (otherwise it is a leaf)
+        uint64_t leafvec;  //!< bit i is set if a run of equal leaves starts at child i
+        uint32_t base0;    //!< index (in `leaves`) of the first leaf
+        uint32_t base1;    //!< index (in `nodes`) of the first child node
+    };
+
+    //! The multibit trie under one direct entry (its root is `nodes[0]`)
+    struct Subtree {
+        std::vector<Node> nodes{};
+        std::vector<uint32_t> leaves{};  //!< as in RibNode::value
+    };
+
+    //! Serializes changes (which touch everything below but `_direct`)
+    mutable std::mutex _update_mutex{};
+
+    std::vector<RibNode> _rib{1};
+    std::vector<uint32_t> _rib_free{};  //!< indices of unused RIB nodes
+    std::atomic<size_t> _size{0};
+
+    //! Direct table: a leaf is stored as (value << 1) | 1, and anything else points to a Subtree
+    std::vector<std::atomic<uintptr_t>> _direct;
+    std::vector<std::unique_ptr<Subtree>> _subtrees;
+
+    //! The RIB node for `length` bits of `prefix`, made (with any nodes above it) if it is not there
+    uint32_t _find_or_add(const uint32_t prefix, const uint8_t length);
+
+    //! Recompute the direct entries that a prefix of `length` bits of `prefix` covers
+    void _rebuild_covered(const uint32_t prefix, const uint8_t length);
+
+    //! Recompute direct entry `index` from the RIB
+    void _rebuild(const size_t index);
+
+    //! Find the children under the RIB node `rib` (see _build())
+    void _expand(uint32_t *child_rib, uint32_t *child_value, const uint32_t rib, const unsigned bits, uint32_t value);
+
+    //! Fill in node `node` of `subtree` from the RIB node `rib`, whose longest prefix has value `value`
+    void _build(Subtree &subtree, const size_t node, const uint32_t rib, const uint32_t value);
+
+  public:
+    Poptrie();
+    Poptrie(const Poptrie &other) = delete;
+    Poptrie &operator=(const Poptrie &other) = delete;
+
+    //! \brief Add the prefix made of the top `length` bits of `prefix`, with `value`
+    //! \returns the value the prefix had before, if it was there (it is replaced)
+    std::optional<uint32_t> insert(const uint32_t prefix, const uint8_t length, const uint32_t value);
+
+    //! \brief Remove the prefix made of the top `length` bits of `prefix`
+    //! \returns the value it had, or nothing if it was not there
+    std::optional<uint32_t> remove(const uint32_t prefix, const uint8_t length);
+
+    //! The value of the prefix made of the top `length` bits of `prefix`, if it is there
+    std::optional<uint32_t> find(const uint32_t prefix, const uint8_t length) const;
+
+    //! \brief The value of the longest prefix that matches `address`, if any
+    //! \note If other threads may be changing the prefixes, call this inside an Epoch::Guard
+    std::optional<uint32_t> lookup(const uint32_t address) const {
+        const uintptr_t entry = _direct[address >> (32 - DIRECT_BITS)].load(std::memory_order_acquire);
+        const uint32_t value = (entry & 1) ? entry >> 1 : _lookup(*reinterpret_cast<const Subtree *>(entry), address);
+        if (value == 0) {
+            return {};
+        }
+        return value - 1;
+    }
+
+    //! \brief lookup() of each of `count` addresses, into `values`
+    //! \details Faster than one lookup() after another: the memory each lookup will touch is prefetched for
+    //! several addresses at once, so that their cache misses overlap instead of following one another.
+    //! \note As with lookup(), call this inside an Epoch::Guard if other threads may change the prefixes
+    void lookup_batch(const uint32_t *addresses, const size_t count, std::optional<uint32_t> *values) const;
+
+    //! Number of prefixes
+    size_t size() const { return _size; }
+
+    //! Bytes used by the lookup structure (the direct table and the subtrees, not the RIB)
+    size_t memory_usage() const;
+
+  private:
+    //! Look up `address` in the subtree of its direct entry
+    static uint32_t _lookup(const Subtree &subtree, const uint32_t address);
+
+    //! \name The walk done by _lookup(), compiled for any CPU and for one with the POPCNT instruction
+    //!@{
+    static uint32_t _walk(const Subtree &subtree, const uint32_t address);
+    static uint32_t _walk_popcnt(const Subtree &subtree, const uint32_t address);
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_POPTRIE_HH
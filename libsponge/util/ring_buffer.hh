@@ -0,0 +1,101 @@
+#ifndef SPONGE_LIBSPONGE_RING_BUFFER_HH
+#define SPONGE_LIBSPONGE_RING_BUFFER_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+//! \brief A bounded, lock-free queue for handing objects between threads
+//! \details Any number of threads may push and pop concurrently. Each cell carries a sequence number
+//! that tells producers and consumers whose turn it is, so a push or pop is one compare-and-swap on
+//! the shared tail or head plus uncontended accesses to its own cell (D. Vyukov's bounded MPMC queue).
+//! The queue never blocks and never allocates after construction: try_push() fails when it is full.
+template <typename T>
+class RingBuffer {
+  private:
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        std::optional<T> value{};
+    };
+
+    //! keep the producers' and consumers' counters on separate cache lines
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask;
+
+    alignas(CACHE_LINE) std::atomic<size_t> _tail{0};  //!< next position to push
+    alignas(CACHE_LINE) std::atomic<size_t> _head{0};  //!< next position to pop
+
+  public:
+    //! \param[in] capacity is the maximum number of queued objects; must be a power of two
+    explicit RingBuffer(const size_t capacity) : _cells(new Cell[capacity]), _mask(capacity - 1) {
+        if (capacity < 2 or (capacity & _mask) != 0) {
+            throw std::runtime_error("RingBuffer: capacity must be a power of two (at least 2)");
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    //! \brief Append `value`, unless the queue is full
+    //! \returns `true` if `value` was moved into the queue
+    bool try_push(T &&value) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = _cells[pos & _mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value.emplace(std::move(value));
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //! \brief Remove the oldest object, if any
+    //! \returns the object, or an empty std::optional if the queue is empty
+    std::optional<T> try_pop() {
+        size_t pos = _head.load(std::memory_order_relaxed);
+        while (true) {
+            Cell &cell = _cells[pos & _mask];
+            const size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<T> ret{std::move(cell.value)};
+                    cell.value.reset();
+                    cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+                    return ret;
+                }
+            } else if (diff < 0) {
+                return {};  // empty
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //! Maximum number of queued objects
+    size_t capacity() const { return _mask + 1; }
+
+    //! \brief Approximate number of queued objects (exact only when no other thread is using the queue)
+    size_t size_approx() const {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        const size_t head = _head.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_RING_BUFFER_HH
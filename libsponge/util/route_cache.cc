@@ -0,0 +1,26 @@
+#include "route_cache.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+//! Smallest power of two that is at least `n` (or 0 for 0)
+static size_t round_up_to_power_of_two(const size_t n) {
+    size_t ret = n ? 1 : 0;
+    while (ret < n) {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+RouteCache::RouteCache(const size_t capacity)
+    : _entries(round_up_to_power_of_two(capacity), Entry{0, 0, 0})
+    , _mask(_entries.empty() ? 0 : _entries.size() - 1) {}
+
+void RouteCache::invalidate() {
+    if (++_generation == 0) {
+        // the generations wrapped around, so an old entry might look current: clear them all
+        fill(_entries.begin(), _entries.end(), Entry{0, 0, 0});
+        _generation = 1;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef SPONGE_LIBSPONGE_ROUTE_CACHE_HH
+#define SPONGE_LIBSPONGE_ROUTE_CACHE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+//! \brief A direct-mapped cache of route lookups, by destination address
+//! \details Each destination hashes to one entry, which remembers the last destination looked up there and
+//! its route (or that it had none). Each entry is stamped with the generation it was filled in; changing the
+//! routes calls invalidate(), which starts a new generation, so every entry goes stale at once in O(1).
+//! Counts hits and misses, to size the cache by its hit rate.
+class RouteCache {
+  public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+  private:
+    struct Entry {
+        uint32_t address;
+        uint32_t generation;  //!< 0 for an entry never filled in
+        uint32_t value;       //!< 1 + the route, or 0 for none
+    };
+
+    std::vector<Entry> _entries;
+    size_t _mask;
+    uint32_t _generation{1};
+    uint64_t _hits{0};
+    uint64_t _misses{0};
+
+    //! The entry `address` goes in
+    Entry &_entry(const uint32_t address) {
+        const uint32_t hash = address * 0x9e3779b1u;
+        return _entries[(hash ^ (hash >> 16)) & _mask];
+    }
+
+  public:
+    //! \brief A cache of `capacity` entries (rounded up to a power of two); 0 makes a cache that always misses
+    explicit RouteCache(const size_t capacity = DEFAULT_CAPACITY);
+
+    //! \brief Find `address`'s route in the cache
+    //! \returns `false` on a miss; on a hit, `true`, with the route (or nothing if it has none) in `value`
+    bool lookup(const uint32_t address, std::optional<uint32_t> &value) {
+        if (_entries.empty()) {
+            _misses++;
+            return false;
+        }
+        const Entry &entry = _entry(address);
+        if (entry.generation != _generation or entry.address != address) {
+            _misses++;
+            return false;
+        }
+        _hits++;
+        value.reset();
+        if (entry.value != 0) {
+            value = entry.value - 1;
+        }
+        return true;
+    }
+
+    //! Remember `address`'s route (or that it has none), replacing what its entry held
+    void insert(const uint32_t address, const std::optional<uint32_t> value) {
+        if (not _entries.empty()) {
+            _entry(address) = {address, _generation, value.has_value() ? value.value() + 1 : 0};
+        }
+    }
+
+    //! Forget every cached route (call when the routes change)
+    void invalidate();
+
+    //! Number of entries
+    size_t capacity() const { return _entries.size(); }
+
+    //! \name Lookups that hit and missed since construction or reset_counters()
+    //!@{
+    uint64_t hits() const { return _hits; }
+    uint64_t misses() const { return _misses; }
+    //!@}
+
+    //! Fraction of lookups that hit (0 if there were none)
+    double hit_rate() const { return _hits + _misses ? double(_hits) / double(_hits + _misses) : 0; }
+
+    void reset_counters() { _hits = _misses = 0; }
+};
+
+#endif  // SPONGE_LIBSPONGE_ROUTE_CACHE_HH
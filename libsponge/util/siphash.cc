@@ -0,0 +1,73 @@
+#include "siphash.hh"
+
+#include <cstring>
+#include <random>
+
+using namespace std;
+
+static inline uint64_t rotl(const uint64_t x, const int b) { return (x << b) | (x >> (64 - b)); }
+
+//! \details Reads eight bytes in little-endian order, as the SipHash specification requires
+static inline uint64_t load_le64(const char *p) {
+    uint64_t ret = 0;
+    for (int i = 7; i >= 0; --i) {
+        ret = (ret << 8) | static_cast<uint8_t>(p[i]);
+    }
+    return ret;
+}
+
+SipHash::Key SipHash::random_key() {
+    random_device rd;
+    const auto word = [&] { return (uint64_t(rd()) << 32) | rd(); };
+    return {word(), word()};
+}
+
+uint64_t SipHash::operator()(const string_view input) const {
+    uint64_t v0 = 0x736f6d6570736575ULL ^ _key[0];
+    uint64_t v1 = 0x646f72616e646f6dULL ^ _key[1];
+    uint64_t v2 = 0x6c7967656e657261ULL ^ _key[0];
+    uint64_t v3 = 0x7465646279746573ULL ^ _key[1];
+
+    const auto round = [&] {
+        v0 += v1;
+        v1 = rotl(v1, 13);
+        v1 ^= v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16);
+        v3 ^= v2;
+        v0 += v3;
+        v3 = rotl(v3, 21);
+        v3 ^= v0;
+        v2 += v1;
+        v1 = rotl(v1, 17);
+        v1 ^= v2;
+        v2 = rotl(v2, 32);
+    };
+
+    const auto compress = [&](const uint64_t m) {
+        v3 ^= m;
+        round();
+        round();
+        v0 ^= m;
+    };
+
+    const size_t full_words = input.size() / 8;
+    for (size_t i = 0; i < full_words; ++i) {
+        compress(load_le64(input.data() + 8 * i));
+    }
+
+    // last word: the remaining bytes, with the input length (mod 256) in the top byte
+    uint64_t last = uint64_t(input.size() & 0xff) << 56;
+    for (size_t i = 8 * full_words; i < input.size(); ++i) {
+        last |= uint64_t(static_cast<uint8_t>(input[i])) << (8 * (i - 8 * full_words));
+    }
+    compress(last);
+
+    v2 ^= 0xff;
+    round();
+    round();
+    round();
+    round();
+    return v0 ^ v1 ^ v2 ^ v3;
+}
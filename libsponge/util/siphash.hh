@@ -0,0 +1,30 @@
+#ifndef SPONGE_LIBSPONGE_SIPHASH_HH
+#define SPONGE_LIBSPONGE_SIPHASH_HH
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+//! \brief SipHash-2-4, a keyed hash (pseudo-random function) for short inputs
+//! \details Unlike an ordinary hash function, its output cannot be predicted or forged without the
+//! 128-bit key, which makes it suitable for values that the network must not be able to guess,
+//! such as SYN cookies. See Aumasson and Bernstein, "SipHash: a fast short-input PRF" (2012).
+class SipHash {
+  public:
+    using Key = std::array<uint64_t, 2>;
+
+  private:
+    Key _key;
+
+  public:
+    //! \param[in] key is the secret key
+    explicit SipHash(const Key &key) : _key(key) {}
+
+    //! A key drawn from std::random_device
+    static Key random_key();
+
+    //! Hash `input` under the key
+    uint64_t operator()(const std::string_view input) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_SIPHASH_HH
@@ -0,0 +1,176 @@
+#ifndef SPONGE_LIBSPONGE_SMALL_VECTOR_HH
+#define SPONGE_LIBSPONGE_SMALL_VECTOR_HH
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+//! \brief A sequence that keeps its first `N` elements inside the object, and only allocates beyond that
+//! \details Used where lists are almost always short (e.g. the headers and payload of one packet), so that
+//! building one costs no allocation. Elements can be appended at the back and removed from the front
+//! (like a queue); the space freed at the front is reused when the back runs out of room.
+template <typename T, size_t N>
+class SmallVector {
+  private:
+    alignas(T) unsigned char _inline[N * sizeof(T)];
+    T *_data{reinterpret_cast<T *>(_inline)};
+    size_t _begin{0};  //!< index of the first element in `_data`
+    size_t _end{0};    //!< index one past the last element in `_data`
+    size_t _capacity{N};
+
+    bool _is_inline() const { return _data == reinterpret_cast<const T *>(_inline); }
+
+    //! \brief Move the elements to the front of new heap storage with room for `capacity` (> N) elements
+    void _relocate(const size_t capacity) {
+        T *const data = std::allocator<T>{}.allocate(capacity);
+        const size_t count = size();
+        for (size_t i = 0; i < count; ++i) {
+            new (data + i) T(std::move(_data[_begin + i]));
+            _data[_begin + i].~T();
+        }
+        if (not _is_inline()) {
+            std::allocator<T>{}.deallocate(_data, _capacity);
+        }
+        _data = data;
+        _begin = 0;
+        _end = count;
+        _capacity = capacity;
+    }
+
+    //! \brief Make room for one more element at the back
+    void _make_room() {
+        if (_end < _capacity) {
+            return;
+        }
+        // reuse the space at the front if at least half of it is free; otherwise grow
+        if (_begin > 0 and _begin >= _capacity / 2) {
+            _compact();
+        } else {
+            _relocate(2 * _capacity);
+        }
+    }
+
+    //! \brief Move the elements to the front of the storage they are in
+    void _compact() {
+        const size_t count = size();
+        for (size_t i = 0; i < count; ++i) {
+            new (_data + i) T(std::move(_data[_begin + i]));
+            _data[_begin + i].~T();
+        }
+        _begin = 0;
+        _end = count;
+    }
+
+    //! \brief Take the elements of `other` (which must be empty), leaving it empty
+    void _take(SmallVector &&other) noexcept {
+        if (other._is_inline()) {
+            for (T &value : other) {
+                emplace_back(std::move(value));
+            }
+            other.clear();
+        } else {
+            _data = std::exchange(other._data, reinterpret_cast<T *>(other._inline));
+            _begin = std::exchange(other._begin, 0);
+            _end = std::exchange(other._end, 0);
+            _capacity = std::exchange(other._capacity, N);
+        }
+    }
+
+    //! \brief Destroy the elements and free the storage, leaving an empty vector with inline storage
+    void _reset() noexcept {
+        clear();
+        if (not _is_inline()) {
+            std::allocator<T>{}.deallocate(_data, _capacity);
+            _data = reinterpret_cast<T *>(_inline);
+            _capacity = N;
+        }
+    }
+
+  public:
+    SmallVector() = default;
+
+    SmallVector(const SmallVector &other) {
+        for (const T &value : other) {
+            push_back(value);
+        }
+    }
+
+    SmallVector(SmallVector &&other) noexcept { _take(std::move(other)); }
+
+    SmallVector &operator=(const SmallVector &other) {
+        if (this != &other) {
+            clear();
+            for (const T &value : other) {
+                push_back(value);
+            }
+        }
+        return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other) noexcept {
+        if (this != &other) {
+            _reset();
+            _take(std::move(other));
+        }
+        return *this;
+    }
+
+    ~SmallVector() { _reset(); }
+
+    //! \name Access
+    //!@{
+    size_t size() const { return _end - _begin; }
+    bool empty() const { return _begin == _end; }
+
+    T &operator[](const size_t i) { return _data[_begin + i]; }
+    const T &operator[](const size_t i) const { return _data[_begin + i]; }
+
+    T &front() { return _data[_begin]; }
+    const T &front() const { return _data[_begin]; }
+    T &back() { return _data[_end - 1]; }
+    const T &back() const { return _data[_end - 1]; }
+
+    T *begin() { return _data + _begin; }
+    const T *begin() const { return _data + _begin; }
+    T *end() { return _data + _end; }
+    const T *end() const { return _data + _end; }
+    //!@}
+
+    //! \name Modifiers
+    //!@{
+    template <typename... Args>
+    T &emplace_back(Args &&... args) {
+        if (_end == _capacity) {
+            // the arguments may refer to an element, which making room would move
+            T value(std::forward<Args>(args)...);
+            _make_room();
+            return *new (_data + _end++) T(std::move(value));
+        }
+        return *new (_data + _end++) T(std::forward<Args>(args)...);
+    }
+
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+
+    void pop_front() {
+        if (empty()) {
+            throw std::out_of_range("SmallVector::pop_front");
+        }
+        _data[_begin++].~T();
+        if (_begin == _end) {
+            _begin = _end = 0;
+        }
+    }
+
+    void clear() {
+        for (size_t i = _begin; i < _end; ++i) {
+            _data[i].~T();
+        }
+        _begin = _end = 0;
+    }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_SMALL_VECTOR_HH
@@ -1,10 +1,13 @@
 #include "socket.hh"
 
+#include "packet_buffer.hh"
 #include "util.hh"
 
+#include <array>
 #include <cstddef>
 #include <stdexcept>
 #include <unistd.h>
+#include <vector>
 
 using namespace std;
 
@@ -112,17 +115,47 @@ UDPSocket::received_datagram UDPSocket::recv(const size_t mtu) {
     return ret;
 }
 
+//! \note If the datagram is too big to receive in full, this method throws a std::runtime_error
+UDPSocket::received_packet UDPSocket::recv_packet() {
+    Address::Raw datagram_source_address;
+    PacketBuffer packet{0};
+    auto iovecs = packet.read_iovecs();
+
+    msghdr message{};
+    message.msg_name = static_cast<sockaddr *>(datagram_source_address);
+    message.msg_namelen = sizeof(datagram_source_address);
+    message.msg_iov = iovecs.data();
+    message.msg_iovlen = iovecs.size();
+
+    const ssize_t recv_len = SystemCall("recvmsg", ::recvmsg(fd_num(), &message, MSG_TRUNC));
+    if (message.msg_flags & MSG_TRUNC) {
+        throw runtime_error("recvmsg (oversized datagram)");
+    }
+    packet.commit_read(recv_len);
+
+    register_read();
+    return {{datagram_source_address, message.msg_namelen}, packet.release()};
+}
+
 void sendmsg_helper(const int fd_num,
                     const sockaddr *destination_address,
                     const socklen_t destination_address_len,
                     const BufferViewList &payload) {
-    auto iovecs = payload.as_iovecs();
+    // a datagram has to be sent with one call, so one of more pieces than fit on the stack takes a vector
+    array<iovec, 16> stack_iovecs;
+    vector<iovec> heap_iovecs;
 
     msghdr message{};
     message.msg_name = const_cast<sockaddr *>(destination_address);
     message.msg_namelen = destination_address_len;
-    message.msg_iov = iovecs.data();
-    message.msg_iovlen = iovecs.size();
+    if (payload.count() <= stack_iovecs.size()) {
+        message.msg_iov = stack_iovecs.data();
+        message.msg_iovlen = payload.as_iovecs(stack_iovecs.data(), stack_iovecs.size());
+    } else {
+        heap_iovecs = payload.as_iovecs();
+        message.msg_iov = heap_iovecs.data();
+        message.msg_iovlen = heap_iovecs.size();
+    }
 
     const ssize_t bytes_sent = SystemCall("sendmsg", ::sendmsg(fd_num, &message, 0));
 
@@ -70,6 +70,16 @@ class UDPSocket : public Socket {
     //! Receive a datagram and the Address of its sender (caller can allocate storage)
     void recv(received_datagram &datagram, const size_t mtu = 65536);
 
+    //! Returned by UDPSocket::recv_packet; like received_datagram, but the payload is a Buffer
+    struct received_packet {
+        Address source_address;  //!< Address from which this datagram was received
+        Buffer payload;          //!< UDP datagram payload
+    };
+
+    //! \brief Receive a datagram (of up to 64 KiB) and the Address of its sender
+    //! \details The payload is received into storage from the PacketPool if it fits.
+    received_packet recv_packet();
+
     //! Send a datagram to specified Address
     void sendto(const Address &destination, const BufferViewList &payload);
 
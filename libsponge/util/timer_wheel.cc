@@ -0,0 +1,92 @@
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+
+using namespace std;
+
+TimerWheel::TimerWheel(const uint64_t now_ms, const uint64_t granularity_ms, const size_t num_slots)
+    : _granularity_ms(granularity_ms), _slots(num_slots), _next_tick(now_ms / granularity_ms) {
+    if (granularity_ms == 0 or num_slots == 0) {
+        throw runtime_error("TimerWheel: granularity and number of slots must be positive");
+    }
+}
+
+//! \details A timer goes in the slot of the first tick boundary at or after its deadline; a deadline
+//! whose boundary has already been visited is put in the slot of the next tick, so that it fires on
+//! the next call to advance().
+void TimerWheel::schedule(const TimerId id, const uint64_t deadline_ms) {
+    _slots[_tick_of(deadline_ms) % _slots.size()].push_back({id, deadline_ms});
+    _deadlines[id] = deadline_ms;
+}
+
+uint64_t TimerWheel::_tick_of(const uint64_t deadline_ms) const {
+    return max((deadline_ms + _granularity_ms - 1) / _granularity_ms, _next_tick);
+}
+
+//! \details Visits the slots in the order their ticks come, and stops at the first that holds a timer due
+//! in this turn of the wheel; only if every armed timer is further out than that are all of them visited.
+uint64_t TimerWheel::_first_due_tick() const {
+    for (uint64_t tick = _next_tick; tick < _next_tick + _slots.size(); ++tick) {
+        bool due = false;
+        for (const Timer &timer : _slots[tick % _slots.size()]) {
+            const auto armed = _deadlines.find(timer.id);
+            if (armed != _deadlines.end() and armed->second == timer.deadline and _tick_of(timer.deadline) == tick) {
+                due = true;
+                break;
+            }
+        }
+        if (due) {
+            return tick;
+        }
+    }
+
+    uint64_t first = UINT64_MAX;
+    for (const auto &[id, deadline] : _deadlines) {
+        first = min(first, _tick_of(deadline));
+    }
+    return first;
+}
+
+int TimerWheel::timeout_ms(const uint64_t now_ms) const {
+    if (_deadlines.empty()) {
+        return -1;
+    }
+    const uint64_t fires_at = _first_due_tick() * _granularity_ms;
+    return fires_at > now_ms ? static_cast<int>(min<uint64_t>(fires_at - now_ms, INT_MAX)) : 0;
+}
+
+void TimerWheel::advance(const uint64_t now_ms, const function<void(TimerId)> &expired) {
+    const uint64_t now_tick = now_ms / _granularity_ms;
+    if (now_tick < _next_tick) {
+        return;
+    }
+
+    // after a long pause every slot is due; visit each of them only once
+    const uint64_t ticks_due = min<uint64_t>(now_tick - _next_tick + 1, _slots.size());
+
+    vector<TimerId> fired;
+    for (uint64_t i = 0; i < ticks_due; ++i) {
+        auto &slot = _slots[(_next_tick + i) % _slots.size()];
+        auto keep = slot.begin();
+        for (const Timer &timer : slot) {
+            const auto armed = _deadlines.find(timer.id);
+            if (armed == _deadlines.end() or armed->second != timer.deadline) {
+                continue;  // cancelled or re-armed since
+            }
+            if (timer.deadline <= now_ms) {
+                _deadlines.erase(armed);
+                fired.push_back(timer.id);
+            } else {
+                *keep++ = timer;  // due in a later turn of the wheel
+            }
+        }
+        slot.erase(keep, slot.end());
+    }
+    _next_tick = now_tick + 1;
+
+    for (const TimerId id : fired) {
+        expired(id);
+    }
+}
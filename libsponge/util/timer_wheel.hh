@@ -0,0 +1,68 @@
+#ifndef SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+//! \brief A hashed timing wheel: many one-shot timers, O(1) to arm or cancel
+//! \details Time is divided into ticks of `granularity_ms` milliseconds; a timer is kept in the slot of
+//! the tick in which it expires (modulo the number of slots), so advancing the wheel only visits the
+//! slots of the ticks that have passed. Timers are identified by a caller-chosen TimerId; arming an id
+//! that is already armed moves its deadline, and cancelled or moved timers are discarded lazily.
+class TimerWheel {
+  public:
+    using TimerId = uint64_t;
+
+  private:
+    struct Timer {
+        TimerId id;
+        uint64_t deadline;
+    };
+
+    uint64_t _granularity_ms;
+    std::vector<std::vector<Timer>> _slots;
+
+    //! deadline of every armed timer; a Timer in a slot is stale unless it matches
+    std::unordered_map<TimerId, uint64_t> _deadlines{};
+
+    //! the next tick whose slot has not been visited yet
+    uint64_t _next_tick;
+
+    //! the tick in whose slot a timer with this deadline goes (and on which it fires)
+    uint64_t _tick_of(const uint64_t deadline_ms) const;
+
+    //! the tick on which the earliest armed timer fires (there must be one)
+    uint64_t _first_due_tick() const;
+
+  public:
+    //! \param[in] now_ms is the current time, in milliseconds
+    //! \param[in] granularity_ms is the length of one tick; timers fire up to one tick late, never early
+    //! \param[in] num_slots is the number of slots (timers further out than a full turn are revisited)
+    explicit TimerWheel(const uint64_t now_ms, const uint64_t granularity_ms = 10, const size_t num_slots = 256);
+
+    //! Arm (or re-arm) timer `id` to expire at `deadline_ms`
+    void schedule(const TimerId id, const uint64_t deadline_ms);
+
+    //! Disarm timer `id`, if it is armed
+    void cancel(const TimerId id) { _deadlines.erase(id); }
+
+    //! Is timer `id` armed?
+    bool scheduled(const TimerId id) const { return _deadlines.count(id); }
+
+    //! Number of armed timers
+    size_t size() const { return _deadlines.size(); }
+
+    //! \brief How long a caller may sleep before it needs to call advance()
+    //! \returns -1 (forever) if no timer is armed, or else the time until the earliest timer fires (its
+    //! deadline, rounded up to a tick), in milliseconds
+    int timeout_ms(const uint64_t now_ms) const;
+
+    //! \brief Disarm every timer whose deadline is at or before `now_ms`, then call `expired` with each
+    //! \note `expired` may arm timers again, including the one it was called for
+    void advance(const uint64_t now_ms, const std::function<void(TimerId)> &expired);
+};
+
+#endif  // SPONGE_LIBSPONGE_TIMER_WHEEL_HH
@@ -0,0 +1,46 @@
+#include "toeplitz.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+const array<uint8_t, ToeplitzHash::KEY_LENGTH> ToeplitzHash::DEFAULT_KEY = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3,
+    0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3,
+    0x80, 0x30, 0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa};
+
+ToeplitzHash::ToeplitzHash(const array<uint8_t, KEY_LENGTH> &key) : _table(KEY_LENGTH - 4) {
+    // the 32-bit window of the key starting at bit `bit`
+    const auto window = [&](const size_t bit) {
+        uint64_t bits = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            const size_t byte = bit / 8 + i;
+            bits = (bits << 8) | (byte < KEY_LENGTH ? key[byte] : 0);
+        }
+        return static_cast<uint32_t>(bits >> (32 - bit % 8));
+    };
+
+    for (size_t position = 0; position < _table.size(); ++position) {
+        for (unsigned value = 0; value < 256; ++value) {
+            uint32_t result = 0;
+            for (unsigned bit = 0; bit < 8; ++bit) {
+                if (value & (0x80 >> bit)) {
+                    result ^= window(position * 8 + bit);
+                }
+            }
+            _table[position][value] = result;
+        }
+    }
+}
+
+uint32_t ToeplitzHash::operator()(const string_view input) const {
+    if (input.size() > _table.size()) {
+        throw runtime_error("ToeplitzHash: input longer than the key allows");
+    }
+
+    uint32_t result = 0;
+    for (size_t i = 0; i < input.size(); ++i) {
+        result ^= _table[i][static_cast<uint8_t>(input[i])];
+    }
+    return result;
+}
@@ -0,0 +1,39 @@
+#ifndef SPONGE_LIBSPONGE_TOEPLITZ_HH
+#define SPONGE_LIBSPONGE_TOEPLITZ_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//! \brief The Toeplitz hash used by NICs for receive-side scaling (RSS)
+//! \details Each set bit of the input (most significant bit first) XORs in the 32-bit window of the
+//! secret key that starts at that bit position. The windows are precomputed for every byte value at
+//! every input position, so hashing costs one table lookup per input byte.
+//!
+//! With the same key and input layout as a NIC (for TCP over IPv4: source address, destination
+//! address, source port, destination port, all in network byte order), the result matches the hash
+//! the NIC would compute for the packet.
+class ToeplitzHash {
+  public:
+    //! Length of the RSS key used by most NICs
+    static constexpr size_t KEY_LENGTH = 40;
+
+    //! The default key from Microsoft's RSS specification
+    static const std::array<uint8_t, KEY_LENGTH> DEFAULT_KEY;
+
+  private:
+    //! _table[i][b] is the hash contribution of byte value `b` at input position `i`
+    std::vector<std::array<uint32_t, 256>> _table;
+
+  public:
+    //! \param[in] key is the secret key; inputs may be up to KEY_LENGTH - 4 bytes long
+    explicit ToeplitzHash(const std::array<uint8_t, KEY_LENGTH> &key = DEFAULT_KEY);
+
+    //! \brief Hash `input`
+    //! \throws std::runtime_error if `input` is longer than KEY_LENGTH - 4 bytes
+    uint32_t operator()(const std::string_view input) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_TOEPLITZ_HH
@@ -84,21 +84,56 @@ mt19937 get_random_generator() {
 //!
 //! For more information, see the [Wikipedia page](https://en.wikipedia.org/wiki/IPv4_header_checksum)
 //! on the Internet checksum, and consult the [IP](\ref rfc::rfc791) and [TCP](\ref rfc::rfc793) RFCs.
-InternetChecksum::InternetChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
+InternetChecksum::InternetChecksum(const uint32_t initial_sum, const ChecksumKernel kernel)
+    : _sum(initial_sum), _kernel(kernel) {}
 
+//! \details A byte left over from the previous call completes a word as its low byte; the even-length
+//! run that follows goes to the kernel, whose host-order sum is folded and (on little-endian hosts)
+//! byte-swapped into network order; a trailing odd byte starts a new word as its high byte.
 void InternetChecksum::add(std::string_view data) {
-    for (size_t i = 0; i < data.size(); i++) {
-        uint16_t val = uint8_t(data[i]);
-        if (not _parity) {
-            val <<= 8;
+    const auto *bytes = reinterpret_cast<const uint8_t *>(data.data());
+    size_t len = data.size();
+    if (len == 0) {
+        return;
+    }
+
+    if (_parity) {
+        _sum += *bytes;
+        ++bytes;
+        --len;
+        _parity = false;
+    }
+
+    const size_t even_len = len & ~size_t(1);
+    if (even_len > 0) {
+        uint64_t sum = _kernel(bytes, even_len);
+        while (sum > 0xffff) {
+            sum = (sum >> 16) + (sum & 0xffff);
         }
-        _sum += val;
-        _parity = !_parity;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        sum = ((sum & 0xff) << 8) | (sum >> 8);
+#endif
+        _sum += sum;
+    }
+
+    if (len & 1) {
+        _sum += uint16_t(bytes[even_len]) << 8;
+        _parity = true;
+    }
+}
+
+//! \param[in] sum is the folded (not complemented) sum of the data, as if it started at an even offset
+//! \param[in] length is the length of the data
+//! \details Data that starts at an odd offset contributes the byte-swapped sum.
+void InternetChecksum::add_partial_sum(const uint16_t sum, const size_t length) {
+    _sum += _parity ? uint16_t((sum << 8) | (sum >> 8)) : sum;
+    if (length & 1) {
+        _parity = not _parity;
     }
 }
 
 uint16_t InternetChecksum::value() const {
-    uint32_t ret = _sum;
+    uint64_t ret = _sum;
 
     while (ret > 0xffff) {
         ret = (ret >> 16) + (ret & 0xffff);
@@ -107,6 +142,23 @@ uint16_t InternetChecksum::value() const {
     return ~ret;
 }
 
+//! \param[in] cksum is a checksum (as stored in a header) that covers `old_word`
+//! \param[in] old_word is the 16-bit word's value before the change
+//! \param[in] new_word is its value after the change
+//! \returns the checksum covering `new_word` instead, computed as HC' = ~(~HC + ~m + m') (RFC 1624, eqn. 3)
+uint16_t InternetChecksum::update(const uint16_t cksum, const uint16_t old_word, const uint16_t new_word) {
+    uint32_t sum = uint16_t(~cksum) + uint16_t(~old_word) + uint32_t(new_word);
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return ~sum;
+}
+
+//! \details Same as update(), for a 32-bit field (e.g. an address) at an even offset.
+uint16_t InternetChecksum::update32(const uint16_t cksum, const uint32_t old_value, const uint32_t new_value) {
+    return update(update(cksum, old_value >> 16, new_value >> 16), old_value & 0xffff, new_value & 0xffff);
+}
+
 //! \param[in] data is a pointer to the bytes to show
 //! \param[in] len is the number of bytes to show
 //! \param[in] indent is the number of spaces to indent
@@ -1,6 +1,8 @@
 #ifndef SPONGE_LIBSPONGE_UTIL_HH
 #define SPONGE_LIBSPONGE_UTIL_HH
 
+#include "checksum_kernels.hh"
+
 #include <algorithm>
 #include <cerrno>
 #include <cstddef>
@@ -51,16 +53,29 @@ std::mt19937 get_random_generator();
 //! Get the time in milliseconds since the program began.
 uint64_t timestamp_ms();
 
-//! The internet checksum algorithm
+//! \brief The internet checksum algorithm
+//! \details Bytes are summed many at a time by a ChecksumKernel (by default the fastest one the CPU
+//! supports); the result is the same however the data is split across calls to add().
 class InternetChecksum {
   private:
-    uint32_t _sum;
-    bool _parity{};
+    uint64_t _sum;
+    bool _parity{};  //!< has an odd number of bytes been added (so the next byte is a low byte)?
+    ChecksumKernel _kernel;
 
   public:
-    InternetChecksum(const uint32_t initial_sum = 0);
+    InternetChecksum(const uint32_t initial_sum = 0, const ChecksumKernel kernel = best_checksum_kernel());
     void add(std::string_view data);
+
+    //! Add data whose one's-complement sum is already known (e.g. from Buffer::partial_checksum())
+    void add_partial_sum(const uint16_t sum, const size_t length);
+
     uint16_t value() const;
+
+    //! \name Incremental update (RFC 1624) of a checksum after a field changes
+    //!@{
+    static uint16_t update(const uint16_t cksum, const uint16_t old_word, const uint16_t new_word);
+    static uint16_t update32(const uint16_t cksum, const uint32_t old_value, const uint32_t new_value);
+    //!@}
 };
 
 //! Hexdump the contents of a packet (or any other sequence of bytes)
@@ -0,0 +1,184 @@
+#include "arp_table.hh"
+#include "network_interface.hh"
+#include "network_interface_test_helpers.hh"
+#include "test_err_if.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+const EthernetAddress local_eth{0x02, 0, 0, 0, 0, 0x01};
+
+static EthernetAddress neighbor_eth(const uint32_t ip) {
+    return {0x02, 0, uint8_t(ip >> 24), uint8_t(ip >> 16), uint8_t(ip >> 8), uint8_t(ip)};
+}
+
+//! Have `interface` learn the Ethernet address of `neighbor_ip` (see neighbor_eth())
+static void learn_neighbor(NetworkInterface &interface, const uint32_t neighbor_ip) {
+    learn_neighbor(
+        interface, local_eth, "10.0.0.1", neighbor_eth(neighbor_ip), Address::from_ipv4_numeric(neighbor_ip).ip());
+}
+
+int main() {
+    try {
+        // test 1: the table agrees with a map through random inserts and erases, growing as it goes
+        {
+            ArpTable table;
+            map<uint32_t, uint64_t> reference;
+            mt19937 rd(1234);
+            // a small key space, so that keys collide, repeat and are erased in the middle of runs
+            uniform_int_distribution<uint32_t> key(0, 50000);
+            for (unsigned i = 0; i < 400000; i++) {
+                const uint32_t ip = key(rd);
+                switch (rd() % 3) {
+                    case 0:
+                        table.insert(ip).deadline = i;
+                        reference[ip] = i;
+                        break;
+                    case 1:
+                        table.erase(ip);
+                        reference.erase(ip);
+                        break;
+                    default: {
+                        const ArpTable::Entry *entry = table.find(ip);
+                        const auto expected = reference.find(ip);
+                        test_err_if((entry != nullptr) != (expected != reference.end()),
+                                    "test 1 failed: entry found or not found wrongly");
+                        test_err_if(entry and (entry->ip_address != ip or entry->deadline != expected->second),
+                                    "test 1 failed: wrong entry found");
+                    }
+                }
+                test_err_if(table.size() != reference.size(), "test 1 failed: wrong size");
+            }
+            for (const auto &[ip, deadline] : reference) {
+                const ArpTable::Entry *entry = table.find(ip);
+                test_err_if(not entry or entry->deadline != deadline, "test 1 failed: entry lost");
+            }
+        }
+
+        // test 2: a new entry is INCOMPLETE, and inserting an existing address finds its entry
+        {
+            ArpTable table;
+            ArpTable::Entry &entry = table.insert(7);
+            test_err_if(entry.state != ArpTable::State::INCOMPLETE or entry.deadline != 0 or not entry.pending.empty(),
+                        "test 2 failed: new entry not INCOMPLETE");
+            entry.state = ArpTable::State::REACHABLE;
+            test_err_if(table.insert(7).state != ArpTable::State::REACHABLE or table.size() != 1,
+                        "test 2 failed: entry inserted twice");
+        }
+
+        // test 3: tens of thousands of neighbors are learned, used, and all expire after 30 s
+        {
+            NetworkInterface interface(local_eth, Address("10.0.0.1", 0));
+            constexpr uint32_t num_neighbors = 20000;
+            const uint32_t first = Address("10.1.0.0", 0).ipv4_numeric();
+            for (uint32_t ip = first; ip < first + num_neighbors; ip++) {
+                learn_neighbor(interface, ip);
+            }
+            interface.tick(29999);
+
+            vector<NetworkInterface::OutboundDatagram> batch;
+            for (uint32_t ip = first; ip < first + num_neighbors; ip++) {
+                batch.emplace_back(make_datagram(), ip);
+            }
+            interface.send_datagrams(batch);
+            test_err_if(interface.frames_out().size() != num_neighbors, "test 3 failed: wrong number of frames");
+            for (uint32_t ip = first; not interface.frames_out().empty(); ip++) {
+                const EthernetHeader &header = interface.frames_out().front().header();
+                test_err_if(header.type != EthernetHeader::TYPE_IPv4 or header.dst != neighbor_eth(ip),
+                            "test 3 failed: datagram sent to the wrong address");
+                interface.frames_out().pop();
+            }
+
+            // now every mapping has expired, so each datagram needs an ARP request
+            interface.tick(1);
+            for (uint32_t ip = first; ip < first + num_neighbors; ip++) {
+                batch.emplace_back(make_datagram(), ip);
+            }
+            interface.send_datagrams(batch);
+            test_err_if(interface.frames_out().size() != num_neighbors, "test 3 failed: wrong number of requests");
+            for (; not interface.frames_out().empty(); interface.frames_out().pop()) {
+                test_err_if(interface.frames_out().front().header().type != EthernetHeader::TYPE_ARP,
+                            "test 3 failed: datagram sent with an expired mapping");
+            }
+
+            // and the replies deliver what was waiting
+            for (uint32_t ip = first; ip < first + num_neighbors; ip += 1000) {
+                learn_neighbor(interface, ip);
+            }
+            test_err_if(interface.frames_out().size() != num_neighbors / 1000,
+                        "test 3 failed: waiting datagrams not sent");
+        }
+
+        // test 4: a burst to a dead next hop waits in bounded memory, with requests repeated at growing intervals
+        {
+            NetworkInterface interface(local_eth, Address("10.0.0.1", 0));
+            const Address dead("10.9.9.9", 0);
+            const auto expect_requests = [&](const size_t n, const string &when) {
+                test_err_if(interface.frames_out().size() != n, "test 4 failed: wrong number of requests " + when);
+                for (; not interface.frames_out().empty(); interface.frames_out().pop()) {
+                    test_err_if(interface.frames_out().front().header().type != EthernetHeader::TYPE_ARP,
+                                "test 4 failed: datagram sent " + when);
+                }
+            };
+
+            for (unsigned i = 0; i < 10000; i++) {
+                interface.send_datagram(make_datagram(), dead);
+            }
+            expect_requests(1, "for the burst");
+            test_err_if(interface.drops().pending_full != 10000 - EgressConfig::PENDING_PER_NEIGHBOR_DFLT,
+                        "test 4 failed: burst not bounded");
+
+            // other next hops still have room
+            interface.send_datagram(make_datagram(), Address("10.9.9.10", 0));
+            expect_requests(1, "for another next hop");
+            test_err_if(interface.drops().pending_full != 10000 - EgressConfig::PENDING_PER_NEIGHBOR_DFLT,
+                        "test 4 failed: another next hop's datagram dropped");
+            learn_neighbor(interface, Address("10.9.9.10", 0).ipv4_numeric());
+            test_err_if(interface.frames_out().size() != 1, "test 4 failed: waiting datagram not sent");
+            interface.frames_out().pop();
+
+            interface.tick(4999);
+            expect_requests(0, "too soon");
+            interface.tick(1);
+            expect_requests(1, "after 5 s");
+            interface.tick(9999);
+            expect_requests(0, "too soon after the second");
+            interface.tick(1);
+            expect_requests(1, "after 10 s more");
+
+            // after the last request has waited 20 s, the datagrams are dropped, with no more requests
+            interface.tick(19999);
+            test_err_if(interface.drops().unresolved != 0, "test 4 failed: gave up too soon");
+            interface.tick(1);
+            expect_requests(0, "after giving up");
+            test_err_if(interface.drops().unresolved != EgressConfig::PENDING_PER_NEIGHBOR_DFLT,
+                        "test 4 failed: waiting datagrams not dropped");
+            interface.tick(100000);
+            expect_requests(0, "long after giving up");
+
+            // datagrams sent while a request is out wait for the reply, and then all go out at once
+            interface.send_datagram(make_datagram(), dead);
+            expect_requests(1, "when trying again");
+            for (unsigned i = 0; i < 3; i++) {
+                interface.tick(1000);
+                interface.send_datagram(make_datagram(), dead);
+            }
+            expect_requests(0, "while a request is out");
+            learn_neighbor(interface, dead.ipv4_numeric());
+            test_err_if(interface.frames_out().size() != 4, "test 4 failed: waiting datagrams not all sent");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
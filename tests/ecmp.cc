@@ -0,0 +1,186 @@
+#include "network_interface_test_helpers.hh"
+#include "router.hh"
+#include "test_err_if.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+const EthernetAddress in_eth{0x02, 0, 0, 0, 0, 0x01};
+
+//! Make a frame to `in_eth`, carrying a TCP (or other `proto`) datagram from `src_port` to port 80 of 192.168.1.1
+static EthernetFrame make_frame(const uint16_t src_port, const uint8_t proto = IPv4Header::PROTO_TCP) {
+    InternetDatagram dgram;
+    dgram.header().src = Address("10.0.0.2", 0).ipv4_numeric();
+    dgram.header().dst = Address("192.168.1.1", 0).ipv4_numeric();
+    dgram.header().proto = proto;
+    dgram.payload() = string{char(src_port >> 8), char(src_port & 0xff), 0, 80} + string(16, 0);
+    dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+
+    EthernetFrame frame;
+    frame.header().dst = in_eth;
+    frame.header().src = {0x02, 0, 0, 0, 0, 0x09};
+    frame.header().type = EthernetHeader::TYPE_IPv4;
+    frame.payload() = dgram.serialize().concatenate();
+    return frame;
+}
+
+int main() {
+    try {
+        Router router;
+        const size_t in = router.add_interface(AsyncNetworkInterface(in_eth, Address("10.0.0.1", 0)));
+        vector<size_t> uplinks;
+        for (uint8_t i = 1; i <= 3; i++) {
+            const EthernetAddress uplink_eth{0x02, 0, 0, 0, 1, i};
+            const string subnet = "10.0." + to_string(i) + ".";
+            uplinks.push_back(router.add_interface(AsyncNetworkInterface(uplink_eth, Address(subnet + "1", 0))));
+
+            // the next hop is known, so a forwarded datagram leaves at once
+            router.interface(uplinks.back())
+                .recv_frame(make_arp_reply({0x02, 0, 0, 0, 2, i}, subnet + "2", uplink_eth, subnet + "1"));
+        }
+
+        // send a datagram through the router, and return the interface it left from
+        const auto forward = [&](const EthernetFrame &frame) -> optional<size_t> {
+            router.interface(in).recv_frame(frame);
+            router.route();
+            optional<size_t> ret;
+            for (const size_t out : uplinks) {
+                auto &frames = router.interface(out).frames_out();
+                if (not frames.empty()) {
+                    ret = out;
+                }
+                frames = {};
+            }
+            return ret;
+        };
+
+        // test 1: a single path takes every flow
+        router.add_route(Address("192.168.0.0", 0).ipv4_numeric(), 16, Address("10.0.1.2", 0), uplinks[0]);
+        for (uint16_t port = 1000; port < 1020; port++) {
+            test_err_if(forward(make_frame(port)) != uplinks[0], "test 1 failed: single path not taken");
+        }
+
+        // test 2: flows are spread over all the paths, and each flow keeps to one
+        vector<Router::NextHop> paths;
+        for (size_t i = 0; i < uplinks.size(); i++) {
+            paths.push_back({Address("10.0." + to_string(i + 1) + ".2", 0), uplinks[i]});
+        }
+        router.replace_route(Address("192.168.0.0", 0).ipv4_numeric(), 16, paths);
+
+        map<uint16_t, size_t> path_of_flow;
+        set<size_t> used;
+        for (uint16_t port = 1000; port < 1100; port++) {
+            const auto out = forward(make_frame(port));
+            test_err_if(not out.has_value(), "test 2 failed: not routed");
+            path_of_flow[port] = out.value();
+            used.insert(out.value());
+        }
+        test_err_if(used.size() != uplinks.size(), "test 2 failed: flows not spread over every path");
+        for (uint16_t port = 1000; port < 1100; port++) {
+            test_err_if(forward(make_frame(port)) != path_of_flow[port], "test 2 failed: a flow changed path");
+        }
+
+        // test 3: without ports (not TCP or UDP), a flow is its addresses, so the payload does not matter
+        const auto icmp_path = forward(make_frame(1000, 1));
+        for (uint16_t port = 1001; port < 1020; port++) {
+            test_err_if(forward(make_frame(port, 1)) != icmp_path, "test 3 failed: a non-TCP flow changed path");
+        }
+
+        // test 4: a route needs a path
+        bool threw = false;
+        try {
+            router.add_route(Address("192.168.0.0", 0).ipv4_numeric(), 16, vector<Router::NextHop>{});
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        test_err_if(not threw, "test 4 failed: route with no path added");
+
+        // test 5: with workers, routes change while datagrams are routed, and every datagram still has a route
+        router.start_workers();
+        {
+            atomic<bool> done{false};
+            thread changer([&] {
+                const uint32_t subnet = Address("192.168.1.0", 0).ipv4_numeric();
+                for (unsigned i = 0; i < 2000; i++) {
+                    if (i % 2) {
+                        router.replace_route(Address("192.168.0.0", 0).ipv4_numeric(), 16, paths);
+                    } else {
+                        router.replace_route(
+                            Address("192.168.0.0", 0).ipv4_numeric(), 16, Address("10.0.1.2", 0), uplinks[0]);
+                    }
+                    if (i % 100 == 0) {
+                        router.add_route(subnet, 24, Address("10.0.3.2", 0), uplinks[2]);
+                    } else if (i % 100 == 50) {
+                        router.remove_route(subnet, 24);
+                    }
+                }
+                done = true;
+            });
+
+            size_t sent = 0, forwarded = 0;
+            for (uint16_t port = 0; not done; port += 8) {
+                for (uint16_t i = 0; i < 8; i++) {
+                    router.interface(in).recv_frame(make_frame(port + i));
+                }
+                sent += 8;
+                router.route();
+                for (const size_t out : uplinks) {
+                    forwarded += router.interface(out).frames_out().size();
+                    router.interface(out).frames_out() = {};
+                }
+            }
+            changer.join();
+            // what the changes replaced was freed as they went (a reader may be holding the latest of it)
+            test_err_if(Epoch::pending() > 8, "test 5 failed: replaced routes not reclaimed");
+            test_err_if(forwarded != sent, "test 5 failed: datagrams lost while the routes changed");
+        }
+
+        InternetDatagram bad = make_datagram("10.0.0.2", "192.168.1.1", "wrong length");
+        bad.header().len = bad.header().hlen * 4;  // so serializing it throws
+
+        // test 6: a worker that fails drops what it was sending, but the round still ends and the next one works
+        {
+            router.interface(in).datagrams_out().push(bad);
+            router.route();
+            for (const size_t out : uplinks) {
+                router.interface(out).frames_out() = {};
+            }
+
+            test_err_if(not forward(make_frame(1000)).has_value(), "test 6 failed: not routed after a failure");
+        }
+        router.stop_workers();
+
+        // test 7: without workers, the failure reaches the caller, and what was routed with it is not sent later
+        {
+            router.replace_route(Address("192.168.0.0", 0).ipv4_numeric(), 16, Address("10.0.1.2", 0), uplinks[0]);
+            router.interface(in).datagrams_out().push(bad);
+            router.interface(in).recv_frame(make_frame(1000));
+            threw = false;
+            try {
+                router.route();
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_err_if(not threw, "test 7 failed: failure not reported");
+            router.interface(uplinks[0]).frames_out() = {};
+
+            router.interface(in).recv_frame(make_frame(1001));
+            router.route();
+            test_err_if(router.interface(uplinks[0]).frames_out().size() != 1, "test 7 failed: stale datagram sent");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+#include "network_interface.hh"
+#include "network_interface_test_helpers.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+const EthernetAddress local_eth{0x02, 0, 0, 0, 0, 0x01};
+const EthernetAddress neighbor_eth{0x02, 0, 0, 0, 0, 0x02};
+
+int main() {
+    try {
+        const Address neighbor("10.0.0.2", 0);
+
+        // test 1: by default, nothing is dropped
+        {
+            NetworkInterface interface(local_eth, Address("10.0.0.1", 0));
+            learn_neighbor(interface, local_eth, "10.0.0.1", neighbor_eth, "10.0.0.2");
+            interface.frames_out() = {};
+            for (unsigned i = 0; i < 10000; i++) {
+                interface.send_datagram(make_datagram(), neighbor);
+            }
+            interface.tick(10000);
+            test_err_if(interface.frames_out().size() != 10000, "test 1 failed: frames dropped with no limit");
+            test_err_if(interface.drops().queue_full + interface.drops().codel != 0, "test 1 failed: drops counted");
+        }
+
+        // test 2: frames beyond the limit are dropped and counted, until the owner takes some
+        {
+            EgressConfig config;
+            config.max_frames = 10;
+            NetworkInterface interface(local_eth, Address("10.0.0.1", 0), config);
+            learn_neighbor(interface, local_eth, "10.0.0.1", neighbor_eth, "10.0.0.2");
+            interface.frames_out() = {};
+            for (unsigned i = 0; i < 25; i++) {
+                interface.send_datagram(make_datagram(), neighbor);
+            }
+            test_err_if(interface.frames_out().size() != 10 or interface.drops().queue_full != 15,
+                        "test 2 failed: limit not enforced");
+            for (unsigned i = 0; i < 4; i++) {
+                interface.frames_out().pop();
+            }
+            for (unsigned i = 0; i < 5; i++) {
+                interface.send_datagram(make_datagram(), neighbor);
+            }
+            test_err_if(interface.frames_out().size() != 10 or interface.drops().queue_full != 16,
+                        "test 2 failed: room made by the owner not used");
+        }
+
+        // test 3: CoDel drains a standing queue (which a queue without it keeps forever), then stops dropping
+        {
+            EgressConfig config;
+            config.codel = true;
+            NetworkInterface interface(local_eth, Address("10.0.0.1", 0), config);
+            learn_neighbor(interface, local_eth, "10.0.0.1", neighbor_eth, "10.0.0.2");
+            interface.frames_out() = {};
+
+            for (unsigned i = 0; i < 200; i++) {
+                interface.send_datagram(make_datagram(), neighbor);
+            }
+            // then a frame arrives and a frame leaves each ms, so the queue length is the delay in ms
+            for (unsigned ms = 0; ms < 10000; ms++) {
+                interface.send_datagram(make_datagram(), neighbor);
+                interface.frames_out().pop();
+                interface.tick(1);
+            }
+            test_err_if(interface.frames_out().size() > EgressConfig::CODEL_TARGET_DFLT + 1,
+                        "test 3 failed: standing queue not drained");
+            test_err_if(interface.drops().codel < 190 or interface.drops().codel > 200,
+                        "test 3 failed: wrong number of drops");
+            test_err_if(interface.drops().queue_full != 0, "test 3 failed: tail drops without a limit");
+
+            const uint64_t drops = interface.drops().codel;
+            for (unsigned ms = 0; ms < 1000; ms++) {
+                interface.send_datagram(make_datagram(), neighbor);
+                interface.frames_out().pop();
+                interface.tick(1);
+            }
+            test_err_if(interface.drops().codel != drops, "test 3 failed: CoDel kept dropping");
+
+            // under overload, the limit still bounds the queue, with CoDel dropping too
+            EgressConfig limited = config;
+            limited.max_frames = 100;
+            NetworkInterface overloaded(local_eth, Address("10.0.0.1", 0), limited);
+            learn_neighbor(overloaded, local_eth, "10.0.0.1", neighbor_eth, "10.0.0.2");
+            overloaded.frames_out() = {};
+            for (unsigned ms = 0; ms < 5000; ms++) {
+                overloaded.send_datagram(make_datagram(), neighbor);
+                overloaded.send_datagram(make_datagram(), neighbor);
+                overloaded.frames_out().pop();
+                overloaded.tick(1);
+                test_err_if(overloaded.frames_out().size() > 100, "test 3 failed: limit exceeded");
+            }
+            test_err_if(overloaded.drops().codel == 0 or overloaded.drops().queue_full == 0,
+                        "test 3 failed: overload without both kinds of drops");
+        }
+
+        // test 4: datagrams waiting for ARP are limited too, and sent when their next hop is learned
+        {
+            EgressConfig config;
+            config.max_pending_datagrams = 3;
+            NetworkInterface interface(local_eth, Address("10.0.0.1", 0), config);
+            for (unsigned i = 0; i < 5; i++) {
+                interface.send_datagram(make_datagram(), Address("10.0.0." + to_string(10 + i), 0));
+            }
+            test_err_if(interface.frames_out().size() != 5, "test 4 failed: ARP requests not sent");
+            test_err_if(interface.drops().pending_full != 2, "test 4 failed: pending limit not enforced");
+            interface.frames_out() = {};
+
+            learn_neighbor(interface, local_eth, "10.0.0.1", neighbor_eth, "10.0.0.10");
+            test_err_if(interface.frames_out().size() != 1, "test 4 failed: waiting datagram not sent");
+            interface.frames_out() = {};
+
+            // its room is free again
+            interface.send_datagram(make_datagram(), Address("10.0.0.20", 0));
+            test_err_if(interface.drops().pending_full != 2, "test 4 failed: room not freed");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#include "epoch.hh"
+#include "test_err_if.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+int main() {
+    try {
+        // test 1: nothing deferred is run while a reader that might hold it is inside a Guard
+        {
+            Epoch::reclaim();
+            unsigned reclaimed = 0;
+            {
+                const Epoch::Guard outer;
+                {
+                    const Epoch::Guard inner;
+                }
+                Epoch::defer([&] { reclaimed++; });
+                test_err_if(Epoch::reclaim() != 0 or reclaimed != 0, "test 1 failed: reclaimed under a reader");
+            }
+            test_err_if(Epoch::reclaim() != 1 or reclaimed != 1, "test 1 failed: not reclaimed after the reader");
+
+            // a reader that arrives after the defer() cannot hold it, so it does not hold it back
+            Epoch::defer([&] { reclaimed++; });
+            {
+                const Epoch::Guard late;
+                test_err_if(Epoch::reclaim() != 1 or reclaimed != 2, "test 1 failed: held back by a later reader");
+            }
+        }
+
+        // test 2: a reader in another thread holds back reclamation until it leaves its Guard
+        {
+            atomic<int> stage{0};
+            thread reader([&] {
+                const Epoch::Guard guard;
+                stage = 1;
+                while (stage != 2) {
+                    this_thread::yield();
+                }
+            });
+            while (stage != 1) {
+                this_thread::yield();
+            }
+
+            int *object = new int{7};
+            Epoch::retire(object);
+            test_err_if(Epoch::reclaim() != 0 or Epoch::pending() != 1, "test 2 failed: freed under a reader");
+
+            stage = 2;
+            reader.join();
+            test_err_if(Epoch::reclaim() != 1 or Epoch::pending() != 0, "test 2 failed: not freed after the reader");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -47,6 +47,22 @@ int main() {
             test.execute(AtEof{});
         }
 
+        {
+            ReassemblerTestHarness test{65000};
+
+            test.execute(SubmitSegment{"", 1}.with_eof(true));
+
+            test.execute(BytesAssembled(0));
+            test.execute(NotAtEof{});
+
+            test.execute(SubmitSegment{"a", 0});
+            test.execute(SubmitSegment{"", 1}.with_eof(true));
+
+            test.execute(BytesAssembled(1));
+            test.execute(BytesAvailable("a"));
+            test.execute(AtEof{});
+        }
+
         {
             ReassemblerTestHarness test{65000};
 
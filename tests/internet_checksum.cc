@@ -0,0 +1,190 @@
+#include "checksum_kernels.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+//! The original byte-at-a-time algorithm, as the reference
+static uint16_t reference_checksum(const string_view data) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < data.size(); i++) {
+        sum += (i % 2) ? uint8_t(data[i]) : uint8_t(data[i]) << 8;
+    }
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return ~sum;
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        string data(4096 + 64, 0);
+        for (auto &ch : data) {
+            ch = rd();
+        }
+
+        for (const auto &[name, kernel] : available_checksum_kernels()) {
+            // test 1: every length and alignment up to a few vectors' worth, in one call
+            for (size_t offset = 0; offset < 33; offset++) {
+                for (size_t len = 0; len < 300; len++) {
+                    const string_view chunk{data.data() + offset, len};
+                    InternetChecksum check{0, kernel};
+                    check.add(chunk);
+                    test_err_if(check.value() != reference_checksum(chunk),
+                                "test 1 failed: " + name + " kernel, offset " + to_string(offset) + ", length " +
+                                    to_string(len));
+                }
+            }
+
+            // test 2: the same data split into random (often odd-length) pieces
+            for (unsigned rep = 0; rep < 200; rep++) {
+                const size_t len = rd() % data.size();
+                InternetChecksum check{0, kernel};
+                for (size_t pos = 0; pos < len;) {
+                    const size_t piece = min<size_t>(len - pos, rd() % 100);
+                    check.add({data.data() + pos, piece});
+                    pos += piece;
+                }
+                test_err_if(check.value() != reference_checksum({data.data(), len}),
+                            "test 2 failed: " + name + " kernel, length " + to_string(len));
+            }
+
+            // test 3: all-ones data (the largest sums) and an initial sum, as for a pseudo-header
+            {
+                const string ones(2000, char(0xff));
+                InternetChecksum check{0x1234ffff, kernel};
+                check.add(ones);
+                InternetChecksum expected{0x1234ffff, checksum_kernel_word64};
+                for (const char ch : ones) {
+                    expected.add({&ch, 1});
+                }
+                test_err_if(check.value() != expected.value(), "test 3 failed: " + name + " kernel");
+            }
+        }
+
+        // test 4: incremental updates (RFC 1624) agree with recomputing the checksum
+        for (unsigned rep = 0; rep < 1000; rep++) {
+            string header(20, 0);
+            for (auto &ch : header) {
+                ch = rd();
+            }
+            const size_t offset = 2 * (rd() % 10);
+            const uint16_t old_word = (uint8_t(header[offset]) << 8) | uint8_t(header[offset + 1]);
+            const uint16_t new_word = rep == 0 ? 0 : rd();
+
+            const uint16_t before = reference_checksum(header);
+            header[offset] = new_word >> 8;
+            header[offset + 1] = new_word & 0xff;
+            const uint16_t after = reference_checksum(header);
+
+            const uint16_t updated = InternetChecksum::update(before, old_word, new_word);
+            test_err_if(updated != after and not(updated == 0xffff and after == 0) and
+                            not(updated == 0 and after == 0xffff),
+                        "test 4 failed: update() disagrees with recomputation");
+        }
+
+        // test 5: a forwarded datagram keeps a valid header checksum after decrement_ttl()
+        {
+            IPv4Datagram dgram;
+            dgram.header().src = 0x0a000001;
+            dgram.header().dst = 0xc0a80102;
+            dgram.header().id = 0x1234;
+            dgram.header().len = IPv4Header::LENGTH + 5;
+            dgram.payload() = string("hello");
+
+            IPv4Datagram forwarded;
+            test_err_if(forwarded.parse(dgram.serialize().concatenate()) != ParseResult::NoError,
+                        "test 5 failed: datagram did not parse");
+            for (unsigned hop = 0; hop < 5; hop++) {
+                forwarded.header().decrement_ttl();
+                IPv4Datagram next;
+                test_err_if(next.parse(forwarded.serialize().concatenate()) != ParseResult::NoError,
+                            "test 5 failed: bad checksum after decrement_ttl()");
+                test_err_if(next.header().ttl != IPv4Header::DEFAULT_TTL - hop - 1, "test 5 failed: wrong TTL");
+                forwarded = next;
+            }
+
+            // any other change must still be checksummed from scratch
+            forwarded.header().dst = 0xc0a80103;
+            IPv4Datagram next;
+            test_err_if(next.parse(forwarded.serialize().concatenate()) != ParseResult::NoError,
+                        "test 5 failed: bad checksum after rewriting the destination");
+        }
+
+        // test 6: a relayed segment keeps a valid checksum after its ports and pseudo-header change
+        {
+            TCPSegment seg;
+            seg.header().seqno = WrappingInt32{12345};
+            seg.header().ack = true;
+            seg.header().win = 1000;
+            seg.payload() = string(1000, 'x');
+
+            TCPSegment relayed;
+            test_err_if(relayed.parse(seg.serialize(0x1234).concatenate(), 0x1234) != ParseResult::NoError,
+                        "test 6 failed: segment did not parse");
+            relayed.header().set_ports(8080, 443);
+
+            TCPSegment next;
+            test_err_if(next.parse(relayed.serialize(0x2abcd).concatenate(), 0x2abcd) != ParseResult::NoError,
+                        "test 6 failed: bad checksum after rewriting ports and pseudo-header");
+            test_err_if(next.header().sport != 8080 or next.header().dport != 443, "test 6 failed: wrong ports");
+
+            relayed.header().seqno = WrappingInt32{54321};
+            test_err_if(next.parse(relayed.serialize(0x2abcd).concatenate(), 0x2abcd) != ParseResult::NoError,
+                        "test 6 failed: bad checksum after rewriting the sequence number");
+        }
+
+        // test 7: a Buffer's cached partial sum, at any starting offset and parity
+        {
+            Buffer buffer{data.substr(0, 1001)};
+            const Buffer copy = buffer;
+            for (size_t removed = 0; removed < 20; removed++) {
+                for (const size_t before : {0, 1, 2, 3}) {
+                    const string prefix = data.substr(2000, before);
+                    InternetChecksum check{0x42};
+                    check.add(prefix);
+                    check.add_partial_sum(buffer.partial_checksum(), buffer.size());
+                    check.add("!");
+
+                    const string whole = prefix + buffer.copy() + "!";
+                    InternetChecksum expected{0x42};
+                    expected.add(whole);
+                    test_err_if(check.value() != expected.value(),
+                                "test 7 failed: offset " + to_string(removed) + ", prefix " + to_string(before));
+                }
+                InternetChecksum whole_copy;
+                whole_copy.add(copy);
+                test_err_if(copy.partial_checksum() != uint16_t(~whole_copy.value()),
+                            "test 7 failed: a copy at another offset got the wrong sum");
+                buffer.remove_prefix(1);
+            }
+        }
+
+        // test 8: a segment serializes the same way every time (as when it is retransmitted)
+        {
+            TCPSegment seg;
+            seg.header().seqno = WrappingInt32{777};
+            seg.payload() = data.substr(0, 1459);
+            const string first = seg.serialize(0x1f00d).concatenate();
+            const string second = seg.serialize(0x1f00d).concatenate();
+            TCPSegment parsed;
+            test_err_if(first != second or parsed.parse(string(second), 0x1f00d) != ParseResult::NoError,
+                        "test 8 failed: retransmitted segment has a bad checksum");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
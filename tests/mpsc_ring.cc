@@ -0,0 +1,84 @@
+#include "mpsc_ring.hh"
+#include "test_err_if.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        // test 1: one thread: order, a full ring, and items swapped in and out
+        {
+            MPSCRing<vector<int>> ring(3);
+            test_err_if(ring.capacity() != 4, "test 1 failed: capacity not rounded up to a power of two");
+
+            vector<int> item;
+            test_err_if(ring.try_pop(item), "test 1 failed: popped from an empty ring");
+            for (int i = 0; i < 4; i++) {
+                item = {i};
+                test_err_if(not ring.try_push(item), "test 1 failed: push failed");
+                test_err_if(not item.empty(), "test 1 failed: push did not hand back the empty slot");
+            }
+            item = {4};
+            test_err_if(ring.try_push(item) or item != vector<int>{4}, "test 1 failed: pushed to a full ring");
+
+            for (int i = 0; i < 4; i++) {
+                item = {-1};
+                test_err_if(not ring.try_pop(item) or item != vector<int>{i}, "test 1 failed: wrong item popped");
+            }
+            test_err_if(ring.try_pop(item), "test 1 failed: popped more than was pushed");
+
+            // what the consumer left in a slot goes back to the next producer that uses it
+            item = {5};
+            test_err_if(not ring.try_push(item) or item != vector<int>{-1}, "test 1 failed: slot not swapped");
+        }
+
+        // test 2: several producers, each of whose items arrive once and in order
+        {
+            constexpr unsigned num_producers = 4;
+            constexpr uint64_t per_producer = 100000;
+            MPSCRing<uint64_t> ring(64);
+
+            vector<thread> producers;
+            for (uint64_t producer = 0; producer < num_producers; producer++) {
+                producers.emplace_back([&ring, producer] {
+                    for (uint64_t i = 0; i < per_producer; i++) {
+                        uint64_t item = (producer << 32) | i;
+                        while (not ring.try_push(item)) {
+                            this_thread::yield();
+                        }
+                    }
+                });
+            }
+
+            vector<uint64_t> next(num_producers, 0);
+            for (uint64_t received = 0; received < num_producers * per_producer;) {
+                uint64_t item = 0;
+                if (not ring.try_pop(item)) {
+                    this_thread::yield();
+                    continue;
+                }
+                const uint64_t producer = item >> 32;
+                test_err_if(producer >= num_producers or (item & 0xffffffff) != next[producer],
+                            "test 2 failed: item lost, repeated or out of order");
+                next[producer]++;
+                received++;
+            }
+            for (auto &producer : producers) {
+                producer.join();
+            }
+            uint64_t item = 0;
+            test_err_if(ring.try_pop(item), "test 2 failed: more items than were pushed");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
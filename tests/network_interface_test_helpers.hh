@@ -0,0 +1,54 @@
+#ifndef SPONGE_TESTS_NETWORK_INTERFACE_TEST_HELPERS_HH
+#define SPONGE_TESTS_NETWORK_INTERFACE_TEST_HELPERS_HH
+
+#include "address.hh"
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface.hh"
+
+#include <string>
+
+//! Make a datagram from `src_ip` to `dst_ip`, carrying `payload`
+inline InternetDatagram make_datagram(const std::string &src_ip = "10.0.0.1",
+                                      const std::string &dst_ip = "1.2.3.4",
+                                      const std::string &payload = "hello") {
+    InternetDatagram dgram;
+    dgram.header().src = Address(src_ip, 0).ipv4_numeric();
+    dgram.header().dst = Address(dst_ip, 0).ipv4_numeric();
+    dgram.payload() = std::string(payload);
+    dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+    return dgram;
+}
+
+//! Make an ARP reply from `sender_ip` (at `sender_eth`) to the interface at `target_eth` and `target_ip`
+inline EthernetFrame make_arp_reply(const EthernetAddress &sender_eth,
+                                    const std::string &sender_ip,
+                                    const EthernetAddress &target_eth,
+                                    const std::string &target_ip) {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = sender_eth;
+    arp.sender_ip_address = Address(sender_ip, 0).ipv4_numeric();
+    arp.target_ethernet_address = target_eth;
+    arp.target_ip_address = Address(target_ip, 0).ipv4_numeric();
+
+    EthernetFrame frame;
+    frame.header().dst = target_eth;
+    frame.header().src = sender_eth;
+    frame.header().type = EthernetHeader::TYPE_ARP;
+    frame.payload() = BufferList(arp.serialize()).concatenate();
+    return frame;
+}
+
+//! Have the interface at `local_eth` and `local_ip` learn that `neighbor_ip` is at `neighbor_eth`, from an
+//! ARP reply the neighbor sends (so the interface sends nothing back)
+inline void learn_neighbor(NetworkInterface &interface,
+                           const EthernetAddress &local_eth,
+                           const std::string &local_ip,
+                           const EthernetAddress &neighbor_eth,
+                           const std::string &neighbor_ip) {
+    interface.recv_frame(make_arp_reply(neighbor_eth, neighbor_ip, local_eth, local_ip));
+}
+
+#endif  // SPONGE_TESTS_NETWORK_INTERFACE_TEST_HELPERS_HH
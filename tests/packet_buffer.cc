@@ -0,0 +1,194 @@
+#include "buffer.hh"
+#include "ethernet_frame.hh"
+#include "file_descriptor.hh"
+#include "ipv4_datagram.hh"
+#include "packet_buffer.hh"
+#include "packet_pool.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        // test 1: headers prepended in place, in front of an appended payload
+        {
+            PacketBuffer packet{8};
+            packet.append("payload");
+            copy_n("hdr1", 4, packet.prepend(4));
+            copy_n("hdr2", 4, packet.prepend(4));
+            test_err_if(packet.str() != "hdr2hdr1payload", "test 1 failed: wrong contents");
+            test_err_if(packet.headroom() != 0, "test 1 failed: headroom not used");
+
+            // out of headroom: the packet moves, and keeps its contents
+            copy_n("h0", 2, packet.prepend(2));
+            test_err_if(packet.str() != "h0hdr2hdr1payload" or packet.headroom() == 0,
+                        "test 1 failed: contents lost when the headroom grew");
+        }
+
+        // test 2: headroom goes to the first Buffer to claim it
+        {
+            PacketBuffer packet{4};
+            packet.append("data");
+            Buffer first = packet.release();
+            Buffer second = first;
+
+            uint8_t *room = first.claim_headroom(2);
+            test_err_if(room == nullptr, "test 2 failed: headroom not claimed");
+            copy_n("ab", 2, room);
+            test_err_if(first.str() != "abdata", "test 2 failed: wrong contents after claim");
+            test_err_if(second.claim_headroom(1) != nullptr, "test 2 failed: claimed headroom claimed again");
+            test_err_if(second.str() != "data", "test 2 failed: copy changed");
+
+            test_err_if(first.claim_headroom(3) != nullptr, "test 2 failed: claimed more than the headroom");
+            test_err_if(first.claim_headroom(2) == nullptr, "test 2 failed: rest of headroom not claimed");
+            test_err_if(Buffer{string("plain")}.claim_headroom(1) != nullptr,
+                        "test 2 failed: claimed headroom of a plain Buffer");
+        }
+
+        // test 3: a segment, encapsulated in a datagram and then a frame, comes out as one contiguous buffer
+        {
+            TCPSegment seg;
+            seg.header().seqno = WrappingInt32{42};
+            seg.header().syn = true;
+            seg.payload() = string(500, 'p');
+
+            IPv4Datagram dgram;
+            dgram.header().src = 0x0a000001;
+            dgram.header().dst = 0x0a000002;
+            dgram.header().len = IPv4Header::LENGTH + TCPHeader::LENGTH + 500;
+            dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+
+            EthernetFrame frame;
+            frame.header().type = EthernetHeader::TYPE_IPv4;
+            frame.header().src = {2, 0, 0, 0, 0, 1};
+            frame.header().dst = {2, 0, 0, 0, 0, 2};
+            frame.payload() = dgram.serialize();
+
+            const BufferList serialized = frame.serialize();
+            test_err_if(serialized.buffers().size() != 1, "test 3 failed: frame is not contiguous");
+
+            // serializing again cannot reuse the headroom, but must give the same bytes
+            const BufferList again = frame.serialize();
+            test_err_if(again.concatenate() != serialized.concatenate(), "test 3 failed: serializations differ");
+            test_err_if(dgram.serialize().concatenate() != frame.payload().concatenate(),
+                        "test 3 failed: datagram serializations differ");
+
+            EthernetFrame parsed_frame;
+            IPv4Datagram parsed_dgram;
+            TCPSegment parsed_seg;
+            test_err_if(parsed_frame.parse(serialized.buffers().front()) != ParseResult::NoError or
+                            parsed_dgram.parse(parsed_frame.payload()) != ParseResult::NoError or
+                            parsed_seg.parse(parsed_dgram.payload(), parsed_dgram.header().pseudo_cksum()) !=
+                                ParseResult::NoError,
+                        "test 3 failed: frame did not parse");
+            test_err_if(parsed_frame.header().src != frame.header().src or not parsed_seg.header().syn or
+                            parsed_seg.payload().str() != string(500, 'p'),
+                        "test 3 failed: wrong contents after parsing");
+
+            // with the header already serialized, the frame is complete as soon as it is assigned
+            dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+            const Buffer header_bytes{frame.header().serialize()};
+            EthernetFrame assigned;
+            assigned.assign(frame.header(), header_bytes, dgram.serialize());
+            const BufferList assigned_serialized = assigned.serialize();
+            test_err_if(assigned_serialized.buffers().size() != 1 or
+                            assigned_serialized.concatenate() != serialized.concatenate(),
+                        "test 3 failed: assigned frame differs");
+            test_err_if(assigned.serialize().concatenate() != serialized.concatenate(),
+                        "test 3 failed: assigned frame differs when serialized again");
+
+            // a payload with no room in front (e.g. a forwarded datagram) gets the serialized header as its own piece
+            EthernetFrame forwarded;
+            forwarded.assign(frame.header(), header_bytes, frame.payload());
+            const BufferList forwarded_serialized = forwarded.serialize();
+            test_err_if(forwarded_serialized.buffers().size() != 2 or
+                            forwarded_serialized.buffers().front().str().data() != header_bytes.str().data() or
+                            forwarded_serialized.concatenate() != serialized.concatenate(),
+                        "test 3 failed: header not shared in front of the payload");
+
+            // and once its header may have changed, it is serialized from the header again
+            assigned.header().dst = {2, 0, 0, 0, 0, 3};
+            test_err_if(assigned.serialize().concatenate().substr(0, 6) != string("\x02\0\0\0\0\x03", 6),
+                        "test 3 failed: changed header not serialized");
+        }
+
+        // test 4: packets recycle their PacketPool slots
+        {
+            const size_t slabs_before = PacketPool::slab_count();
+            for (unsigned int i = 0; i < 100000; i++) {
+                PacketBuffer packet;
+                packet.append(string(1000, 'x'));
+                copy_n("header", 6, packet.prepend(6));
+                Buffer released = packet.release();
+                Buffer copy = released;
+                test_err_if(copy.size() != 1006, "test 4 failed: wrong size");
+            }
+            test_err_if(PacketPool::slab_count() > slabs_before + 1, "test 4 failed: slots not reused");
+
+            // a packet too big for a slot still works
+            PacketBuffer big{PacketBuffer::DEFAULT_HEADROOM, 3 * Buffer::POOLED_CAPACITY};
+            big.append(string(3 * Buffer::POOLED_CAPACITY, 'b'));
+            test_err_if(big.release().str() != string(3 * Buffer::POOLED_CAPACITY, 'b'), "test 4 failed: big packet");
+        }
+
+        // test 5: read_packet() reads into a slot, or past it into the overflow area
+        {
+            int fds[2];
+            test_err_if(pipe(fds) != 0, "test 5 failed: pipe");
+            FileDescriptor reader{fds[0]};
+            FileDescriptor writer{fds[1]};
+
+            writer.write("a small packet");
+            test_err_if(reader.read_packet().str() != "a small packet", "test 5 failed: small packet");
+
+            const string big(Buffer::POOLED_CAPACITY + 1000, 'z');
+            writer.write(big);
+            const Buffer packet = reader.read_packet();
+            test_err_if(packet.str() != big, "test 5 failed: packet bigger than a slot");
+
+            writer.close();
+            test_err_if(reader.read_packet().size() != 0 or not reader.eof(), "test 5 failed: EOF not detected");
+        }
+
+        // test 6: packets built on one thread and freed on another
+        {
+            vector<Buffer> packets;
+            for (unsigned int round = 0; round < 20; round++) {
+                for (unsigned int i = 0; i < 1000; i++) {
+                    PacketBuffer packet;
+                    packet.append(to_string(i));
+                    packets.push_back(packet.release());
+                }
+                thread consumer([moved = move(packets)]() mutable { moved.clear(); });
+                consumer.join();
+                packets.clear();
+            }
+
+            // the slots given back by the consumers are available again
+            const size_t slabs_before = PacketPool::slab_count();
+            for (unsigned int i = 0; i < 1000; i++) {
+                PacketBuffer packet;
+                packet.append(to_string(i));
+                packets.push_back(packet.release());
+            }
+            test_err_if(PacketPool::slab_count() != slabs_before, "test 6 failed: freed slots not reused");
+            test_err_if(packets.back().str() != "999", "test 6 failed: wrong contents");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
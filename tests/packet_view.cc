@@ -0,0 +1,84 @@
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "packet_view.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+//! An adapter with `local` as its source and `remote` as its destination
+static TCPOverIPv4Adapter make_adapter(const Address &local, const Address &remote) {
+    TCPOverIPv4Adapter adapter;
+    adapter.config_mut().source = local;
+    adapter.config_mut().destination = remote;
+    return adapter;
+}
+
+int main() {
+    try {
+        const Address a{"10.0.0.1", 1234};
+        const Address b{"10.0.0.2", 80};
+        const Address c{"10.0.0.3", 80};
+
+        TCPOverIPv4Adapter sender = make_adapter(a, b);
+        TCPSegment seg;
+        seg.header().syn = true;
+        seg.payload() = string("hello");
+        const string raw = sender.wrap_tcp_in_ip(seg).serialize().concatenate();
+
+        // test 1: the view reads the addresses and ports without parsing
+        {
+            const PacketView view{raw};
+            test_err_if(not view.is_ipv4() or view.proto() != IPv4Header::PROTO_TCP, "test 1 failed: not TCP/IPv4");
+            test_err_if(view.src() != a.ipv4_numeric() or view.dst() != b.ipv4_numeric(), "test 1 failed: addresses");
+            test_err_if(not view.has_ports() or view.sport() != 1234 or view.dport() != 80, "test 1 failed: ports");
+
+            test_err_if(PacketView{raw.substr(0, 19)}.is_ipv4(), "test 1 failed: truncated header accepted");
+            test_err_if(PacketView{raw.substr(0, 22)}.has_ports(), "test 1 failed: truncated ports accepted");
+            string v6 = raw;
+            v6[0] = 0x65;
+            test_err_if(PacketView{v6}.is_ipv4(), "test 1 failed: IPv6 accepted");
+        }
+
+        // test 2: raw datagrams for the connection are parsed, and others dropped
+        {
+            TCPOverIPv4Adapter receiver = make_adapter(b, a);
+            const auto received = receiver.unwrap_tcp_in_ip(Buffer{string(raw)});
+            test_err_if(not received or received->payload().str() != "hello", "test 2 failed: segment not received");
+
+            TCPOverIPv4Adapter other_peer = make_adapter(b, c);
+            test_err_if(other_peer.unwrap_tcp_in_ip(Buffer{string(raw)}).has_value(), "test 2 failed: wrong peer");
+
+            TCPOverIPv4Adapter other_host = make_adapter(c, a);
+            test_err_if(other_host.unwrap_tcp_in_ip(Buffer{string(raw)}).has_value(), "test 2 failed: wrong host");
+            test_err_if(other_host.unwrap_tagged_tcp_in_ip(Buffer{string(raw)}).has_value(),
+                        "test 2 failed: tagged segment for wrong host");
+
+            const auto tagged = other_peer.unwrap_tagged_tcp_in_ip(Buffer{string(raw)});
+            test_err_if(not tagged or tagged->tuple.remote_port != 1234, "test 2 failed: tagged segment");
+
+            string corrupt = raw;
+            corrupt.back() ^= 1;
+            test_err_if(receiver.unwrap_tcp_in_ip(Buffer{move(corrupt)}).has_value(),
+                        "test 2 failed: bad checksum accepted");
+
+            // a listening adapter accepts the SYN, and then only that peer
+            TCPOverIPv4Adapter listener = make_adapter(Address{"0", 80}, Address{"0", 0});
+            listener.set_listening(true);
+            test_err_if(not listener.unwrap_tcp_in_ip(Buffer{string(raw)}), "test 2 failed: SYN not accepted");
+            test_err_if(listener.listening() or listener.config().destination.port() != 1234,
+                        "test 2 failed: listener did not connect");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+#include "epoch.hh"
+#include "poptrie.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Route {
+    uint32_t prefix;
+    uint8_t length;
+    uint32_t value;
+};
+
+//! Longest-prefix match by scanning every route (a later route replaces an earlier one with the same prefix)
+static optional<uint32_t> reference_lookup(const vector<Route> &routes, const uint32_t address) {
+    optional<uint32_t> ret;
+    int best_length = -1;
+    for (const Route &route : routes) {
+        const uint32_t mask = route.length ? ~uint32_t(0) << (32 - route.length) : 0;
+        if ((address & mask) == (route.prefix & mask) and route.length >= best_length) {
+            best_length = route.length;
+            ret = route.value;
+        }
+    }
+    return ret;
+}
+
+//! Does `route` have the same prefix as `prefix`/`length`?
+static bool same_prefix(const Route &route, const uint32_t prefix, const uint8_t length) {
+    const uint32_t mask = length ? ~uint32_t(0) << (32 - length) : 0;
+    return route.length == length and (route.prefix & mask) == (prefix & mask);
+}
+
+//! Check `table` against the reference at `address` and at addresses near it
+static void check_around(const Poptrie &table,
+                         const vector<Route> &routes,
+                         const uint32_t address,
+                         const string &test) {
+    for (const uint32_t a : {address, address - 1, address + 1, address ^ 0xff, address | 0xffff}) {
+        test_err_if(table.lookup(a) != reference_lookup(routes, a),
+                    test + " failed: wrong match for " + to_string(a >> 24) + "." + to_string((a >> 16) & 0xff) +
+                        "." + to_string((a >> 8) & 0xff) + "." + to_string(a & 0xff));
+    }
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // test 1: an empty table, a default route, and prefixes at the edges of the direct table and the strides
+        {
+            Poptrie table;
+            vector<Route> routes;
+            test_err_if(table.lookup(0x0a000001).has_value(), "test 1 failed: match in an empty table");
+
+            const vector<Route> edge_routes{{0x0a000000, 8, 1},  {0x0a010000, 15, 2}, {0x0a010000, 16, 3},
+                                            {0x0a018000, 17, 4}, {0x0a010200, 24, 5}, {0x0a010204, 30, 6},
+                                            {0x0a010205, 32, 7}, {0x0a0101f0, 28, 8}, {0xffffffff, 32, 9},
+                                            {0, 0, 10},          {0x0a010000, 16, 11}};
+            for (const Route &route : edge_routes) {
+                table.insert(route.prefix, route.length, route.value);
+                routes.push_back(route);
+                for (const Route &probe : routes) {
+                    check_around(table, routes, probe.prefix, "test 1");
+                }
+            }
+            test_err_if(table.size() != edge_routes.size() - 1, "test 1 failed: replaced prefix counted twice");
+            test_err_if(table.lookup(0x0a010403) != 11u, "test 1 failed: prefix not replaced");
+            test_err_if(table.lookup(0x01020304) != 10u, "test 1 failed: default route");
+        }
+
+        // test 2: many random prefixes, against the reference
+        {
+            Poptrie table;
+            vector<Route> routes;
+            for (uint32_t value = 0; value < 2000; value++) {
+                // mostly long prefixes, clustered in a few /8s so that they nest
+                const uint8_t length = value % 10 == 0 ? rd() % 17 : 16 + rd() % 17;
+                const uint32_t prefix = (uint32_t(10 + rd() % 4) << 24) | (rd() & 0x00ffffff);
+                table.insert(prefix, length, value);
+                routes.push_back({prefix, length, value});
+            }
+            for (unsigned i = 0; i < 20000; i++) {
+                const Route &route = routes[rd() % routes.size()];
+                const uint32_t host_bits = route.length == 32 ? 0 : rd() & (~uint32_t(0) >> route.length);
+                check_around(table, routes, route.prefix | host_bits, "test 2");
+            }
+            for (unsigned i = 0; i < 1000; i++) {
+                check_around(table, routes, rd(), "test 2");
+            }
+
+            // a batch (not a whole number of prefetch groups) of routed and random addresses
+            vector<uint32_t> addresses;
+            for (unsigned i = 0; i < 1001; i++) {
+                addresses.push_back(i % 2 ? rd() : routes[rd() % routes.size()].prefix | (rd() & 0xff));
+            }
+            vector<optional<uint32_t>> values(addresses.size(), 0);
+            table.lookup_batch(addresses.data(), addresses.size(), values.data());
+            for (size_t i = 0; i < addresses.size(); i++) {
+                test_err_if(values[i] != reference_lookup(routes, addresses[i]), "test 2 failed: wrong batch match");
+            }
+        }
+
+        // test 3: prefixes removed and replaced, against the reference
+        {
+            Poptrie table;
+            vector<Route> routes;
+            for (uint32_t value = 0; value < 3000; value++) {
+                const unsigned action = rd() % 4;
+                if (action == 0 and not routes.empty()) {
+                    const size_t victim = rd() % routes.size();
+                    const Route route = routes[victim];
+                    routes.erase(routes.begin() + victim);
+                    test_err_if(table.remove(route.prefix, route.length) != route.value,
+                                "test 3 failed: wrong value removed");
+                    test_err_if(table.find(route.prefix, route.length).has_value(), "test 3 failed: still there");
+                    check_around(table, routes, route.prefix, "test 3");
+                } else {
+                    const uint8_t length = value % 8 == 0 ? rd() % 17 : 16 + rd() % 17;
+                    const uint32_t prefix = (uint32_t(10 + rd() % 2) << 24) | (rd() & 0x00ffffff);
+                    const auto old = find_if(routes.begin(), routes.end(), [&](const Route &route) {
+                        return same_prefix(route, prefix, length);
+                    });
+                    const auto replaced = table.insert(prefix, length, value);
+                    if (old != routes.end()) {
+                        test_err_if(replaced != old->value, "test 3 failed: wrong value replaced");
+                        routes.erase(old);
+                    } else {
+                        test_err_if(replaced.has_value(), "test 3 failed: replaced a prefix that was not there");
+                    }
+                    routes.push_back({prefix, length, value});
+                    check_around(table, routes, prefix, "test 3");
+                }
+            }
+            test_err_if(table.size() != routes.size(), "test 3 failed: wrong size");
+            test_err_if(table.remove(0x0c000000, 8).has_value(), "test 3 failed: removed a prefix that was not there");
+            for (unsigned i = 0; i < 5000; i++) {
+                check_around(table, routes, (uint32_t(10 + rd() % 2) << 24) | (rd() & 0x00ffffff), "test 3");
+            }
+
+            // removing everything leaves no matches
+            for (const Route &route : routes) {
+                table.remove(route.prefix, route.length);
+            }
+            test_err_if(table.size() != 0 or table.lookup(0x0a000001).has_value(), "test 3 failed: not empty");
+        }
+
+        // test 4: readers look up (without blocking) while a writer changes the prefixes under them
+        {
+            Poptrie table;
+            table.insert(0x0a000000, 8, 1);
+            atomic<bool> done{false};
+            atomic<unsigned> bad{0};
+
+            vector<thread> readers;
+            for (unsigned r = 0; r < 3; r++) {
+                readers.emplace_back([&] {
+                    auto reader_rd = get_random_generator();
+                    while (not done) {
+                        const Epoch::Guard guard;
+                        for (unsigned i = 0; i < 256; i++) {
+                            // every address in 10/8 is covered by the /8 (value 1) or by a /24 (value 2)
+                            const auto value = table.lookup(0x0a000000 | (reader_rd() & 0x00ffffff));
+                            bad += not value or (value != 1u and value != 2u);
+                        }
+                    }
+                });
+            }
+
+            for (unsigned i = 0; i < 20000; i++) {
+                const uint32_t prefix = 0x0a000000 | ((rd() & 0x3fff) << 8);
+                if (rd() % 2) {
+                    table.insert(prefix, 24, 2);
+                } else {
+                    table.remove(prefix, 24);
+                }
+            }
+            done = true;
+            for (auto &reader : readers) {
+                reader.join();
+            }
+            test_err_if(bad != 0, "test 4 failed: a reader saw a wrong value");
+
+            Epoch::reclaim();
+            test_err_if(Epoch::pending() != 0, "test 4 failed: replaced subtrees not freed");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include "ring_buffer.hh"
+#include "test_err_if.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        // test 1: FIFO order, and full/empty behavior
+        {
+            RingBuffer<string> ring{4};
+            test_err_if(ring.try_pop().has_value(), "test 1 failed: pop from empty ring");
+            for (unsigned i = 0; i < 4; ++i) {
+                test_err_if(not ring.try_push(to_string(i)), "test 1 failed: push to non-full ring");
+            }
+            string extra = "extra";
+            test_err_if(ring.try_push(move(extra)), "test 1 failed: push to full ring");
+            test_err_if(extra != "extra", "test 1 failed: failed push consumed its value");
+            for (unsigned i = 0; i < 4; ++i) {
+                test_err_if(ring.try_pop() != to_string(i), "test 1 failed: wrong order");
+            }
+            test_err_if(ring.try_pop().has_value(), "test 1 failed: ring not empty");
+        }
+
+        // test 2: move-only values
+        {
+            RingBuffer<unique_ptr<int>> ring{2};
+            test_err_if(not ring.try_push(make_unique<int>(42)), "test 2 failed: push");
+            const auto value = ring.try_pop();
+            test_err_if(not value or **value != 42, "test 2 failed: pop");
+        }
+
+        // test 3: concurrent producers and consumers each see every value exactly once
+        {
+            static constexpr unsigned THREADS = 4;
+            static constexpr uint64_t PER_THREAD = 100000;
+            RingBuffer<uint64_t> ring{64};
+
+            vector<thread> producers, consumers;
+            vector<uint64_t> sums(THREADS, 0), counts(THREADS, 0);
+            for (unsigned t = 0; t < THREADS; ++t) {
+                producers.emplace_back([&, t] {
+                    for (uint64_t i = 0; i < PER_THREAD; ++i) {
+                        uint64_t value = t * PER_THREAD + i + 1;
+                        while (not ring.try_push(move(value))) {
+                            this_thread::yield();
+                        }
+                    }
+                });
+                consumers.emplace_back([&, t] {
+                    while (counts[t] < PER_THREAD) {
+                        const auto value = ring.try_pop();
+                        if (value) {
+                            sums[t] += value.value();
+                            ++counts[t];
+                        } else {
+                            this_thread::yield();
+                        }
+                    }
+                });
+            }
+            for (auto &p : producers) {
+                p.join();
+            }
+            for (auto &c : consumers) {
+                c.join();
+            }
+
+            uint64_t total = 0;
+            for (const auto sum : sums) {
+                total += sum;
+            }
+            const uint64_t n = THREADS * PER_THREAD;
+            test_err_if(total != n * (n + 1) / 2, "test 3 failed: values lost or duplicated");
+            test_err_if(ring.try_pop().has_value(), "test 3 failed: ring not empty");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
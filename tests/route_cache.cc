@@ -0,0 +1,118 @@
+#include "network_interface_test_helpers.hh"
+#include "route_cache.hh"
+#include "router.hh"
+#include "test_err_if.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+//! Make a frame to Ethernet address `dst`, carrying a datagram to `dst_ip`
+static EthernetFrame make_frame(const EthernetAddress &dst, const string &dst_ip) {
+    EthernetFrame frame;
+    frame.header().dst = dst;
+    frame.header().src = {0x02, 0, 0, 0, 0, 0x09};
+    frame.header().type = EthernetHeader::TYPE_IPv4;
+    frame.payload() = make_datagram("10.0.0.2", dst_ip).serialize().concatenate();
+    return frame;
+}
+
+int main() {
+    try {
+        // test 1: hits, misses, negative entries, collisions and invalidation
+        {
+            RouteCache cache(100);
+            test_err_if(cache.capacity() != 128, "test 1 failed: capacity not rounded up to a power of two");
+
+            optional<uint32_t> value;
+            test_err_if(cache.lookup(0x0a000001, value), "test 1 failed: hit in an empty cache");
+            cache.insert(0x0a000001, 7);
+            cache.insert(0x0a000002, {});
+            test_err_if(not cache.lookup(0x0a000001, value) or value != 7u, "test 1 failed: wrong route cached");
+            test_err_if(not cache.lookup(0x0a000002, value) or value.has_value(), "test 1 failed: no route not cached");
+            test_err_if(cache.hits() != 2 or cache.misses() != 1, "test 1 failed: wrong counters");
+
+            // many addresses share the entries, so most of them must have displaced one another
+            for (uint32_t address = 0; address < 1000; address++) {
+                cache.insert(address, address);
+            }
+            unsigned hits = 0;
+            for (uint32_t address = 0; address < 1000; address++) {
+                if (cache.lookup(address, value)) {
+                    test_err_if(value != address, "test 1 failed: a hit for another address");
+                    hits++;
+                }
+            }
+            test_err_if(hits == 0 or hits > cache.capacity(), "test 1 failed: wrong number of hits");
+
+            cache.invalidate();
+            test_err_if(cache.lookup(0x0a000001, value) or cache.lookup(999, value),
+                        "test 1 failed: hit after invalidate()");
+
+            cache.reset_counters();
+            test_err_if(cache.hits() != 0 or cache.misses() != 0 or cache.hit_rate() != 0,
+                        "test 1 failed: counters not reset");
+
+            RouteCache disabled(0);
+            disabled.insert(0x0a000001, 7);
+            test_err_if(disabled.lookup(0x0a000001, value) or disabled.misses() != 1,
+                        "test 1 failed: a disabled cache hit");
+        }
+
+        // test 2: a Router's cached routes follow its route changes
+        {
+            Router router;
+            const EthernetAddress in_eth{0x02, 0, 0, 0, 0, 0x01};
+            const size_t in = router.add_interface(AsyncNetworkInterface(in_eth, Address("10.0.0.1", 0)));
+            const EthernetAddress out1_eth{0x02, 0, 0, 0, 0, 0x02};
+            const EthernetAddress out2_eth{0x02, 0, 0, 0, 0, 0x03};
+            const size_t out1 = router.add_interface(AsyncNetworkInterface(out1_eth, Address("10.1.0.1", 0)));
+            const size_t out2 = router.add_interface(AsyncNetworkInterface(out2_eth, Address("10.2.0.1", 0)));
+
+            // the next hops are known, so a forwarded datagram leaves at once
+            router.interface(out1).recv_frame(make_arp_reply({0x02, 0, 0, 0, 1, 1}, "10.1.0.2", out1_eth, "10.1.0.1"));
+            router.interface(out2).recv_frame(make_arp_reply({0x02, 0, 0, 0, 2, 1}, "10.2.0.2", out2_eth, "10.2.0.1"));
+
+            // send a datagram to `dst_ip` through the router, and return the interface it left from
+            const auto forward = [&](const string &dst_ip) -> optional<size_t> {
+                router.interface(in).recv_frame(make_frame(in_eth, dst_ip));
+                router.route();
+                optional<size_t> ret;
+                for (const size_t out : {out1, out2}) {
+                    auto &frames = router.interface(out).frames_out();
+                    if (not frames.empty()) {
+                        ret = out;
+                    }
+                    frames = {};
+                }
+                return ret;
+            };
+
+            router.add_route(Address("192.168.0.0", 0).ipv4_numeric(), 16, Address("10.1.0.2", 0), out1);
+            test_err_if(forward("192.168.1.1") != out1, "test 2 failed: not routed");
+            test_err_if(forward("192.168.1.1") != out1, "test 2 failed: not routed from the cache");
+            test_err_if(router.route_cache().hits() != 1 or router.route_cache().misses() != 1,
+                        "test 2 failed: the second datagram was not a cache hit");
+
+            router.add_route(Address("192.168.1.0", 0).ipv4_numeric(), 24, Address("10.2.0.2", 0), out2);
+            test_err_if(forward("192.168.1.1") != out2, "test 2 failed: cached route outlived a longer prefix");
+
+            router.replace_route(Address("192.168.1.0", 0).ipv4_numeric(), 24, Address("10.1.0.2", 0), out1);
+            test_err_if(forward("192.168.1.1") != out1, "test 2 failed: cached route outlived a replacement");
+
+            router.remove_route(Address("192.168.1.0", 0).ipv4_numeric(), 24);
+            router.remove_route(Address("192.168.0.0", 0).ipv4_numeric(), 16);
+            test_err_if(forward("192.168.1.1").has_value(), "test 2 failed: cached route outlived its removal");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
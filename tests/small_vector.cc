@@ -0,0 +1,94 @@
+#include "buffer.hh"
+#include "small_vector.hh"
+#include "test_err_if.hh"
+
+#include <array>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // test 1: appended at the back and removed from the front, inline and after spilling to the heap
+        {
+            SmallVector<string, 4> vec;
+            for (unsigned i = 0; i < 10; ++i) {
+                vec.push_back(to_string(i));
+            }
+            test_err_if(vec.size() != 10 or vec.front() != "0" or vec.back() != "9", "test 1 failed: wrong contents");
+            for (unsigned i = 0; i < 10; ++i) {
+                test_err_if(vec[0] != to_string(i), "test 1 failed: wrong order");
+                vec.pop_front();
+            }
+            test_err_if(not vec.empty(), "test 1 failed: not empty");
+
+            // used as a queue: the space freed at the front is reused
+            unsigned next_in = 0, next_out = 0;
+            for (unsigned round = 0; round < 1000; ++round) {
+                vec.push_back(to_string(next_in++));
+                vec.push_back(to_string(next_in++));
+                test_err_if(vec.front() != to_string(next_out++), "test 1 failed: wrong order in queue");
+                vec.pop_front();
+                if (vec.size() > 3) {
+                    vec.pop_front();
+                    next_out++;
+                }
+            }
+            test_err_if(vec.size() > 4, "test 1 failed: queue grew");
+
+            // an element appended from the vector itself, while it moves to bigger storage
+            SmallVector<string, 2> small;
+            small.push_back("first");
+            small.push_back("second");
+            small.push_back(small.front());
+            test_err_if(small.size() != 3 or small.back() != "first", "test 1 failed: self-append");
+        }
+
+        // test 2: copies and moves, inline and on the heap
+        {
+            for (const unsigned n : {3, 9}) {
+                SmallVector<shared_ptr<int>, 4> vec;
+                const auto tracked = make_shared<int>(7);
+                for (unsigned i = 0; i < n; ++i) {
+                    vec.push_back(tracked);
+                }
+
+                SmallVector<shared_ptr<int>, 4> copy = vec;
+                test_err_if(copy.size() != n or tracked.use_count() != 2 * n + 1, "test 2 failed: copy");
+
+                SmallVector<shared_ptr<int>, 4> moved = move(copy);
+                test_err_if(moved.size() != n or not copy.empty(), "test 2 failed: move");
+
+                vec = move(moved);
+                test_err_if(vec.size() != n or tracked.use_count() != n + 1, "test 2 failed: move assignment");
+
+                vec.clear();
+                test_err_if(tracked.use_count() != 1, "test 2 failed: elements not destroyed");
+            }
+        }
+
+        // test 3: iovecs in a caller's array
+        {
+            BufferList list{string("ab")};
+            list.append(BufferList{string("cde")});
+            list.append(BufferList{string("f")});
+            const BufferViewList views{list};
+
+            array<iovec, 2> iovecs;
+            test_err_if(views.count() != 3, "test 3 failed: wrong count");
+            test_err_if(views.as_iovecs(iovecs.data(), iovecs.size()) != 2, "test 3 failed: overfilled");
+            test_err_if(iovecs[1].iov_len != 3 or static_cast<const char *>(iovecs[1].iov_base)[0] != 'c',
+                        "test 3 failed: wrong iovec");
+            test_err_if(views.as_iovecs().size() != 3, "test 3 failed: vector of iovecs");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include "four_tuple.hh"
+#include "siphash.hh"
+#include "syn_cookie.hh"
+#include "test_err_if.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // test 1: SipHash-2-4 reference vectors (key 00 01 ... 0f, input 00 01 ... of increasing length)
+        {
+            const SipHash siphash{{0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL}};
+            string input;
+            test_err_if(siphash(input) != 0x726fdb47dd0e0e31ULL, "test 1 failed: empty input");
+            for (char c = 0; c < 15; ++c) {
+                input.push_back(c);
+            }
+            test_err_if(siphash(input) != 0xa129ca6149be45e5ULL, "test 1 failed: 15-byte input");
+        }
+
+        const FourTuple tuple{0x0a000001, 0x0a000002, 80, 4242};
+        const WrappingInt32 peer_isn{123456789};
+        const uint64_t now = 10 * SynCookies::COUNTER_PERIOD_MS + 5;
+
+        // test 2: a cookie checks out for its own connection, and encodes the MSS
+        {
+            const SynCookies cookies{};
+            const WrappingInt32 cookie = cookies.make(tuple, peer_isn, 1460, now);
+            test_err_if(cookies.check(tuple, peer_isn, cookie, now) != 1460, "test 2 failed: valid cookie rejected");
+            test_err_if(cookies.check(tuple, peer_isn, cookies.make(tuple, peer_isn, 1100, now), now) != 1000,
+                        "test 2 failed: MSS not rounded down to the table");
+        }
+
+        // test 3: a cookie does not check out for anything else
+        {
+            const SynCookies cookies{};
+            const WrappingInt32 cookie = cookies.make(tuple, peer_isn, 1460, now);
+
+            FourTuple other = tuple;
+            other.remote_port = 4243;
+            test_err_if(cookies.check(other, peer_isn, cookie, now).has_value(), "test 3 failed: wrong tuple");
+            test_err_if(cookies.check(tuple, peer_isn + 1, cookie, now).has_value(), "test 3 failed: wrong ISN");
+            test_err_if(cookies.check(tuple, peer_isn, cookie + 1, now).has_value(), "test 3 failed: forged cookie");
+            test_err_if(SynCookies{}.check(tuple, peer_isn, cookie, now).has_value(), "test 3 failed: wrong key");
+        }
+
+        // test 4: cookies expire after one period of the time counter
+        {
+            const SynCookies cookies{};
+            const WrappingInt32 cookie = cookies.make(tuple, peer_isn, 1460, now);
+            test_err_if(not cookies.check(tuple, peer_isn, cookie, now + SynCookies::COUNTER_PERIOD_MS),
+                        "test 4 failed: cookie expired too soon");
+            test_err_if(cookies.check(tuple, peer_isn, cookie, now + 2 * SynCookies::COUNTER_PERIOD_MS).has_value(),
+                        "test 4 failed: cookie did not expire");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,423 @@
+#include "four_tuple.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_demux.hh"
+#include "test_err_if.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+static constexpr uint32_t SERVER_ADDRESS = 0x0a000001;  // 10.0.0.1
+static constexpr uint32_t CLIENT_ADDRESS = 0x0a000002;  // 10.0.0.2
+static constexpr uint16_t SERVER_PORT = 80;
+
+static FourTuple tuple_for(const uint16_t client_port) {
+    return {SERVER_ADDRESS, CLIENT_ADDRESS, SERVER_PORT, client_port};
+}
+
+//! Moves segments between the demultiplexer and in-memory client connections until both sides are quiet
+static void exchange(TCPDemultiplexer &demux, map<uint16_t, TCPConnection *> &clients) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (auto &[port, client] : clients) {
+            while (not client->segments_out().empty()) {
+                demux.segment_received({tuple_for(port), client->segments_out().front()});
+                client->segments_out().pop();
+                progress = true;
+            }
+        }
+        while (not demux.segments_out().empty()) {
+            const TaggedSegment &tagged = demux.segments_out().front();
+            const auto client = clients.find(tagged.tuple.remote_port);
+            if (client != clients.end()) {
+                client->second->segment_received(tagged.segment);
+            }
+            demux.segments_out().pop();
+            progress = true;
+        }
+    }
+}
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.rt_timeout = 100;
+
+        // test 1: one connection through the whole handshake, a data exchange, and a clean close
+        {
+            TCPDemultiplexer demux{cfg};
+            demux.listen(SERVER_PORT);
+
+            TCPConnection client{cfg};
+            map<uint16_t, TCPConnection *> clients{{1000, &client}};
+
+            test_err_if(demux.accept().has_value(), "test 1 failed: accept() before any SYN");
+
+            client.connect();
+            exchange(demux, clients);
+            test_err_if(demux.size() != 1, "test 1 failed: SYN did not create a connection");
+
+            const auto tuple = demux.accept();
+            test_err_if(not tuple.has_value() or tuple.value() != tuple_for(1000),
+                        "test 1 failed: handshake complete but nothing to accept");
+            test_err_if(demux.accept().has_value(), "test 1 failed: connection accepted twice");
+
+            client.write("hello");
+            exchange(demux, clients);
+            test_err_if(demux.inbound_stream(tuple.value()).read(5) != "hello", "test 1 failed: data not delivered");
+
+            demux.write(tuple.value(), "world");
+            exchange(demux, clients);
+            test_err_if(client.inbound_stream().read(5) != "world", "test 1 failed: reply not delivered");
+
+            client.end_input_stream();
+            exchange(demux, clients);
+            test_err_if(not demux.inbound_stream(tuple.value()).eof(), "test 1 failed: FIN not delivered");
+
+            demux.release(tuple.value());
+            exchange(demux, clients);
+            demux.tick(1);
+            test_err_if(demux.size() != 0, "test 1 failed: released connection was not reaped");
+            test_err_if(not client.inbound_stream().eof(), "test 1 failed: FIN not sent on release()");
+        }
+
+        // test 2: several connections at once, keyed by 4-tuple; the backlog limits unaccepted connections
+        {
+            TCPDemultiplexer demux{cfg, 2};
+            demux.listen(SERVER_PORT);
+
+            TCPConnection c1{cfg}, c2{cfg}, c3{cfg};
+            map<uint16_t, TCPConnection *> clients{{1001, &c1}, {1002, &c2}, {1003, &c3}};
+
+            c1.connect();
+            c2.connect();
+            c3.connect();
+            exchange(demux, clients);
+            test_err_if(demux.size() != 2, "test 2 failed: backlog not enforced");
+            test_err_if(demux.accept_queue_size() != 2, "test 2 failed: connections not queued");
+
+            const auto first = demux.accept();
+            test_err_if(not first.has_value() or first.value() != tuple_for(1001),
+                        "test 2 failed: accept() not in handshake order");
+
+            // the third client's SYN was dropped, so its retransmission now fits in the backlog
+            c3.tick(cfg.rt_timeout);
+            exchange(demux, clients);
+            test_err_if(demux.size() != 3, "test 2 failed: retransmitted SYN not accepted");
+
+            const auto second = demux.accept();
+            const auto third = demux.accept();
+            test_err_if(not second.has_value() or not third.has_value(), "test 2 failed: missing connections");
+
+            c2.write("two");
+            c3.write("three");
+            exchange(demux, clients);
+            test_err_if(demux.inbound_stream(tuple_for(1002)).read(10) != "two" or
+                            demux.inbound_stream(tuple_for(1003)).read(10) != "three" or
+                            not demux.inbound_stream(tuple_for(1001)).buffer_empty(),
+                        "test 2 failed: data delivered to the wrong connection");
+        }
+
+        // test 3: segments that belong to no connection
+        {
+            TCPDemultiplexer demux{cfg};
+            demux.listen(SERVER_PORT);
+
+            // an ACK for an unknown connection gets a RST with the ackno as its seqno
+            TaggedSegment stray{tuple_for(2000), {}};
+            stray.segment.header().ack = true;
+            stray.segment.header().ackno = WrappingInt32{12345};
+            demux.segment_received(move(stray));
+            test_err_if(demux.segments_out().size() != 1, "test 3 failed: no RST for stray ACK");
+            {
+                const TaggedSegment &rst = demux.segments_out().front();
+                test_err_if(not rst.segment.header().rst or rst.segment.header().seqno != WrappingInt32{12345} or
+                                rst.tuple != tuple_for(2000),
+                            "test 3 failed: bad RST for stray ACK");
+            }
+            demux.segments_out().pop();
+
+            // a SYN to a port nobody listens on gets a RST that acknowledges it
+            TaggedSegment syn{{SERVER_ADDRESS, CLIENT_ADDRESS, 81, 2001}, {}};
+            syn.segment.header().syn = true;
+            syn.segment.header().seqno = WrappingInt32{500};
+            demux.segment_received(move(syn));
+            test_err_if(demux.segments_out().size() != 1, "test 3 failed: no RST for SYN to closed port");
+            {
+                const TCPHeader &rst = demux.segments_out().front().segment.header();
+                test_err_if(not rst.rst or not rst.ack or rst.ackno != WrappingInt32{501},
+                            "test 3 failed: bad RST for SYN to closed port");
+            }
+            demux.segments_out().pop();
+
+            // a RST is never answered
+            TaggedSegment reset{tuple_for(2002), {}};
+            reset.segment.header().rst = true;
+            demux.segment_received(move(reset));
+            test_err_if(not demux.segments_out().empty(), "test 3 failed: RST answered with a segment");
+            test_err_if(demux.size() != 0, "test 3 failed: stray segments created connections");
+
+            test_err_if(
+                [&] {
+                    try {
+                        demux.write(tuple_for(2003), "x");
+                    } catch (const runtime_error &) {
+                        return false;
+                    }
+                    return true;
+                }(),
+                "test 3 failed: write() to unknown connection did not throw");
+        }
+
+        // test 4: an embryonic connection that is reset before its handshake completes is reaped
+        {
+            TCPDemultiplexer demux{cfg};
+            demux.listen(SERVER_PORT);
+
+            TaggedSegment syn{tuple_for(3000), {}};
+            syn.segment.header().syn = true;
+            syn.segment.header().seqno = WrappingInt32{7};
+            demux.segment_received(move(syn));
+            test_err_if(demux.size() != 1, "test 4 failed: SYN did not create a connection");
+            const WrappingInt32 server_isn = demux.segments_out().front().segment.header().seqno;
+            demux.segments_out().pop();
+
+            TaggedSegment rst{tuple_for(3000), {}};
+            rst.segment.header().rst = true;
+            rst.segment.header().seqno = WrappingInt32{8};
+            rst.segment.header().ack = true;
+            rst.segment.header().ackno = server_isn + 1;
+            demux.segment_received(move(rst));
+            test_err_if(demux.size() != 0, "test 4 failed: reset embryonic connection not reaped");
+            test_err_if(demux.accept().has_value(), "test 4 failed: reset connection was accepted");
+        }
+
+        // test 5: with SYN cookies, a SYN creates no connection until the final ACK validates its cookie
+        {
+            TCPDemultiplexer demux{cfg};
+            demux.listen(SERVER_PORT);
+            demux.set_syn_cookie_mode(TCPDemultiplexer::SynCookieMode::Always);
+
+            TCPConnection client{cfg};
+            map<uint16_t, TCPConnection *> clients{{4000, &client}};
+
+            client.connect();
+            demux.segment_received({tuple_for(4000), client.segments_out().front()});
+            client.segments_out().pop();
+            test_err_if(demux.size() != 0, "test 5 failed: SYN created a connection");
+            test_err_if(demux.segments_out().size() != 1 or demux.syn_cookies_sent() != 1,
+                        "test 5 failed: SYN not answered with a cookie");
+
+            exchange(demux, clients);
+            test_err_if(demux.syn_cookies_validated() != 1 or demux.size() != 1,
+                        "test 5 failed: valid cookie did not create a connection");
+            const auto tuple = demux.accept();
+            test_err_if(not tuple.has_value(), "test 5 failed: cookie connection not accepted");
+
+            client.write("cookie");
+            exchange(demux, clients);
+            test_err_if(demux.inbound_stream(tuple.value()).read(6) != "cookie", "test 5 failed: data not delivered");
+            demux.write(tuple.value(), "crumbs");
+            exchange(demux, clients);
+            test_err_if(client.inbound_stream().read(6) != "crumbs", "test 5 failed: reply not delivered");
+
+            // the cookie kept the client's MSS (the default, since its SYN announced none) for the connection
+            demux.write(tuple.value(), string(2000, 'm'));
+            test_err_if(demux.segments_out().empty(), "test 5 failed: nothing sent");
+            for (; not demux.segments_out().empty(); demux.segments_out().pop()) {
+                test_err_if(demux.segments_out().front().segment.payload().size() > SynCookies::DEFAULT_PEER_MSS,
+                            "test 5 failed: segment larger than the peer's MSS");
+            }
+        }
+
+        // test 6: an ACK with a forged cookie is reset, and creates nothing
+        {
+            TCPDemultiplexer demux{cfg};
+            demux.listen(SERVER_PORT);
+            demux.set_syn_cookie_mode(TCPDemultiplexer::SynCookieMode::Always);
+
+            TaggedSegment ack{tuple_for(4001), {}};
+            ack.segment.header().ack = true;
+            ack.segment.header().seqno = WrappingInt32{1001};
+            ack.segment.header().ackno = WrappingInt32{0xdeadbeef};
+            demux.segment_received(move(ack));
+            test_err_if(demux.size() != 0 or demux.syn_cookies_validated() != 0,
+                        "test 6 failed: forged cookie created a connection");
+            test_err_if(demux.segments_out().size() != 1 or not demux.segments_out().front().segment.header().rst,
+                        "test 6 failed: forged cookie not reset");
+        }
+
+        // test 7: cookies only when the backlog is full
+        {
+            TCPDemultiplexer demux{cfg, 1};
+            demux.listen(SERVER_PORT);
+            demux.set_syn_cookie_mode(TCPDemultiplexer::SynCookieMode::WhenBacklogFull);
+
+            TCPConnection c1{cfg}, c2{cfg};
+            map<uint16_t, TCPConnection *> clients{{4002, &c1}, {4003, &c2}};
+            c1.connect();
+            exchange(demux, clients);
+            test_err_if(demux.syn_cookies_sent() != 0, "test 7 failed: cookie sent with room in the backlog");
+
+            demux.accept();
+            c2.connect();
+            demux.segment_received({tuple_for(4003), c2.segments_out().front()});
+            c2.segments_out().pop();
+            test_err_if(demux.size() != 2, "test 7 failed: SYN with room in the backlog not stored");
+
+            TCPConnection c3{cfg};
+            clients.emplace(4004, &c3);
+            c3.connect();
+            exchange(demux, clients);
+            test_err_if(demux.syn_cookies_sent() != 1, "test 7 failed: no cookie with a full backlog");
+        }
+
+        // test 8: the side that closes first collapses into a TIME_WAIT record, which re-ACKs the peer's FIN
+        {
+            TCPConfig short_cfg = cfg;
+            short_cfg.rt_timeout = 10;  // linger for 100 ms
+            TCPDemultiplexer demux{short_cfg};
+            demux.listen(SERVER_PORT);
+
+            TCPConnection client{short_cfg};
+            map<uint16_t, TCPConnection *> clients{{5000, &client}};
+            client.connect();
+            exchange(demux, clients);
+            const auto tuple = demux.accept();
+
+            demux.release(tuple.value());
+            exchange(demux, clients);
+            test_err_if(not client.inbound_stream().eof(), "test 8 failed: FIN not sent on release()");
+
+            client.end_input_stream();
+            const TCPSegment fin = client.segments_out().front();
+            exchange(demux, clients);
+            test_err_if(demux.size() != 0 or demux.time_wait_size() != 1,
+                        "test 8 failed: lingering connection not collapsed into TIME_WAIT");
+
+            demux.segment_received({tuple.value(), fin});
+            test_err_if(demux.segments_out().size() != 1, "test 8 failed: retransmitted FIN not ACKed");
+            {
+                const TCPHeader &ack = demux.segments_out().front().segment.header();
+                test_err_if(not ack.ack or ack.rst or ack.ackno != fin.header().seqno + 1,
+                            "test 8 failed: bad ACK of retransmitted FIN");
+            }
+            demux.segments_out().pop();
+
+            TCPSegment bare_ack;
+            bare_ack.header().ack = true;
+            bare_ack.header().seqno = fin.header().seqno + 1;
+            demux.segment_received({tuple.value(), bare_ack});
+            test_err_if(not demux.segments_out().empty(), "test 8 failed: bare ACK in TIME_WAIT answered");
+
+            demux.tick(150);
+            test_err_if(demux.time_wait_size() != 0, "test 8 failed: TIME_WAIT record did not expire");
+
+            demux.segment_received({tuple.value(), fin});
+            test_err_if(demux.segments_out().size() != 1 or not demux.segments_out().front().segment.header().rst,
+                        "test 8 failed: FIN after TIME_WAIT not answered with RST");
+        }
+
+        // test 9: a RST ends TIME_WAIT early
+        {
+            TCPDemultiplexer demux{cfg};
+            demux.listen(SERVER_PORT);
+
+            TCPConnection client{cfg};
+            map<uint16_t, TCPConnection *> clients{{5001, &client}};
+            client.connect();
+            exchange(demux, clients);
+            const auto tuple = demux.accept();
+            demux.release(tuple.value());
+            exchange(demux, clients);
+            client.end_input_stream();
+            exchange(demux, clients);
+            test_err_if(demux.time_wait_size() != 1, "test 9 failed: no TIME_WAIT record");
+
+            TCPSegment rst;
+            rst.header().rst = true;
+            rst.header().seqno = client.next_seqno();
+            demux.segment_received({tuple.value(), rst});
+            test_err_if(demux.time_wait_size() != 0 or not demux.segments_out().empty(),
+                        "test 9 failed: RST did not end TIME_WAIT");
+        }
+
+        // test 10: a record that enters TIME_WAIT with an earlier deadline than others expires on time
+        {
+            TCPConfig short_cfg = cfg;
+            short_cfg.rt_timeout = 10;  // linger for 100 ms
+            TCPDemultiplexer demux{short_cfg};
+            demux.listen(SERVER_PORT);
+
+            TCPConnection early{short_cfg}, late{short_cfg};
+            map<uint16_t, TCPConnection *> clients{{5002, &early}, {5003, &late}};
+            early.connect();
+            late.connect();
+            exchange(demux, clients);
+            const auto early_tuple = demux.accept(), late_tuple = demux.accept();
+
+            // `early` lingers but is still owned by the application, so it is not collapsed yet
+            demux.end_input_stream(early_tuple.value());
+            exchange(demux, clients);
+            early.end_input_stream();
+            exchange(demux, clients);
+
+            demux.release(late_tuple.value());
+            exchange(demux, clients);
+            late.end_input_stream();
+            const TCPSegment fin = late.segments_out().front();
+            exchange(demux, clients);
+
+            // `late`'s linger restarts, and then `early` is collapsed, with what is left of its linger
+            demux.tick(60);
+            demux.segment_received({late_tuple.value(), fin});
+            demux.segments_out() = {};
+            demux.release(early_tuple.value());
+            test_err_if(demux.time_wait_size() != 2, "test 10 failed: no TIME_WAIT records");
+
+            demux.tick(70);
+            test_err_if(demux.time_wait_size() != 1, "test 10 failed: record with the earlier deadline kept");
+        }
+
+        // test 11: both tick()s and advance() move the clock that TIME_WAIT records expire on
+        {
+            TCPConfig short_cfg = cfg;
+            short_cfg.rt_timeout = 10;  // linger for 100 ms
+            TCPDemultiplexer demux{short_cfg};
+            demux.listen(SERVER_PORT);
+
+            TCPConnection closing{short_cfg}, idle{short_cfg};
+            map<uint16_t, TCPConnection *> clients{{5004, &closing}, {5005, &idle}};
+            closing.connect();
+            idle.connect();
+            exchange(demux, clients);
+            const auto closing_tuple = demux.accept(), idle_tuple = demux.accept();
+
+            demux.release(closing_tuple.value());
+            exchange(demux, clients);
+            closing.end_input_stream();
+            exchange(demux, clients);
+            test_err_if(demux.time_wait_timeout() != 100, "test 11 failed: wrong time to TIME_WAIT expiry");
+
+            demux.tick(idle_tuple.value(), 60);
+            test_err_if(demux.time_wait_timeout() != 40 or demux.time_wait_size() != 1,
+                        "test 11 failed: per-connection tick() did not move the clock");
+            demux.advance(40);
+            test_err_if(demux.time_wait_size() != 0 or demux.time_wait_timeout().has_value(),
+                        "test 11 failed: TIME_WAIT record did not expire on advance()");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
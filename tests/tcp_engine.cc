@@ -0,0 +1,85 @@
+#include "tcp_config.hh"
+#include "tcp_engine.hh"
+#include "tcp_engine_test_helpers.hh"
+#include "test_err_if.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t NUM_CLIENTS = 4;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.rt_timeout = 50;
+        // the server reads every connection from one UDP socket: keep the windows small enough that their
+        // segments in flight fit its receive buffer, so the transfers are paced by ACKs rather than by retransmission
+        cfg.recv_capacity = 16000;
+
+        // a TCP-over-UDP tuple is the two UDP endpoints, so each client needs its own engine
+        TCPOverUDPSocketAdapter server_adapter = loopback_adapter();
+        vector<unique_ptr<TCPOverUDPEngine>> clients;
+        vector<FourTuple> tuples;
+        for (size_t i = 0; i < NUM_CLIENTS; ++i) {
+            TCPOverUDPSocketAdapter adapter = loopback_adapter();
+            tuples.push_back(loopback_tuple(adapter.config().source, server_adapter.config().source));
+            clients.push_back(make_unique<TCPOverUDPEngine>(move(adapter), cfg));
+        }
+        const uint16_t server_port = server_adapter.config().source.port();
+        TCPOverUDPEngine server{move(server_adapter), cfg};
+        server.listen(server_port);
+
+        // test 1: the server echoes every connection at once, each on its own thread
+        thread acceptor([&] {
+            vector<thread> echoers;
+            try {
+                for (size_t i = 0; i < NUM_CLIENTS; ++i) {
+                    echoers.emplace_back(echo, server.accept());
+                }
+            } catch (const exception &e) {
+                cerr << "accept() failed: " << e.what() << endl;
+            }
+            for (auto &echoer : echoers) {
+                echoer.join();
+            }
+        });
+
+        vector<string> sent(NUM_CLIENTS), received(NUM_CLIENTS);
+        {
+            vector<thread> client_threads;
+            for (size_t i = 0; i < NUM_CLIENTS; ++i) {
+                sent[i] = string(100000 + 1000 * i, char('a' + i));
+                client_threads.emplace_back([&, i] {
+                    TCPReactor::Handle handle = clients[i]->connect(tuples[i]);
+                    received[i] = send_and_receive(handle, sent[i]);
+                });
+            }
+            for (auto &client_thread : client_threads) {
+                client_thread.join();
+            }
+        }
+        acceptor.join();
+
+        for (size_t i = 0; i < NUM_CLIENTS; ++i) {
+            test_err_if(received[i] != sent[i], "test 1 failed: connection " + to_string(i) + " not echoed");
+        }
+
+        // test 2: the server (which closed second) reaps every connection, without being ticked by anyone
+        test_err_if(not wait_until([&] { return server.reactor().size() == 0; }),
+                    "test 2 failed: closed connections not reaped");
+        test_err_if(server.reactor().timers_armed() != 0, "test 2 failed: timers left armed");
+        test_err_if(server.reactor().timeout_ms() != -1, "test 2 failed: idle engine still wakes up");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
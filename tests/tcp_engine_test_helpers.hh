@@ -0,0 +1,75 @@
+#ifndef SPONGE_TESTS_TCP_ENGINE_TEST_HELPERS_HH
+#define SPONGE_TESTS_TCP_ENGINE_TEST_HELPERS_HH
+
+#include "address.hh"
+#include "fd_adapter.hh"
+#include "four_tuple.hh"
+#include "socket.hh"
+#include "tcp_reactor.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+
+//! A TCP-over-UDP adapter on a UDP socket bound to an ephemeral port of the loopback interface
+inline TCPOverUDPSocketAdapter loopback_adapter() {
+    UDPSocket sock;
+    sock.bind(Address("127.0.0.1", 0));
+    TCPOverUDPSocketAdapter adapter{std::move(sock)};
+    adapter.config_mut().source = static_cast<UDPSocket &>(adapter).local_address();
+    return adapter;
+}
+
+//! The tuple of a TCP-over-UDP connection between two UDP endpoints, from the point of view of `local`
+inline FourTuple loopback_tuple(const Address &local, const Address &remote) {
+    return {local.ipv4_numeric(), remote.ipv4_numeric(), local.port(), remote.port()};
+}
+
+//! Poll `done` every millisecond, for up to `timeout_ms`; returns whether it became true
+inline bool wait_until(const std::function<bool()> &done, const unsigned timeout_ms = 5000) {
+    for (unsigned waited = 0; not done(); ++waited) {
+        if (waited == timeout_ms) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+//! Send everything the peer sends back to it, until it ends its stream; then close
+inline void echo(TCPReactor::Handle handle) {
+    try {
+        for (std::string data = handle.read(); not data.empty(); data = handle.read()) {
+            handle.write(data);
+        }
+    } catch (const std::exception &) {
+        // the test finds out from what the peer received
+    }
+}
+
+//! Write `data` (and end the outbound stream) while reading the peer's stream to its end; returns what was read
+inline std::string send_and_receive(TCPReactor::Handle &handle, const std::string &data) {
+    std::thread writer([&] {
+        try {
+            for (size_t sent = 0; sent < data.size(); sent += 1000) {
+                handle.write(data.substr(sent, 1000));
+            }
+            handle.shutdown_write();
+        } catch (const std::exception &) {
+            // the test finds out from what was read back
+        }
+    });
+
+    std::string received;
+    for (std::string chunk = handle.read(); not chunk.empty(); chunk = handle.read()) {
+        received += chunk;
+    }
+    writer.join();
+    return received;
+}
+
+#endif  // SPONGE_TESTS_TCP_ENGINE_TEST_HELPERS_HH
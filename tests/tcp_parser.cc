@@ -1,10 +1,12 @@
 #include "parser.hh"
 #include "tcp_header.hh"
+#include "tcp_options.hh"
 #include "tcp_segment.hh"
 #include "test_utils.hh"
 #include "util.hh"
 
 #include <algorithm>
+#include <array>
 #include <cstdint>
 #include <cstdlib>
 #include <exception>
@@ -23,6 +25,132 @@ uint16_t inet_cksum(const uint8_t *data, const size_t len) {
     return check.value();
 }
 
+//! Parse `header` (with `options` appended and `doff` set to fit them), or throw
+TCPHeader parse_with_options(vector<uint8_t> header, const vector<uint8_t> &options) {
+    header.insert(header.end(), options.begin(), options.end());
+    header[12] = (header.size() / 4) << 4;
+    TCPHeader ret{};
+    NetParser p{string(header.begin(), header.end())};
+    if (const auto res = ret.parse(p); res != ParseResult::NoError) {
+        throw runtime_error("header with options failed to parse: " + as_string(res));
+    }
+    return ret;
+}
+
+//! Check the option codec on its own and in a TCPHeader
+void test_options() {
+    const vector<uint8_t> base_header(TCPHeader::LENGTH, 0);
+
+    // a typical SYN: MSS, SACK_PERMITTED + TIMESTAMPS (sharing a word, so no NOP), NOP + WINDOW_SCALE
+    TCPOptions syn_options;
+    if (not syn_options.add_mss(1460) or not syn_options.add_sack_permitted() or
+        not syn_options.add_timestamps({0x01020304, 0}) or not syn_options.add_window_scale(7)) {
+        throw runtime_error("options: adding SYN options failed");
+    }
+    const vector<uint8_t> syn_bytes{2, 4, 0x05, 0xb4, 4, 2, 8, 10, 1, 2, 3, 4, 0, 0, 0, 0, 1, 3, 3, 7};
+    if (syn_options.bytes() != string(syn_bytes.begin(), syn_bytes.end()) or syn_options.padded_length() != 20) {
+        throw runtime_error("options: SYN options encoded wrongly");
+    }
+
+    // alone, the timestamps are aligned with two NOPs in front
+    TCPOptions ts_options;
+    ts_options.add_timestamps({5, 6});
+    if (ts_options.bytes().size() != 12 or ts_options.bytes().substr(0, 3) != string{1, 1, 8}) {
+        throw runtime_error("options: timestamps not aligned");
+    }
+
+    // the typed accessors read back what was added
+    {
+        TCPHeader header{};
+        header.set_options(syn_options);
+        if (header.doff != 10) {
+            throw runtime_error("options: set_options() set the wrong doff");
+        }
+        const string raw = header.serialize();
+        NetParser p{string(raw)};
+        TCPHeader parsed{};
+        if (const auto res = parsed.parse(p); res != ParseResult::NoError or not(parsed == header)) {
+            throw runtime_error("options: round trip through a TCPHeader failed");
+        }
+        const TCPOptions &o = parsed.options;
+        const auto ts = o.timestamps();
+        if (o.size() != 4 or o.mss() != 1460 or o.window_scale() != 7 or not o.sack_permitted() or not ts or
+            ts->value != 0x01020304 or ts->echo_reply != 0 or o.sack().count != 0) {
+            throw runtime_error("options: typed accessors read the wrong values");
+        }
+        if (raw.substr(TCPHeader::LENGTH) != string(syn_bytes.begin(), syn_bytes.end())) {
+            throw runtime_error("options: serialized wrongly in a TCPHeader");
+        }
+    }
+
+    // SACK blocks, and the 40-byte limit
+    {
+        TCPOptions sack_options;
+        sack_options.add_timestamps({1, 2});
+        const array<TCPOptions::SACKBlock, 4> blocks{{{WrappingInt32{100}, WrappingInt32{200}},
+                                                      {WrappingInt32{300}, WrappingInt32{400}},
+                                                      {WrappingInt32{500}, WrappingInt32{600}},
+                                                      {WrappingInt32{700}, WrappingInt32{800}}}};
+        if (sack_options.add_sack(blocks.data(), 4)) {
+            throw runtime_error("options: 4 SACK blocks and timestamps do not fit in 40 bytes");
+        }
+        if (not sack_options.add_sack(blocks.data(), 3) or sack_options.bytes().size() != 40) {
+            throw runtime_error("options: 3 SACK blocks and timestamps should fit in 40 bytes");
+        }
+        if (sack_options.add_sack_permitted() or sack_options.size() != 2) {
+            throw runtime_error("options: an option was added past 40 bytes");
+        }
+        const auto sacked = sack_options.sack();
+        if (sacked.count != 3 or sacked.blocks[2].left != WrappingInt32{500} or
+            sacked.blocks[2].right != WrappingInt32{600}) {
+            throw runtime_error("options: SACK blocks read back wrongly");
+        }
+        if (sack_options.add(TCPOptions::NOP, {})) {
+            throw runtime_error("options: add() accepted a NOP");
+        }
+    }
+
+    // unknown options are carried along; END stops parsing; the wrong length hides a typed option
+    {
+        const TCPHeader header = parse_with_options(base_header, {1, 30, 4, 0xab, 0xcd, 3, 2, 0, 2, 4, 1, 0});
+        const TCPOptions &o = header.options;
+        if (o.size() != 2 or o.begin()->kind != 30 or o.value(*o.begin()) != "\xab\xcd") {
+            throw runtime_error("options: unknown option not kept");
+        }
+        if (o.window_scale().has_value() or o.mss().has_value()) {
+            throw runtime_error("options: option with wrong length (or after END) was decoded");
+        }
+        const string raw = header.serialize();
+        if (raw.substr(TCPHeader::LENGTH, 8) != string{1, 30, 4, char(0xab), char(0xcd), 3, 2, 0}) {
+            throw runtime_error("options: unknown option not re-serialized");
+        }
+    }
+
+    // malformed options: the header still parses, with the options before the bad one
+    for (const vector<uint8_t> &bad : vector<vector<uint8_t>>{{2, 4, 5, 0xb4, 8, 0, 0, 0},
+                                                               {2, 4, 5, 0xb4, 8, 1, 0, 0},
+                                                               {2, 4, 5, 0xb4, 8, 10, 0, 0},
+                                                               {2, 4, 5, 0xb4, 1, 1, 1, 8}}) {
+        const TCPHeader header = parse_with_options(base_header, bad);
+        if (header.options.size() != 1 or header.options.mss() != 1460) {
+            throw runtime_error("options: malformed options not handled");
+        }
+    }
+
+    // options that do not fit in doff are not serialized
+    {
+        TCPHeader header{};
+        header.options = syn_options;
+        const string raw = header.serialize();
+        NetParser p{string(raw)};
+        TCPHeader parsed{};
+        if (raw.size() != TCPHeader::LENGTH or parsed.parse(p) != ParseResult::NoError or
+            not parsed.options.empty()) {
+            throw runtime_error("options: options serialized past doff");
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     try {
         // first, make sure the parser gets the correct values and catches errors
@@ -118,6 +246,8 @@ int main(int argc, char **argv) {
             }
         }
 
+        test_options();
+
         // now process some segments off the wire for correctness of parser and unparser
         if (argc < 2) {
             cout << "USAGE: " << argv[0] << " <filename>" << endl;
@@ -137,6 +267,7 @@ int main(int argc, char **argv) {
         }
 
         bool ok = true;
+        unsigned with_options = 0;
         const uint8_t *pkt;
         struct pcap_pkthdr hdr;
         while ((pkt = pcap_next(pcap, &hdr)) != nullptr) {
@@ -185,8 +316,31 @@ int main(int argc, char **argv) {
                 continue;
             }
 
-            // parse succeeded. Create a new segment and rebuild the header by unparsing.
+            // parse succeeded. The header (with its options) must serialize back to the bytes on the wire.
             cout << dec;
+            {
+                const TCPHeader &tcp_hdr_orig = tcp_seg.header();
+                const string wire(reinterpret_cast<const char *>(tcp_seg_data), 4 * tcp_hdr_orig.doff);
+                string unparsed = tcp_hdr_orig.serialize();
+                unparsed.replace(16, 2, wire.substr(16, 2));  // the checksum was fixed up above
+                if (unparsed != wire) {
+                    cout << "ERROR: TCP header (with options) does not serialize to the original:\n";
+                    hexdump(tcp_seg_data, 4 * tcp_hdr_orig.doff);
+                    ok = false;
+                    continue;
+                }
+
+                TCPHeader reparsed{};
+                NetParser p{string(unparsed)};
+                if (reparsed.parse(p) != ParseResult::NoError or reparsed.options != tcp_hdr_orig.options) {
+                    cout << "ERROR: TCP options do not match after re-parsing.\n";
+                    ok = false;
+                    continue;
+                }
+                with_options += not tcp_hdr_orig.options.empty();
+            }
+
+            // Create a new segment and rebuild the header by unparsing.
 
             TCPSegment tcp_seg_copy;
             tcp_seg_copy.payload() = tcp_seg.payload();
@@ -233,6 +387,10 @@ int main(int argc, char **argv) {
         }
 
         pcap_close(pcap);
+        if (with_options == 0) {
+            cout << "ERROR: no segments with TCP options in the capture\n";
+            ok = false;
+        }
         if (!ok) {
             return EXIT_FAILURE;
         }
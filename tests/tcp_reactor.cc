@@ -0,0 +1,127 @@
+#include "four_tuple.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_reactor.hh"
+#include "test_err_if.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+static const FourTuple TUPLE{0x0a000001, 0x0a000002, 80, 1000};
+
+//! Moves segments between the reactor and an in-memory client until both sides are quiet
+static void exchange(TCPReactor &reactor, TCPConnection &client) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        while (not client.segments_out().empty()) {
+            reactor.segment_received({TUPLE, client.segments_out().front()});
+            client.segments_out().pop();
+            progress = true;
+        }
+        queue<TaggedSegment> segments;
+        reactor.take_segments(segments);
+        while (not segments.empty()) {
+            client.segment_received(segments.front().segment);
+            segments.pop();
+            progress = true;
+        }
+    }
+}
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.rt_timeout = 100;
+
+        unsigned wakeups = 0;
+        TCPReactor reactor{cfg, 16, [&] { ++wakeups; }};
+        reactor.listen(TUPLE.local_port);
+
+        TCPConnection client{cfg};
+        client.connect();
+        exchange(reactor, client);
+
+        // test 1: the accepted connection is idle, so it needs no timer
+        TCPReactor::Handle handle = reactor.accept();
+        test_err_if(handle.tuple() != TUPLE, "test 1 failed: wrong connection accepted");
+        test_err_if(reactor.timers_armed() != 0, "test 1 failed: idle connection has a timer");
+
+        // test 2: data from the client is read through the handle
+        client.write("ping");
+        exchange(reactor, client);
+        test_err_if(handle.read() != "ping", "test 2 failed: data not read");
+
+        // test 3: a write wakes the network thread and arms the timer until it is acknowledged
+        const unsigned wakeups_before = wakeups;
+        handle.write("pong");
+        test_err_if(wakeups == wakeups_before, "test 3 failed: write() did not wake the network thread");
+        test_err_if(reactor.timers_armed() != 1, "test 3 failed: bytes in flight but no timer");
+        test_err_if(reactor.timeout_ms() <= int(cfg.rt_timeout - TCPReactor::TIMER_GRANULARITY_MS),
+                    "test 3 failed: timer armed before the retransmission timeout");
+        exchange(reactor, client);
+        test_err_if(client.inbound_stream().read(4) != "pong", "test 3 failed: data not sent");
+        test_err_if(reactor.timers_armed() != 0, "test 3 failed: timer still armed after ACK");
+
+        // test 4: an unacknowledged write is retransmitted when its timer expires
+        handle.write("again");
+        {
+            queue<TaggedSegment> lost;
+            reactor.take_segments(lost);
+        }
+        this_thread::sleep_for(chrono::milliseconds(cfg.rt_timeout + 3 * TCPReactor::TIMER_GRANULARITY_MS));
+        reactor.expire_timers();
+        exchange(reactor, client);
+        test_err_if(client.inbound_stream().read(5) != "again", "test 4 failed: lost segment not retransmitted");
+
+        // test 5: closing the handle and the client's side closes and reaps the connection
+        client.end_input_stream();
+        exchange(reactor, client);
+        test_err_if(not handle.read().empty(), "test 5 failed: EOF not read");
+        handle.close();
+        exchange(reactor, client);
+        test_err_if(not client.inbound_stream().eof(), "test 5 failed: FIN not sent on close()");
+
+        this_thread::sleep_for(chrono::milliseconds(3 * TCPReactor::TIMER_GRANULARITY_MS));
+        reactor.expire_timers();
+        test_err_if(reactor.size() != 0, "test 5 failed: closed connection not reaped");
+        test_err_if(reactor.timers_armed() != 0, "test 5 failed: timer left armed");
+
+        // test 6: a connection closed by the application first leaves a TIME_WAIT record, which expires
+        // while the reactor is otherwise idle
+        {
+            TCPConfig short_cfg = cfg;
+            short_cfg.rt_timeout = 5;  // linger for 50 ms
+            TCPReactor idle_reactor{short_cfg, 16, [] {}};
+            idle_reactor.listen(TUPLE.local_port);
+
+            TCPConnection peer{short_cfg};
+            peer.connect();
+            exchange(idle_reactor, peer);
+            idle_reactor.accept().close();
+            exchange(idle_reactor, peer);
+            peer.end_input_stream();
+            exchange(idle_reactor, peer);
+            test_err_if(idle_reactor.size() != 0 or idle_reactor.timeout_ms() < 0,
+                        "test 6 failed: no timer for the TIME_WAIT record");
+
+            const uint64_t linger_ms = 10 * short_cfg.rt_timeout;
+            this_thread::sleep_for(chrono::milliseconds(linger_ms + 3 * TCPReactor::TIMER_GRANULARITY_MS));
+            idle_reactor.expire_timers();
+            test_err_if(idle_reactor.timeout_ms() >= 0, "test 6 failed: TIME_WAIT record did not expire");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
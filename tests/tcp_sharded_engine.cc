@@ -0,0 +1,168 @@
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_engine.hh"
+#include "tcp_engine_test_helpers.hh"
+#include "tcp_segment.hh"
+#include "tcp_sharded_engine.hh"
+#include "test_err_if.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static constexpr size_t NUM_SHARDS = 4;
+static constexpr size_t CLIENTS_PER_SHARD = 2;
+
+int main() {
+    try {
+        TCPConfig cfg{};
+        cfg.rt_timeout = 50;
+        // the dispatcher reads every connection from one UDP socket: keep the windows small enough that their
+        // segments in flight fit its receive buffer, so the transfers are paced by ACKs rather than by retransmission
+        cfg.recv_capacity = 8000;
+
+        // test 1: connections are steered to the shard their tuple hashes to, accepted from every shard by
+        // one blocked accept(), and carry data both ways. The rings are small, so bursts from the shards
+        // fill the shared outbound ring and are handed over on retry.
+        {
+            TCPOverUDPSocketAdapter server_adapter = loopback_adapter();
+            const Address server_address = server_adapter.config().source;
+            TCPOverUDPShardedEngine server{move(server_adapter), cfg, NUM_SHARDS, 16, 16};
+            server.listen(server_address.port());
+
+            // a TCP-over-UDP tuple is the two UDP endpoints, so pick client sockets until every shard has its share
+            vector<unique_ptr<TCPOverUDPEngine>> clients;
+            vector<FourTuple> tuples;
+            vector<size_t> per_shard(NUM_SHARDS);
+            for (unsigned tries = 0; clients.size() < NUM_SHARDS * CLIENTS_PER_SHARD and tries < 1000; ++tries) {
+                TCPOverUDPSocketAdapter adapter = loopback_adapter();
+                const Address client_address = adapter.config().source;
+                size_t &count = per_shard[server.shard_of(loopback_tuple(server_address, client_address))];
+                if (count < CLIENTS_PER_SHARD) {
+                    ++count;
+                    tuples.push_back(loopback_tuple(client_address, server_address));
+                    clients.push_back(make_unique<TCPOverUDPEngine>(move(adapter), cfg));
+                }
+            }
+            test_err_if(clients.size() != NUM_SHARDS * CLIENTS_PER_SHARD, "test 1 failed: a shard gets no tuples");
+
+            vector<TCPReactor::Handle> accepted;
+            thread acceptor([&] {
+                try {
+                    while (accepted.size() < clients.size()) {
+                        accepted.push_back(server.accept());
+                    }
+                } catch (const exception &e) {
+                    cerr << "accept() failed: " << e.what() << endl;
+                }
+            });
+            vector<TCPReactor::Handle> handles;
+            for (size_t i = 0; i < clients.size(); ++i) {
+                handles.push_back(clients[i]->connect(tuples[i]));
+            }
+            acceptor.join();
+            test_err_if(accepted.size() != clients.size(), "test 1 failed: connections not accepted");
+            for (size_t i = 0; i < NUM_SHARDS; ++i) {
+                test_err_if(server.shard(i).size() != per_shard[i],
+                            "test 1 failed: shard " + to_string(i) + " does not own the connections that hash to it");
+            }
+
+            vector<string> sent(clients.size()), received(clients.size());
+            {
+                vector<thread> threads;
+                for (auto &handle : accepted) {
+                    threads.emplace_back(echo, move(handle));
+                }
+                for (size_t i = 0; i < clients.size(); ++i) {
+                    sent[i] = string(50000 + 1000 * i, char('a' + i));
+                    threads.emplace_back([&, i] {
+                        received[i] = send_and_receive(handles[i], sent[i]);
+                        handles[i].close();
+                    });
+                }
+                for (auto &t : threads) {
+                    t.join();
+                }
+            }
+            for (size_t i = 0; i < clients.size(); ++i) {
+                test_err_if(received[i] != sent[i], "test 1 failed: connection " + to_string(i) + " not echoed");
+            }
+
+            // test 2: every shard reaps its closed connections, and the engine shuts down with nothing left
+            for (size_t i = 0; i < NUM_SHARDS; ++i) {
+                test_err_if(not wait_until([&] { return server.shard(i).size() == 0; }),
+                            "test 2 failed: closed connections of shard " + to_string(i) + " not reaped");
+            }
+        }
+
+        // test 3: segments for a shard whose inbound ring is full are dropped and counted
+        {
+            TCPOverUDPSocketAdapter server_adapter = loopback_adapter();
+            const Address server_address = server_adapter.config().source;
+            constexpr size_t RING_CAPACITY = 4;
+            TCPOverUDPShardedEngine server{move(server_adapter), cfg, 1, 16, RING_CAPACITY};
+            server.listen(server_address.port());
+
+            // stall the shard: its accept callback (called on the shard's thread) blocks until released
+            mutex stall_mutex;
+            condition_variable stall_changed;
+            bool stalled = false, released = false;
+            server.shard(0).set_accept_callback([&] {
+                unique_lock<mutex> lock(stall_mutex);
+                stalled = true;
+                stall_changed.notify_all();
+                stall_changed.wait(lock, [&] { return released; });
+            });
+            const auto release = [&] {
+                lock_guard<mutex> lock(stall_mutex);
+                released = true;
+                stall_changed.notify_all();
+            };
+
+            TCPOverUDPSocketAdapter client_adapter = loopback_adapter();
+            const FourTuple tuple = loopback_tuple(client_adapter.config().source, server_address);
+            TCPOverUDPEngine client{move(client_adapter), cfg};
+            TCPReactor::Handle handle = client.connect(tuple);
+            bool handshake_done = false;
+            {
+                unique_lock<mutex> lock(stall_mutex);
+                handshake_done = stall_changed.wait_for(lock, chrono::seconds(5), [&] { return stalled; });
+            }
+            if (not handshake_done) {
+                release();
+            }
+            test_err_if(not handshake_done, "test 3 failed: handshake did not complete");
+
+            constexpr size_t FLOOD = 64;
+            UDPSocket flooder;
+            flooder.bind(Address("127.0.0.1", 0));
+            TCPSegment ack;
+            ack.header().ack = true;
+            for (size_t i = 0; i < FLOOD; ++i) {
+                flooder.sendto(server_address, ack.serialize());
+            }
+            const bool all_dropped = wait_until([&] { return server.dropped() >= FLOOD - RING_CAPACITY; });
+            release();
+
+            test_err_if(not all_dropped or server.dropped() != FLOOD - RING_CAPACITY,
+                        "test 3 failed: " + to_string(server.dropped()) + " segments dropped, not " +
+                            to_string(FLOOD - RING_CAPACITY));
+            test_err_if(not wait_until([&] { return server.shard(0).try_accept().has_value(); }),
+                        "test 3 failed: connection not accepted after the shard caught up");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+#include "test_err_if.hh"
+#include "timer_wheel.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        // test 1: timers fire at the first advance at or after their deadline, never before
+        {
+            TimerWheel wheel{1000, 10, 8};
+            vector<TimerWheel::TimerId> fired;
+            const auto record = [&](const TimerWheel::TimerId id) { fired.push_back(id); };
+
+            test_err_if(wheel.timeout_ms(1000) != -1, "test 1 failed: timeout with no timers armed");
+
+            wheel.schedule(1, 1015);
+            wheel.schedule(2, 1030);
+            test_err_if(wheel.size() != 2 or not wheel.scheduled(1), "test 1 failed: timers not armed");
+            test_err_if(wheel.timeout_ms(1000) != 20, "test 1 failed: timeout is not until the first timer fires");
+
+            wheel.advance(1010, record);
+            test_err_if(not fired.empty(), "test 1 failed: timer fired early");
+
+            wheel.advance(1020, record);
+            test_err_if(fired != vector<TimerWheel::TimerId>({1}), "test 1 failed: first timer did not fire");
+            test_err_if(wheel.timeout_ms(1025) != 5, "test 1 failed: timeout is not until the second timer fires");
+
+            wheel.advance(1040, record);
+            test_err_if(fired != vector<TimerWheel::TimerId>({1, 2}), "test 1 failed: second timer did not fire");
+            test_err_if(wheel.size() != 0, "test 1 failed: fired timers still armed");
+        }
+
+        // test 2: cancelling and re-arming
+        {
+            TimerWheel wheel{0, 10, 8};
+            vector<TimerWheel::TimerId> fired;
+            const auto record = [&](const TimerWheel::TimerId id) { fired.push_back(id); };
+
+            wheel.schedule(1, 20);
+            wheel.schedule(2, 20);
+            wheel.cancel(1);
+            wheel.schedule(2, 50);  // moves timer 2 later
+            test_err_if(wheel.timeout_ms(0) != 50, "test 2 failed: timeout counts a cancelled or moved timer");
+
+            wheel.advance(30, record);
+            test_err_if(not fired.empty(), "test 2 failed: cancelled or moved timer fired");
+
+            wheel.advance(50, record);
+            test_err_if(fired != vector<TimerWheel::TimerId>({2}), "test 2 failed: moved timer did not fire once");
+        }
+
+        // test 3: deadlines more than a full turn away, and long pauses between advances
+        {
+            TimerWheel wheel{0, 10, 4};
+            vector<TimerWheel::TimerId> fired;
+            const auto record = [&](const TimerWheel::TimerId id) { fired.push_back(id); };
+
+            wheel.schedule(1, 100);  // same slot as tick 2, but two turns later
+            test_err_if(wheel.timeout_ms(0) != 100, "test 3 failed: timeout is not until the far timer fires");
+            wheel.advance(20, record);
+            wheel.advance(60, record);
+            test_err_if(not fired.empty(), "test 3 failed: far timer fired in an earlier turn");
+
+            wheel.schedule(2, 70);
+            wheel.advance(10000, record);
+            test_err_if(fired.size() != 2, "test 3 failed: timers missed after a long pause");
+        }
+
+        // test 4: a callback may re-arm its own timer, which then fires on a later advance
+        {
+            TimerWheel wheel{0, 10, 8};
+            unsigned count = 0;
+            const auto periodic = [&](const TimerWheel::TimerId id) {
+                ++count;
+                wheel.schedule(id, 10 * (count + 1));
+            };
+
+            wheel.schedule(7, 10);
+            for (uint64_t now = 10; now <= 50; now += 10) {
+                wheel.advance(now, periodic);
+            }
+            test_err_if(count != 5, "test 4 failed: periodic timer fired " + to_string(count) + " times");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#include "test_err_if.hh"
+#include "toeplitz.hh"
+
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+//! RSS hash input for TCP over IPv4: source address, destination address, source port, destination port
+static string rss_input(const string &src, const string &dst, const uint16_t sport, const uint16_t dport) {
+    string input(12, 0);
+    in_addr addr{};
+    inet_pton(AF_INET, src.c_str(), &addr);
+    memcpy(input.data(), &addr, 4);
+    inet_pton(AF_INET, dst.c_str(), &addr);
+    memcpy(input.data() + 4, &addr, 4);
+    const uint16_t sport_n = htons(sport), dport_n = htons(dport);
+    memcpy(input.data() + 8, &sport_n, 2);
+    memcpy(input.data() + 10, &dport_n, 2);
+    return input;
+}
+
+int main() {
+    try {
+        const ToeplitzHash hash{};
+
+        // test 1: verification suite from Microsoft's RSS specification, with the default key
+        test_err_if(hash(rss_input("66.9.149.187", "161.142.100.80", 2794, 1766)) != 0x51ccc178,
+                    "test 1 failed: wrong hash for 66.9.149.187:2794 -> 161.142.100.80:1766");
+        test_err_if(hash(rss_input("199.92.111.2", "65.69.140.83", 14230, 4739)) != 0xc626b0ea,
+                    "test 1 failed: wrong hash for 199.92.111.2:14230 -> 65.69.140.83:4739");
+        test_err_if(hash(rss_input("24.19.198.95", "12.22.207.184", 12898, 38024)) != 0x5c2b394a,
+                    "test 1 failed: wrong hash for 24.19.198.95:12898 -> 12.22.207.184:38024");
+        test_err_if(hash(rss_input("38.27.205.30", "209.142.163.6", 48228, 2217)) != 0xafc7327f,
+                    "test 1 failed: wrong hash for 38.27.205.30:48228 -> 209.142.163.6:2217");
+        test_err_if(hash(rss_input("153.39.163.191", "202.188.127.2", 44251, 1303)) != 0x10e828a2,
+                    "test 1 failed: wrong hash for 153.39.163.191:44251 -> 202.188.127.2:1303");
+
+        // test 2: addresses only (the IPv4 2-tuple hash)
+        test_err_if(hash(rss_input("66.9.149.187", "161.142.100.80", 0, 0).substr(0, 8)) != 0x323e8fc2,
+                    "test 2 failed: wrong 2-tuple hash");
+
+        // test 3: inputs longer than the key allows are rejected
+        test_err_if(
+            [&] {
+                try {
+                    hash(string(ToeplitzHash::KEY_LENGTH, 'x'));
+                } catch (const runtime_error &) {
+                    return false;
+                }
+                return true;
+            }(),
+            "test 3 failed: overlong input accepted");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}